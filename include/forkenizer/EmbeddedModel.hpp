@@ -0,0 +1,53 @@
+#pragma once
+
+#include "forkenizer/PerfectHash.hpp"
+#include "forkenizer/Vocab.hpp"
+#include <cstddef>
+#include <cstdint>
+
+namespace forkenizer {
+
+// Node of the flat encode trie: its token (or UINT32_MAX) and its edges'
+// range in the label and target arrays.
+struct TrieNode {
+    uint32_t tokenId = UINT32_MAX;
+    uint32_t firstEdge = 0;
+    uint32_t edgeCount = 0;
+};
+
+// A model compiled into the binary by the forkenizer_embed_model() CMake function.
+// Every pointer refers to generated static tables. Tokenizer(const EmbeddedModel&)
+// reads them in place, so a model costs no file I/O or parsing at startup, and its
+// data sits in read-only pages shared by every process running the binary.
+struct EmbeddedModel {
+    // Vocab: token bytes back to back, a span per id, and the perfect hash over them.
+    const char* arena;
+    size_t arenaBytes;
+    const Vocab::Span* spans;
+    uint32_t idCount;
+    uint64_t hashSeed;
+    const uint32_t* hashPilots;
+    size_t hashPilotCount;
+    const PerfectHash::Slot* hashSlots;
+    size_t hashSlotCount;
+
+    // Flat trie in its (possibly profile-guided) layout.
+    const TrieNode* trieNodes;
+    size_t trieNodeCount;
+    const uint8_t* trieEdgeLabels;
+    const uint32_t* trieEdgeTargets;
+    size_t trieEdgeCount;
+    const uint32_t* trieRootChildren;  // 256 entries
+    const uint32_t* trieCanonical;     // layout index -> canonical index
+    const uint32_t* trieProfile;
+    size_t trieProfileSize;
+
+    // Merges in rank order as (left, right) token id pairs.
+    const uint32_t* mergeIds;
+    size_t mergeCount;
+
+    // Pretokenizer rule spec; empty means the default rules.
+    const char* preTokenizerRules;
+};
+
+}
@@ -0,0 +1,88 @@
+#pragma once
+
+#include <coroutine>
+#include <cstddef>
+#include <exception>
+#include <iterator>
+#include <utility>
+
+namespace forkenizer {
+
+// Coroutine frames come from a small per-thread cache of freed frames, so a
+// generator that is created and dropped in a loop stops allocating once warm.
+void* allocateCoroutineFrame(size_t size);
+void releaseCoroutineFrame(void* frame, size_t size) noexcept;
+
+// Lazy single-pass sequence produced by a coroutine: nothing runs until the first
+// begin(), and each increment resumes the body up to its next co_yield.
+template <typename T>
+class Generator {
+public:
+    struct promise_type {
+        const T* value = nullptr;
+
+        Generator get_return_object() {
+            return Generator(std::coroutine_handle<promise_type>::from_promise(*this));
+        }
+        std::suspend_always initial_suspend() noexcept { return {}; }
+        std::suspend_always final_suspend() noexcept { return {}; }
+        std::suspend_always yield_value(const T& next) noexcept {
+            value = &next;
+            return {};
+        }
+        void return_void() noexcept {}
+        void unhandled_exception() { std::terminate(); }
+
+        static void* operator new(size_t size) { return allocateCoroutineFrame(size); }
+        static void operator delete(void* frame, size_t size) noexcept { releaseCoroutineFrame(frame, size); }
+    };
+
+    class iterator {
+    public:
+        using iterator_category = std::input_iterator_tag;
+        using value_type = T;
+        using difference_type = std::ptrdiff_t;
+
+        iterator() = default;
+        explicit iterator(std::coroutine_handle<promise_type> handle) : handle_(handle) {}
+
+        const T& operator*() const { return *handle_.promise().value; }
+        iterator& operator++() {
+            handle_.resume();
+            return *this;
+        }
+        void operator++(int) { ++*this; }
+        bool operator==(std::default_sentinel_t) const { return !handle_ || handle_.done(); }
+
+    private:
+        std::coroutine_handle<promise_type> handle_;
+    };
+
+    Generator() = default;
+    Generator(Generator&& other) noexcept : handle_(std::exchange(other.handle_, {})) {}
+    Generator& operator=(Generator&& other) noexcept {
+        if (this != &other) {
+            if (handle_) handle_.destroy();
+            handle_ = std::exchange(other.handle_, {});
+        }
+        return *this;
+    }
+    Generator(const Generator&) = delete;
+    Generator& operator=(const Generator&) = delete;
+    ~Generator() {
+        if (handle_) handle_.destroy();
+    }
+
+    iterator begin() {
+        if (handle_) handle_.resume();
+        return iterator(handle_);
+    }
+    std::default_sentinel_t end() const { return {}; }
+
+private:
+    explicit Generator(std::coroutine_handle<promise_type> handle) : handle_(handle) {}
+
+    std::coroutine_handle<promise_type> handle_;
+};
+
+}
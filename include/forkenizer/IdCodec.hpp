@@ -0,0 +1,95 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <iosfwd>
+#include <optional>
+#include <string>
+#include <vector>
+
+namespace forkenizer {
+
+// StreamVByte coding of token ids: ceil(count / 4) control bytes, two bits per id
+// giving its length in bytes (1-4), then each id's low-order bytes, little-endian.
+// Frequent tokens have small ids, so most ids take one or two bytes, and decoding is
+// a table-driven shuffle of 16 bytes per four ids (SSSE3 when the CPU has it).
+size_t maxEncodedIdBytes(size_t count);
+// Writes the encoding of ids to out, which needs maxEncodedIdBytes(count) bytes, and
+// returns the number of bytes written.
+size_t encodeIds(const uint32_t* ids, size_t count, uint8_t* out);
+// Decodes count ids from exactly `bytes` bytes; false when the input is not a complete
+// encoding of count ids.
+bool decodeIds(const uint8_t* in, size_t bytes, uint32_t* out, size_t count);
+
+// Packed id stream: the magic "FKID", a version byte and three reserved bytes, then
+// blocks of whole documents. Each block starts with a header of four little-endian
+// uint32s (documents, ids, length bytes, id bytes), followed by the StreamVByte coded
+// per-document id counts and the coded ids. A reader can step from header to header
+// to reach a document without decoding the blocks before it.
+struct IdBlock {
+    std::vector<uint32_t> ids;
+    std::vector<size_t> offsets;  // documents() + 1 entries into ids
+
+    size_t documents() const { return offsets.empty() ? 0 : offsets.size() - 1; }
+};
+
+class IdStreamWriter {
+public:
+    static constexpr size_t kDefaultBlockIds = 1 << 16;
+
+    // Documents are buffered until a block holds at least blockIds ids; a larger
+    // document gets a block to itself.
+    explicit IdStreamWriter(std::ostream& out, size_t blockIds = kDefaultBlockIds);
+    bool addDocument(const uint32_t* ids, size_t count);
+    // Writes the last partial block. The stream is complete only after finish().
+    bool finish();
+
+private:
+    std::ostream& out_;
+    size_t blockIds_;
+    bool headerWritten_ = false;
+    std::vector<uint32_t> ids_;
+    std::vector<uint32_t> lengths_;
+    std::vector<uint8_t> buffer_;
+
+    bool flush_();
+};
+
+class IdStreamReader {
+public:
+    explicit IdStreamReader(std::istream& in);
+    // False when the stream did not start with a supported header.
+    bool valid() const { return valid_; }
+    // Reads the next block; false at the end of the stream or on a corrupt block,
+    // which error() then describes.
+    bool readBlock(IdBlock& block);
+    // Skips forward over whole blocks until the next one holds `document` (counted
+    // from the start of the stream) and returns the index of that block's first
+    // document, or nullopt if the stream ends first. Only block headers are read;
+    // payloads are seeked past.
+    std::optional<uint64_t> seekDocument(uint64_t document);
+    const std::string& error() const { return error_; }
+
+private:
+    struct Header {
+        uint32_t documents = 0;
+        uint32_t ids = 0;
+        uint32_t lengthBytes = 0;
+        uint32_t idBytes = 0;
+    };
+
+    std::istream& in_;
+    bool valid_ = false;
+    uint64_t nextDocument_ = 0;
+    std::optional<Header> pending_;
+    std::vector<uint8_t> buffer_;
+    std::vector<uint32_t> lengths_;
+    std::string error_;
+
+    bool readHeader_(Header& header);
+};
+
+// True when the file at path starts with the packed id stream magic.
+bool isPackedIdFile(const std::string& path);
+
+}
@@ -1,7 +1,7 @@
 #pragma once
 
+#include "forkenizer/Vocab.hpp"
 #include <string>
-#include <unordered_map>
 #include <vector>
 #include <utility>
 #include <cstdint>
@@ -9,9 +9,12 @@
 namespace forkenizer {
 
 struct ModelData {
-    std::unordered_map<std::string, uint32_t> tokenToId;
-    std::vector<std::string> idToToken;
+    Vocab vocab;
     std::vector<std::pair<std::string, std::string>> merges;
+    // PreTokenizer rule spec, stored as pretokenizer.rules; empty means the default rules.
+    std::string preTokenizerRules;
+    // Trie node visit counts from `optimize`, stored as trie.profile; empty means none.
+    std::vector<uint32_t> trieProfile;
 };
 
 bool loadModel(const std::string& modelDir, ModelData& data);
@@ -0,0 +1,124 @@
+#pragma once
+
+#include "forkenizer/Table.hpp"
+#include <string_view>
+#include <vector>
+#include <optional>
+#include <cstdint>
+#include <cstring>
+
+namespace forkenizer {
+
+inline uint64_t mixHash64(uint64_t h) {
+    h ^= h >> 33;
+    h *= 0xff51afd7ed558ccdULL;
+    h ^= h >> 33;
+    h *= 0xc4ceb9fe1a85ec53ULL;
+    h ^= h >> 33;
+    return h;
+}
+
+inline uint64_t foldMultiply(uint64_t a, uint64_t b) {
+    const unsigned __int128 r = static_cast<unsigned __int128>(a) * b;
+    return static_cast<uint64_t>(r) ^ static_cast<uint64_t>(r >> 64);
+}
+
+// wyhash-style byte hash. Short keys, which dominate token lookups, are read with
+// overlapping fixed-size loads so no call to memcpy is emitted for the tail.
+inline uint64_t hashBytes(std::string_view s, uint64_t seed) {
+    constexpr uint64_t k0 = 0xa0761d6478bd642fULL;
+    constexpr uint64_t k1 = 0xe7037ed1a0b428dbULL;
+    auto read64 = [](const char* p) { uint64_t v; std::memcpy(&v, p, 8); return v; };
+    auto read32 = [](const char* p) { uint32_t v; std::memcpy(&v, p, 4); return static_cast<uint64_t>(v); };
+
+    const char* p = s.data();
+    const size_t n = s.size();
+    uint64_t a = 0;
+    uint64_t b = 0;
+    seed ^= k0;
+    if (n <= 16) {
+        if (n >= 4) {
+            const size_t mid = (n >> 3) << 2;
+            a = (read32(p) << 32) | read32(p + mid);
+            b = (read32(p + n - 4) << 32) | read32(p + n - 4 - mid);
+        } else if (n > 0) {
+            a = (static_cast<uint64_t>(static_cast<unsigned char>(p[0])) << 16) |
+                (static_cast<uint64_t>(static_cast<unsigned char>(p[n >> 1])) << 8) |
+                static_cast<uint64_t>(static_cast<unsigned char>(p[n - 1]));
+        }
+    } else {
+        size_t i = n;
+        while (i > 16) {
+            seed = foldMultiply(read64(p) ^ k1, read64(p + 8) ^ seed);
+            p += 16;
+            i -= 16;
+        }
+        a = read64(p + i - 16);
+        b = read64(p + i - 8);
+    }
+    return foldMultiply(k1 ^ static_cast<uint64_t>(n), foldMultiply(a ^ k1, b ^ seed));
+}
+
+// Minimal perfect hash over a static key set (hash-and-displace, CHD/PTHash style).
+// Keys are split into buckets; each bucket stores a pilot that displaces its keys
+// into free slots of an n-slot table. A lookup is one pilot read plus one slot read,
+// and the slot's 32-bit fingerprint rejects almost every non-key without touching
+// the key bytes. Callers must still compare the key for a positive answer.
+class PerfectHash {
+public:
+    struct Slot {
+        uint32_t value = 0;
+        uint32_t fingerprint = 0;
+    };
+
+    bool build(const std::vector<std::string_view>& keys, const std::vector<uint32_t>& values);
+    // Reads tables saved from a built hash (seed(), pilots(), slots()) in place.
+    void bind(uint64_t seed, const uint32_t* pilots, size_t pilotCount, const Slot* slots, size_t slotCount);
+    void clear();
+
+    uint64_t seed() const { return seed_; }
+    const Table<uint32_t>& pilots() const { return pilots_; }
+    const Table<Slot>& slots() const { return slots_; }
+
+    bool empty() const { return slots_.empty(); }
+    size_t size() const { return slots_.size(); }
+    size_t memoryBytes() const { return pilots_.capacityBytes() + slots_.capacityBytes(); }
+
+    template <typename F>
+    void forEachValue(F&& fn) const {
+        for (const Slot& slot : slots_) {
+            fn(slot.value);
+        }
+    }
+
+    std::optional<uint32_t> candidate(std::string_view key) const {
+        if (slots_.empty()) {
+            return std::nullopt;
+        }
+        const uint64_t h = hashBytes(key, seed_);
+        const uint32_t pilot = pilots_[bucketOf_(h)];
+        const Slot& slot = slots_[slotOf_(h, pilot)];
+        if (slot.fingerprint != fingerprintOf_(h)) {
+            return std::nullopt;
+        }
+        return slot.value;
+    }
+
+private:
+    uint64_t seed_ = 0;
+    Table<uint32_t> pilots_;
+    Table<Slot> slots_;
+
+    static uint64_t reduce_(uint64_t h, uint64_t n) {
+        return static_cast<uint64_t>((static_cast<unsigned __int128>(h) * n) >> 64);
+    }
+    static uint32_t fingerprintOf_(uint64_t h) { return static_cast<uint32_t>(h); }
+    static size_t slotIn_(uint64_t h, uint32_t pilot, uint64_t seed, size_t slotCount) {
+        return reduce_(mixHash64(h ^ (static_cast<uint64_t>(pilot) * 0x9e3779b97f4a7c15ULL + seed)), slotCount);
+    }
+    size_t bucketOf_(uint64_t h) const { return reduce_(h, pilots_.size()); }
+    size_t slotOf_(uint64_t h, uint32_t pilot) const { return slotIn_(h, pilot, seed_, slots_.size()); }
+    bool tryBuild_(const std::vector<uint64_t>& hashes, const std::vector<uint32_t>& values);
+};
+
+}
@@ -1,13 +1,51 @@
 #pragma once
 
+#include <memory>
+#include <optional>
 #include <string>
+#include <string_view>
 #include <vector>
+#include <cstdint>
+#include <cstddef>
 
 namespace forkenizer {
 
+struct PreTokenSpan {
+    uint32_t begin;
+    uint32_t end;
+};
+
+class RuleDfa;
+
+// Splits text with an ordered rule set compiled to a table-driven DFA at load time.
+// At each position the first rule that matches wins with its longest match; text no
+// rule matches becomes a one-code-point piece. The default constructor uses the
+// "default" preset (signed numbers with exponents, identifiers, operator pairs).
 class PreTokenizer {
 public:
-    std::vector<std::string> preTokenize(const std::string& utf8Text) const;
+    PreTokenizer();
+    static std::optional<PreTokenizer> fromPreset(std::string_view name);
+    // Rule spec text: "<name> <pattern>" per line in priority order, "preset <name>"
+    // to include a built-in set, '#' comments. See RuleDfa.hpp for the pattern syntax.
+    static std::optional<PreTokenizer> fromSpec(std::string_view spec);
+    static std::vector<std::string_view> presetNames();
+    // Spec this pretokenizer was built from; empty for the default-constructed one.
+    const std::string& spec() const { return spec_; }
+
+    std::vector<std::string> preTokenize(std::string_view utf8Text) const;
+    // Same split as preTokenize, reported as byte ranges into utf8Text without copying.
+    // Stops after maxSpans pretokens. Combining marks always extend the piece before them.
+    void preTokenizeSpans(std::string_view utf8Text, std::vector<PreTokenSpan>& spans,
+                          size_t maxSpans = SIZE_MAX) const;
+    // Same split, also setting lookahead to the most bytes past a piece's end that were
+    // read to settle it, where running into the end of utf8Text counts as one byte.
+    // Editing text at or beyond end + lookahead cannot change the piece.
+    void preTokenizeSpans(std::string_view utf8Text, std::vector<PreTokenSpan>& spans, size_t maxSpans,
+                          size_t& lookahead) const;
+
+private:
+    std::shared_ptr<const RuleDfa> dfa_;
+    std::string spec_;
 };
 
 }
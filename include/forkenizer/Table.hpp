@@ -0,0 +1,88 @@
+#pragma once
+
+#include <cstddef>
+#include <utility>
+#include <vector>
+
+namespace forkenizer {
+
+// Read-only contiguous array that either owns its elements or borrows them from
+// storage that outlives it, such as the generated tables of an embedded model.
+// Reads are a plain pointer access either way; edit() copies borrowed elements into
+// owned storage before handing out the vector.
+template <typename T>
+class Table {
+public:
+    Table() = default;
+    Table(std::vector<T> values) : owned_(std::move(values)), data_(owned_.data()), size_(owned_.size()) {}
+    Table(const Table& other) : owned_(other.owned_), borrowed_(other.borrowed_) { sync_(other); }
+    Table(Table&& other) noexcept : owned_(std::move(other.owned_)), borrowed_(other.borrowed_) {
+        sync_(other);
+        other.reset_();
+    }
+    Table& operator=(const Table& other) {
+        if (this != &other) {
+            owned_ = other.owned_;
+            borrowed_ = other.borrowed_;
+            sync_(other);
+        }
+        return *this;
+    }
+    Table& operator=(Table&& other) noexcept {
+        if (this != &other) {
+            owned_ = std::move(other.owned_);
+            borrowed_ = other.borrowed_;
+            sync_(other);
+            other.reset_();
+        }
+        return *this;
+    }
+
+    static Table borrow(const T* data, size_t size) {
+        Table table;
+        table.data_ = data;
+        table.size_ = size;
+        table.borrowed_ = true;
+        return table;
+    }
+
+    const T* data() const { return data_; }
+    size_t size() const { return size_; }
+    bool empty() const { return size_ == 0; }
+    bool borrowed() const { return borrowed_; }
+    // Owned capacity; borrowed elements live elsewhere and count as zero.
+    size_t capacity() const { return owned_.capacity(); }
+    size_t capacityBytes() const { return owned_.capacity() * sizeof(T); }
+    const T& operator[](size_t i) const { return data_[i]; }
+    const T* begin() const { return data_; }
+    const T* end() const { return data_ + size_; }
+
+    template <typename F>
+    void edit(F&& fn) {
+        if (borrowed_) {
+            owned_.assign(data_, data_ + size_);
+            borrowed_ = false;
+        }
+        fn(owned_);
+        data_ = owned_.data();
+        size_ = owned_.size();
+    }
+
+private:
+    std::vector<T> owned_;
+    const T* data_ = nullptr;
+    size_t size_ = 0;
+    bool borrowed_ = false;
+
+    void sync_(const Table& other) {
+        data_ = borrowed_ ? other.data_ : owned_.data();
+        size_ = other.size_;
+    }
+    void reset_() {
+        data_ = nullptr;
+        size_ = 0;
+        borrowed_ = false;
+    }
+};
+
+}
@@ -1,42 +1,236 @@
 #pragma once
 
+#include "forkenizer/Generator.hpp"
+#include "forkenizer/Vocab.hpp"
+#include <array>
 #include <string>
+#include <string_view>
 #include <vector>
 #include <optional>
-#include <unordered_map>
 #include <memory>
 #include <cstdint>
 
 namespace forkenizer {
 
 class PreTokenizer;
+class SpecialTokenMatcher;
+class Normalizer;
+class FlatTrie;
+struct PreTokenSpan;
+struct EmbeddedModel;
+class EncodeScratch;
+
+// Token ids with a parallel struct-of-arrays of source byte ranges: token i covers
+// text[begins[i], ends[i]).
+struct Encoding {
+    std::vector<uint32_t> ids;
+    std::vector<uint32_t> begins;
+    std::vector<uint32_t> ends;
+};
+
+// An encoding kept up to date as its text is edited (encodeEditable, applyEdit): the
+// tokens plus the pieces they came from. A piece is one pretoken or special token;
+// pieceFirstTokens[i] indexes its first token and pieceAfterSpace[i] is the collapsed
+// whitespace state entering it. lookahead bounds how far past its end any piece read.
+struct EditableEncoding {
+    Encoding tokens;
+    std::vector<uint32_t> pieceBegins;
+    std::vector<uint32_t> pieceFirstTokens;
+    std::vector<uint8_t> pieceAfterSpace;
+    uint32_t textBytes = 0;
+    uint32_t lookahead = 0;
+};
+
+// `removed` bytes at offset were replaced by `inserted` bytes.
+struct TextEdit {
+    size_t offset = 0;
+    size_t removed = 0;
+    size_t inserted = 0;
+};
+
+enum class PaddingSide : uint8_t { Right, Left };
+enum class TruncationSide : uint8_t { Right, Left };
+
+struct BatchEncodeOptions {
+    size_t maxLength = 512;
+    PaddingSide paddingSide = PaddingSide::Right;
+    TruncationSide truncationSide = TruncationSide::Right;
+    bool addBos = false;
+    bool addEos = false;
+    unsigned numThreads = 0;
+};
+
+struct BatchDecodeOptions {
+    bool skipSpecialTokens = false;
+    // Replaces each ill-formed UTF-8 subsequence (e.g. a character cut off by
+    // truncation) with U+FFFD.
+    bool replaceInvalidUtf8 = false;
+    unsigned numThreads = 0;
+};
+
+// Decoded sequences back to back: sequence i is text[offsets[i], offsets[i + 1]).
+// Reusing one across decodeBatch calls avoids reallocating.
+struct DecodedBatch {
+    std::string text;
+    std::vector<size_t> offsets;
+
+    size_t size() const { return offsets.empty() ? 0 : offsets.size() - 1; }
+    std::string_view operator[](size_t i) const {
+        return std::string_view(text).substr(offsets[i], offsets[i + 1] - offsets[i]);
+    }
+};
+
+// How each pretoken is split into vocab tokens. Greedy takes the longest match at
+// each position. MinTokens takes the split with the fewest tokens, or the lowest
+// total cost when token costs are set.
+enum class EncodeMode : uint8_t { Greedy, MinTokens };
+
+enum class NormalizationForm : uint8_t { None, NFC, NFKC };
+
+// Normalization runs per pre-token inside encode. Pieces that change are matched
+// against the vocab in normalized form; their tokens report the whole piece's source
+// range as offsets unless the change preserved byte length (ASCII lowercasing).
+struct NormalizationOptions {
+    NormalizationForm form = NormalizationForm::NFC;
+    bool lowercase = false;
+    bool collapseWhitespace = false;
+};
+
+struct TrieLayoutStats {
+    size_t nodes = 0;
+    size_t bytes = 0;
+    uint64_t visits = 0;
+    // Nodes (in layout order) that take 90% of the visits, and the bytes they span.
+    size_t hotNodes = 0;
+    size_t hotBytes = 0;
+};
 
 class Tokenizer {
 public:
     Tokenizer();
+    // Binds to a model compiled in with forkenizer_embed_model(): no file is read and
+    // the vocab, perfect hash and trie are used in place. The model must outlive the
+    // tokenizer, which it does as generated static data.
+    explicit Tokenizer(const EmbeddedModel& model);
     ~Tokenizer();
     bool load(const std::string& modelDir);
     bool save(const std::string& modelDir) const;
-    std::optional<std::vector<uint32_t>> encode(const std::string& text) const;
+    std::optional<std::vector<uint32_t>> encode(std::string_view text) const;
+    std::optional<Encoding> encodeWithOffsets(std::string_view text) const;
+    // Yields the same ids as encode() but pretokenizes and matches a few pieces at a
+    // time as they are consumed, so stopping early skips the rest of the text. text
+    // and the tokenizer must outlive the generator. Yields nothing if no model is loaded.
+    Generator<uint32_t> encodeLazy(std::string_view text) const;
+    std::optional<EditableEncoding> encodeEditable(std::string_view text) const;
+    // Updates encoding, made from the text before edit, to match text, the text after
+    // it. Only pieces whose pretokenization could have seen the edited bytes are redone,
+    // up to the first piece boundary that lines up with the old encoding again; the
+    // rest are shifted. The result equals encodeEditable(text). Settings must not have
+    // changed in between. False if no model is loaded or the edit does not fit.
+    bool applyEdit(std::string_view text, const TextEdit& edit, EditableEncoding& encoding) const;
+    // Number of tokens in text, stopping at limit. Allocates nothing once the calling
+    // thread has warmed up.
+    size_t countTokens(std::string_view text, size_t limit = SIZE_MAX) const;
+    // Fills row-major [texts.size(), maxLength] id and mask buffers owned by the caller.
+    // Rows are truncated to fit <bos>/<eos>, padded with <pad>, and encoded in parallel.
+    bool encodeBatchPadded(const std::vector<std::string_view>& texts, const BatchEncodeOptions& options,
+                           uint32_t* ids, uint8_t* attentionMask, uint32_t* lengths = nullptr) const;
     std::optional<std::string> decode(const std::vector<uint32_t>& tokens) const;
+    // Decodes many sequences in parallel into one buffer. The pointer form reads
+    // sequence i from ids[idOffsets[i], idOffsets[i + 1]); rows of a padded
+    // [batch, maxLength] matrix have idOffsets[i] = i * maxLength.
+    bool decodeBatch(const std::vector<std::vector<uint32_t>>& sequences, const BatchDecodeOptions& options,
+                     DecodedBatch& out) const;
+    bool decodeBatch(const uint32_t* ids, const size_t* idOffsets, size_t count, const BatchDecodeOptions& options,
+                     DecodedBatch& out) const;
+    // Buffer variants for callers that own the memory (the C API). They write at most
+    // `capacity` elements and return the full count, so a result above capacity means
+    // the output was truncated and tells the caller how much room to retry with.
+    // Neither allocates once the calling thread's scratch has warmed up.
+    size_t encodeToBuffer(std::string_view text, uint32_t* ids, size_t capacity) const;
+    // Replaces out's contents with the ids of text, using only scratch's buffers and
+    // out's capacity: once both have grown to the largest text seen, it allocates nothing.
+    bool encodeInto(std::string_view text, std::vector<uint32_t>& out, EncodeScratch& scratch) const;
+    size_t decodeToBuffer(const uint32_t* tokens, size_t count, char* out, size_t capacity) const;
+    size_t vocabSize() const;
+    // One past the largest token id. Ids can have gaps, so size id-indexed tables by
+    // this rather than vocabSize().
+    uint32_t idCount() const;
+    // Hash of everything that decides the ids encode() returns: the vocab, pretokenizer
+    // rules, special tokens, normalization and encode mode. Stable across loads.
+    uint64_t fingerprint() const;
+    std::optional<uint32_t> tokenId(std::string_view token) const;
+    // true selects NFC with no other options.
     void setNormalization(bool enabled);
+    void setNormalization(const NormalizationOptions& options);
+    void setSpecialTokens(bool enabled);
+    // MinTokens runs a shortest-path pass over every trie match in each pretoken, in
+    // O(piece bytes x longest token). Its output still decodes to the input but is not
+    // the merge-order encoding a BPE model was trained with.
+    void setEncodeMode(EncodeMode mode);
+    // Per-id costs for MinTokens; ids past the end, and all ids when empty, cost 1.
+    void setTokenCosts(std::vector<float> costs);
+    // Overrides the rules loaded with the model; save() persists them.
+    void setPreTokenizer(const PreTokenizer& preTokenizer);
+    bool addSpecialToken(std::string_view token);
+    // Encodes the samples counting trie node visits, then rebuilds the trie with the
+    // most visited nodes and edges first. save() stores the profile with the model.
+    bool optimizeTrieLayout(const std::vector<std::string_view>& samples, TrieLayoutStats* stats = nullptr);
     bool isLoaded() const;
 
 private:
-    std::unordered_map<std::string, uint32_t> tokenToId_;
-    std::vector<std::string> idToToken_;
-    struct TrieNode {
-        std::unordered_map<unsigned char, std::unique_ptr<TrieNode>> children;
-        std::optional<uint32_t> tokenId;
-        TrieNode() : tokenId(std::nullopt) {}
-    };
-    std::unique_ptr<TrieNode> trieRoot_;
+    Vocab vocab_;
+    std::unique_ptr<FlatTrie> trie_;
+    std::vector<uint32_t> trieProfile_;
     std::vector<std::pair<std::string, std::string>> merges_;
     std::unique_ptr<PreTokenizer> preTokenizer_;
-    bool normalizationEnabled_ = false;
+    std::unique_ptr<SpecialTokenMatcher> specialTokens_;
+    std::unique_ptr<Normalizer> normalizer_;
+    std::array<uint32_t, 256> byteToId_{};
+    std::vector<uint8_t> specialIds_;
+    // Set when bound to an embedded model; save() reads its merges and profile.
+    const EmbeddedModel* embedded_ = nullptr;
+    bool specialTokensEnabled_ = true;
+    EncodeMode encodeMode_ = EncodeMode::Greedy;
+    std::vector<float> tokenCosts_;
     bool loaded_ = false;
 
+    struct EncodeState;
+    class LazyScratch;
+    friend class EncodeScratch;
+
     void buildTrie_();
+    void buildLookupTables_();
+    template <typename Sequence>
+    bool decodeBatch_(size_t count, const Sequence& sequence, const BatchDecodeOptions& options,
+                      DecodedBatch& out) const;
+    template <typename Sink>
+    void encodeText_(std::string_view text, Sink& sink) const;
+    template <typename Sink>
+    void encodeText_(std::string_view text, EncodeState& state, Sink& sink) const;
+    template <typename Sink>
+    void encodeFrom_(std::string_view text, size_t pos, bool afterSpace, Sink& sink, size_t& lookahead) const;
+    template <typename Sink>
+    void encodeSegment_(std::string_view text, size_t baseOffset, EncodeState& state, Sink& sink) const;
+    template <typename Sink>
+    void encodeSpans_(std::string_view text, size_t baseOffset, EncodeState& state, Sink& sink) const;
+    template <typename Sink>
+    void encodePiece_(std::string_view piece, size_t sourceBegin, size_t sourceEnd, bool exactOffsets,
+                      EncodeState& state, Sink& sink) const;
+};
+
+// Caller-owned encode buffers (pretoken spans, normalized pieces) for encodeInto.
+// They keep their capacity between calls; use one scratch per thread.
+class EncodeScratch {
+public:
+    EncodeScratch();
+    ~EncodeScratch();
+    EncodeScratch(EncodeScratch&&) noexcept;
+    EncodeScratch& operator=(EncodeScratch&&) noexcept;
+
+private:
+    friend class Tokenizer;
+    std::unique_ptr<Tokenizer::EncodeState> state_;
 };
 
 }
@@ -0,0 +1,64 @@
+#pragma once
+
+#include "forkenizer/Tokenizer.hpp"
+#include <atomic>
+#include <cstdint>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace forkenizer {
+
+// Serves encode/decode from an immutable Tokenizer snapshot that can be replaced
+// while readers are running. A new model is loaded and built off to the side and
+// published with one atomic pointer swap; reads in flight finish on the snapshot they
+// started with. Readers never lock: they pin an epoch, load the pointer and go.
+// Replaced snapshots are freed once every reader that could see them has left.
+class TokenizerHandle {
+public:
+    TokenizerHandle();
+    ~TokenizerHandle();
+    TokenizerHandle(const TokenizerHandle&) = delete;
+    TokenizerHandle& operator=(const TokenizerHandle&) = delete;
+
+    // Builds a Tokenizer from modelDir and publishes it. On failure the current
+    // snapshot stays in place.
+    bool load(const std::string& modelDir);
+    std::future<bool> loadAsync(const std::string& modelDir);
+    void publish(std::shared_ptr<const Tokenizer> tokenizer);
+    // Frees replaced snapshots no reader can still see; publish() does this too.
+    // Returns how many are still waiting on readers.
+    size_t reclaim();
+
+    // Keeps the current snapshot alive for as long as the caller holds it.
+    std::shared_ptr<const Tokenizer> snapshot() const;
+    // Number of snapshots published so far; 0 until the first load.
+    uint64_t version() const;
+
+    std::optional<std::vector<uint32_t>> encode(std::string_view text) const;
+    std::optional<Encoding> encodeWithOffsets(std::string_view text) const;
+    std::optional<std::string> decode(const std::vector<uint32_t>& tokens) const;
+
+private:
+    struct Snapshot {
+        std::shared_ptr<const Tokenizer> tokenizer;
+        uint64_t version;
+    };
+    struct Retired {
+        Snapshot* snapshot;
+        uint64_t epoch;
+    };
+
+    std::atomic<Snapshot*> current_{nullptr};
+    std::mutex publishMutex_;
+    std::vector<Retired> retired_;
+    uint64_t nextVersion_ = 1;
+
+    void reclaimLocked_();
+};
+
+}
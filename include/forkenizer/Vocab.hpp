@@ -0,0 +1,94 @@
+#pragma once
+
+#include "forkenizer/PerfectHash.hpp"
+#include "forkenizer/Table.hpp"
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+#include <optional>
+#include <functional>
+#include <cstdint>
+
+namespace forkenizer {
+
+struct StringViewHash {
+    using is_transparent = void;
+    size_t operator()(std::string_view s) const { return std::hash<std::string_view>{}(s); }
+};
+
+// Token strings stored once in a contiguous byte arena. Both lookup directions
+// index into the arena: ids through a span table, strings through string_view keys.
+// seal() swaps the string index for a minimal perfect hash once the vocab is static.
+class Vocab {
+public:
+    static constexpr uint32_t kNoToken = UINT32_MAX;
+
+    // Byte range of a token in the arena; ids without a token have offset kNoToken.
+    struct Span {
+        uint32_t offset = kNoToken;
+        uint32_t length = 0;
+    };
+
+    Vocab() = default;
+    Vocab(const Vocab& other);
+    Vocab& operator=(const Vocab& other);
+    Vocab(Vocab&&) noexcept = default;
+    Vocab& operator=(Vocab&&) noexcept = default;
+
+    void reserve(size_t tokenCount, size_t byteCount);
+    void set(std::string_view token, uint32_t id);
+    void clear();
+    bool seal();
+    bool sealed() const { return sealed_; }
+    // Reads a sealed vocab's tables (arena(), spans(), perfectHash()) in place; set()
+    // copies them into owned storage first.
+    void bind(std::string_view arena, const Span* spans, uint32_t idCount, PerfectHash perfect);
+
+    std::optional<uint32_t> find(std::string_view token) const {
+        if (sealed_) {
+            auto id = perfect_.candidate(token);
+            if (id.has_value() && view_(spans_[*id]) == token) {
+                return id;
+            }
+            return std::nullopt;
+        }
+        auto it = index_.find(token);
+        if (it == index_.end()) {
+            return std::nullopt;
+        }
+        return it->second;
+    }
+    bool contains(std::string_view token) const { return find(token).has_value(); }
+    bool hasId(uint32_t id) const { return id < spans_.size() && spans_[id].offset != kNoToken; }
+    std::string_view token(uint32_t id) const;
+
+    size_t size() const { return sealed_ ? perfect_.size() : index_.size(); }
+    uint32_t idCount() const { return static_cast<uint32_t>(spans_.size()); }
+    size_t arenaBytes() const { return arena_.size(); }
+    size_t memoryBytes() const;
+    std::string_view arena() const { return {arena_.data(), arena_.size()}; }
+    const Table<Span>& spans() const { return spans_; }
+    const PerfectHash& perfectHash() const { return perfect_; }
+
+    template <typename F>
+    void forEach(F&& fn) const {
+        for (uint32_t id = 0; id < spans_.size(); ++id) {
+            if (spans_[id].offset != kNoToken) {
+                fn(id, view_(spans_[id]));
+            }
+        }
+    }
+
+private:
+    Table<char> arena_;
+    Table<Span> spans_;
+    std::unordered_map<std::string_view, uint32_t, StringViewHash, std::equal_to<>> index_;
+    PerfectHash perfect_;
+    bool sealed_ = false;
+
+    std::string_view view_(Span span) const { return {arena_.data() + span.offset, span.length}; }
+    void growArena_(size_t needed);
+    void unseal_();
+};
+
+}
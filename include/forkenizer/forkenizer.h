@@ -0,0 +1,63 @@
+/* Stable C API over the forkenizer library, for FFI callers (Python, Rust, ...).
+ *
+ * Encode and decode write into caller-owned buffers, so numpy or Arrow memory can be
+ * passed straight through; the hot path does not allocate once a thread has warmed up.
+ * Functions returning int use 0 for success and a negative FORKENIZER_ERROR_* code on
+ * failure; forkenizer_last_error() then describes the failure for the calling thread.
+ * A model may be used from any number of threads at once. */
+#ifndef FORKENIZER_H
+#define FORKENIZER_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#if defined(_WIN32)
+#define FORKENIZER_API __declspec(dllexport)
+#else
+#define FORKENIZER_API __attribute__((visibility("default")))
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define FORKENIZER_OK 0
+#define FORKENIZER_ERROR_INVALID_ARGUMENT (-1)
+#define FORKENIZER_ERROR_LOAD_FAILED (-2)
+#define FORKENIZER_ERROR_BUFFER_TOO_SMALL (-3)
+#define FORKENIZER_ERROR_INTERNAL (-4) /* out of memory or another C++ exception */
+
+typedef struct forkenizer_model forkenizer_model;
+
+FORKENIZER_API const char* forkenizer_version(void);
+
+/* Returns NULL on failure. */
+FORKENIZER_API forkenizer_model* forkenizer_model_load(const char* model_dir);
+FORKENIZER_API void forkenizer_model_free(forkenizer_model* model);
+FORKENIZER_API size_t forkenizer_vocab_size(const forkenizer_model* model);
+
+/* Encodes `count` texts laid out Arrow-style: text i is
+ * data[text_offsets[i], text_offsets[i + 1]), so text_offsets has count + 1 entries.
+ * Ids of text i are written to ids[id_offsets[i], id_offsets[i + 1]) and id_offsets
+ * (count + 1 entries) is always filled in full. When the ids do not fit in
+ * ids_capacity, FORKENIZER_ERROR_BUFFER_TOO_SMALL is returned, id_offsets[count]
+ * holds the capacity needed, and the contents of ids are unspecified. */
+FORKENIZER_API int forkenizer_encode_batch(const forkenizer_model* model, const char* data,
+                                           const int64_t* text_offsets, size_t count,
+                                           uint32_t* ids, size_t ids_capacity, int64_t* id_offsets);
+
+/* Decodes `count` ids into out. *out_length receives the decoded byte length, which
+ * exceeds out_capacity when FORKENIZER_ERROR_BUFFER_TOO_SMALL is returned. No
+ * terminating NUL is written. */
+FORKENIZER_API int forkenizer_decode(const forkenizer_model* model, const uint32_t* ids, size_t count,
+                                     char* out, size_t out_capacity, size_t* out_length);
+
+/* Message for the last failed call on this thread, or "" if none. Valid until the next
+ * failing call on the same thread. */
+FORKENIZER_API const char* forkenizer_last_error(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
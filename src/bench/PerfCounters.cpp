@@ -0,0 +1,150 @@
+#include "PerfCounters.hpp"
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+namespace forkenizer {
+
+const char* perfEventName(PerfEvent event) {
+    switch (event) {
+    case PerfEvent::Cycles: return "cycles";
+    case PerfEvent::Instructions: return "instructions";
+    case PerfEvent::BranchMisses: return "branch_misses";
+    case PerfEvent::L1dMisses: return "l1d_misses";
+    case PerfEvent::LlcMisses: return "llc_misses";
+    case PerfEvent::DtlbMisses: return "dtlb_misses";
+    }
+    return "unknown";
+}
+
+#ifdef __linux__
+
+namespace {
+
+uint64_t cacheMissConfig(uint64_t cache) {
+    return cache | (PERF_COUNT_HW_CACHE_OP_READ << 8) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+}
+
+void eventConfig(PerfEvent event, perf_event_attr& attr) {
+    switch (event) {
+    case PerfEvent::Cycles:
+        attr.type = PERF_TYPE_HARDWARE;
+        attr.config = PERF_COUNT_HW_CPU_CYCLES;
+        break;
+    case PerfEvent::Instructions:
+        attr.type = PERF_TYPE_HARDWARE;
+        attr.config = PERF_COUNT_HW_INSTRUCTIONS;
+        break;
+    case PerfEvent::BranchMisses:
+        attr.type = PERF_TYPE_HARDWARE;
+        attr.config = PERF_COUNT_HW_BRANCH_MISSES;
+        break;
+    case PerfEvent::L1dMisses:
+        attr.type = PERF_TYPE_HW_CACHE;
+        attr.config = cacheMissConfig(PERF_COUNT_HW_CACHE_L1D);
+        break;
+    case PerfEvent::LlcMisses:
+        attr.type = PERF_TYPE_HW_CACHE;
+        attr.config = cacheMissConfig(PERF_COUNT_HW_CACHE_LL);
+        break;
+    case PerfEvent::DtlbMisses:
+        attr.type = PERF_TYPE_HW_CACHE;
+        attr.config = cacheMissConfig(PERF_COUNT_HW_CACHE_DTLB);
+        break;
+    }
+}
+
+}
+
+PerfCounters::~PerfCounters() {
+    for (int fd : fds_) {
+        if (fd >= 0) close(fd);
+    }
+}
+
+bool PerfCounters::open() {
+    int lastErrno = 0;
+    for (size_t i = 0; i < kPerfEventCount; ++i) {
+        if (fds_[i] >= 0) continue;
+        perf_event_attr attr;
+        std::memset(&attr, 0, sizeof(attr));
+        attr.size = sizeof(attr);
+        eventConfig(static_cast<PerfEvent>(i), attr);
+        attr.disabled = 1;
+        attr.exclude_kernel = 1;
+        attr.exclude_hv = 1;
+        attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+        const long fd = syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0);
+        if (fd < 0) {
+            lastErrno = errno;
+            continue;
+        }
+        fds_[i] = static_cast<int>(fd);
+    }
+    if (!available()) {
+        error_ = std::string("perf_event_open: ") + std::strerror(lastErrno);
+        if (lastErrno == EACCES || lastErrno == EPERM) {
+            error_ += " (see /proc/sys/kernel/perf_event_paranoid)";
+        } else if (lastErrno == ENOENT || lastErrno == EOPNOTSUPP) {
+            error_ += " (no hardware events on this host, e.g. a VM without a virtual PMU)";
+        }
+        return false;
+    }
+    return true;
+}
+
+void PerfCounters::start() {
+    for (int fd : fds_) {
+        if (fd < 0) continue;
+        ioctl(fd, PERF_EVENT_IOC_RESET, 0);
+        ioctl(fd, PERF_EVENT_IOC_ENABLE, 0);
+    }
+}
+
+PerfReading PerfCounters::stop() {
+    for (int fd : fds_) {
+        if (fd >= 0) ioctl(fd, PERF_EVENT_IOC_DISABLE, 0);
+    }
+    PerfReading reading;
+    for (size_t i = 0; i < kPerfEventCount; ++i) {
+        if (fds_[i] < 0) continue;
+        uint64_t data[3] = {0, 0, 0};  // value, time enabled, time running
+        if (read(fds_[i], data, sizeof(data)) != static_cast<ssize_t>(sizeof(data)) || data[2] == 0) {
+            continue;
+        }
+        reading.values[i] = static_cast<double>(data[0]) * static_cast<double>(data[1]) /
+                            static_cast<double>(data[2]);
+    }
+    return reading;
+}
+
+#else
+
+PerfCounters::~PerfCounters() = default;
+
+bool PerfCounters::open() {
+    error_ = "hardware counters need Linux perf_event_open";
+    return false;
+}
+
+void PerfCounters::start() {}
+
+PerfReading PerfCounters::stop() { return PerfReading{}; }
+
+#endif
+
+bool PerfCounters::available() const {
+    for (int fd : fds_) {
+        if (fd >= 0) return true;
+    }
+    return false;
+}
+
+}
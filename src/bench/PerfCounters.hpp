@@ -0,0 +1,55 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <string>
+
+namespace forkenizer {
+
+enum class PerfEvent {
+    Cycles,
+    Instructions,
+    BranchMisses,
+    L1dMisses,
+    LlcMisses,
+    DtlbMisses,
+};
+
+constexpr size_t kPerfEventCount = 6;
+
+const char* perfEventName(PerfEvent event);
+
+// One reading per event; a negative value means the counter isn't available.
+struct PerfReading {
+    std::array<double, kPerfEventCount> values;
+
+    PerfReading() { values.fill(-1.0); }
+    double operator[](PerfEvent event) const { return values[static_cast<size_t>(event)]; }
+    bool has(PerfEvent event) const { return (*this)[event] >= 0.0; }
+};
+
+// Hardware counters for the calling thread, user space only, read through
+// perf_event_open. Each event is opened on its own so a host missing one (say, no
+// dTLB event in a VM) still reports the rest; multiplexed counts are scaled by
+// enabled/running time.
+class PerfCounters {
+public:
+    PerfCounters() { fds_.fill(-1); }
+    ~PerfCounters();
+    PerfCounters(const PerfCounters&) = delete;
+    PerfCounters& operator=(const PerfCounters&) = delete;
+
+    // Returns false, with the reason in error(), when no counter could be opened.
+    bool open();
+    bool available() const;
+    const std::string& error() const { return error_; }
+
+    void start();
+    PerfReading stop();
+
+private:
+    std::array<int, kPerfEventCount> fds_;
+    std::string error_;
+};
+
+}
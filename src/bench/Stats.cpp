@@ -0,0 +1,210 @@
+#include "Stats.hpp"
+#include <algorithm>
+#include <cctype>
+#include <cmath>
+#include <cstdlib>
+#include <fstream>
+#include <sstream>
+#include <iomanip>
+
+namespace forkenizer {
+
+double median(std::vector<double> values) {
+    if (values.empty()) {
+        return 0.0;
+    }
+    std::sort(values.begin(), values.end());
+    size_t mid = values.size() / 2;
+    if (values.size() % 2 == 0) {
+        return (values[mid - 1] + values[mid]) / 2.0;
+    }
+    return values[mid];
+}
+
+double mannWhitneyGreaterPValue(const std::vector<double>& current, const std::vector<double>& baseline) {
+    const size_t n1 = current.size();
+    const size_t n2 = baseline.size();
+    if (n1 == 0 || n2 == 0) {
+        return 1.0;
+    }
+
+    std::vector<std::pair<double, bool>> pooled;
+    pooled.reserve(n1 + n2);
+    for (double v : current) pooled.emplace_back(v, true);
+    for (double v : baseline) pooled.emplace_back(v, false);
+    std::sort(pooled.begin(), pooled.end(),
+        [](const auto& a, const auto& b) { return a.first < b.first; });
+
+    const double n = static_cast<double>(n1 + n2);
+    double rankSumCurrent = 0.0;
+    double tieTerm = 0.0;
+    size_t i = 0;
+    while (i < pooled.size()) {
+        size_t j = i;
+        while (j + 1 < pooled.size() && pooled[j + 1].first == pooled[i].first) {
+            ++j;
+        }
+        double avgRank = (static_cast<double>(i + 1) + static_cast<double>(j + 1)) / 2.0;
+        for (size_t k = i; k <= j; ++k) {
+            if (pooled[k].second) rankSumCurrent += avgRank;
+        }
+        double t = static_cast<double>(j - i + 1);
+        tieTerm += t * t * t - t;
+        i = j + 1;
+    }
+
+    const double u = rankSumCurrent - static_cast<double>(n1) * (static_cast<double>(n1) + 1.0) / 2.0;
+    const double mean = static_cast<double>(n1) * static_cast<double>(n2) / 2.0;
+    const double variance = static_cast<double>(n1) * static_cast<double>(n2) / 12.0 *
+                            ((n + 1.0) - tieTerm / (n * (n - 1.0)));
+    if (variance <= 0.0) {
+        return u > mean ? 0.0 : 1.0;
+    }
+
+    const double z = (u - mean - 0.5) / std::sqrt(variance);
+    return 0.5 * std::erfc(z / std::sqrt(2.0));
+}
+
+std::vector<MetricComparison> compareResults(const BenchmarkResults& baseline, const BenchmarkResults& current,
+                                             double threshold, double alpha) {
+    std::vector<MetricComparison> comparisons;
+    for (const auto& [name, metric] : current) {
+        auto it = baseline.find(name);
+        if (it == baseline.end() || it->second.samples.empty() || metric.samples.empty()) {
+            continue;
+        }
+
+        MetricComparison cmp;
+        cmp.name = name;
+        cmp.baselineMedian = median(it->second.samples);
+        cmp.currentMedian = median(metric.samples);
+        if (cmp.baselineMedian > 0.0) {
+            cmp.relativeChange = (cmp.currentMedian - cmp.baselineMedian) / cmp.baselineMedian;
+        }
+        cmp.pValue = mannWhitneyGreaterPValue(metric.samples, it->second.samples);
+        cmp.regressed = cmp.relativeChange > threshold && cmp.pValue < alpha;
+        comparisons.push_back(cmp);
+    }
+    return comparisons;
+}
+
+bool saveResults(const std::string& path, const BenchmarkResults& results) {
+    std::ofstream out(path);
+    if (!out.is_open()) {
+        return false;
+    }
+
+    out << "{\n  \"version\": 1,\n  \"metrics\": {";
+    bool first = true;
+    for (const auto& [name, metric] : results) {
+        if (!first) out << ',';
+        first = false;
+        out << "\n    \"" << name << "\": {\"unit\": \"" << metric.unit << "\", \"samples\": [";
+        for (size_t i = 0; i < metric.samples.size(); ++i) {
+            if (i > 0) out << ", ";
+            out << std::setprecision(17) << metric.samples[i];
+        }
+        out << "]}";
+    }
+    out << "\n  }\n}\n";
+    return out.good();
+}
+
+static void skipSpace(const std::string& s, size_t& i) {
+    while (i < s.length() && std::isspace(static_cast<unsigned char>(s[i]))) ++i;
+}
+
+static bool parseString(const std::string& s, size_t& i, std::string& value) {
+    skipSpace(s, i);
+    if (i >= s.length() || s[i] != '"') return false;
+    size_t end = s.find('"', i + 1);
+    if (end == std::string::npos) return false;
+    value = s.substr(i + 1, end - i - 1);
+    i = end + 1;
+    return true;
+}
+
+static bool expect(const std::string& s, size_t& i, char c) {
+    skipSpace(s, i);
+    if (i >= s.length() || s[i] != c) return false;
+    ++i;
+    return true;
+}
+
+static bool parseMetric(const std::string& s, size_t& i, MetricSamples& metric) {
+    if (!expect(s, i, '{')) return false;
+    while (true) {
+        std::string key;
+        if (!parseString(s, i, key) || !expect(s, i, ':')) return false;
+        if (key == "unit") {
+            if (!parseString(s, i, metric.unit)) return false;
+        } else if (key == "samples") {
+            if (!expect(s, i, '[')) return false;
+            skipSpace(s, i);
+            while (i < s.length() && s[i] != ']') {
+                const char* begin = s.c_str() + i;
+                char* end = nullptr;
+                double value = std::strtod(begin, &end);
+                if (end == begin) return false;
+                metric.samples.push_back(value);
+                i += static_cast<size_t>(end - begin);
+                skipSpace(s, i);
+                if (i < s.length() && s[i] == ',') ++i;
+                skipSpace(s, i);
+            }
+            if (!expect(s, i, ']')) return false;
+        } else {
+            return false;
+        }
+        skipSpace(s, i);
+        if (i < s.length() && s[i] == ',') {
+            ++i;
+            continue;
+        }
+        return expect(s, i, '}');
+    }
+}
+
+bool loadResults(const std::string& path, BenchmarkResults& results) {
+    std::ifstream in(path);
+    if (!in.is_open()) {
+        return false;
+    }
+    std::string content((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+
+    size_t i = 0;
+    if (!expect(content, i, '{')) return false;
+    while (true) {
+        std::string key;
+        if (!parseString(content, i, key) || !expect(content, i, ':')) return false;
+        if (key == "version") {
+            skipSpace(content, i);
+            while (i < content.length() && std::isdigit(static_cast<unsigned char>(content[i]))) ++i;
+        } else if (key == "metrics") {
+            if (!expect(content, i, '{')) return false;
+            skipSpace(content, i);
+            while (i < content.length() && content[i] != '}') {
+                std::string name;
+                MetricSamples metric;
+                if (!parseString(content, i, name) || !expect(content, i, ':') || !parseMetric(content, i, metric)) {
+                    return false;
+                }
+                results[name] = std::move(metric);
+                skipSpace(content, i);
+                if (i < content.length() && content[i] == ',') ++i;
+                skipSpace(content, i);
+            }
+            if (!expect(content, i, '}')) return false;
+        } else {
+            return false;
+        }
+        skipSpace(content, i);
+        if (i < content.length() && content[i] == ',') {
+            ++i;
+            continue;
+        }
+        return expect(content, i, '}');
+    }
+}
+
+}
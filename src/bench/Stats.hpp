@@ -0,0 +1,38 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <map>
+#include <cstddef>
+
+namespace forkenizer {
+
+struct MetricSamples {
+    std::string unit;
+    std::vector<double> samples;
+};
+
+using BenchmarkResults = std::map<std::string, MetricSamples>;
+
+struct MetricComparison {
+    std::string name;
+    double baselineMedian = 0.0;
+    double currentMedian = 0.0;
+    double relativeChange = 0.0;
+    double pValue = 1.0;
+    bool regressed = false;
+};
+
+double median(std::vector<double> values);
+
+// One-sided Mann-Whitney U test: probability of observing samples at least this
+// much larger than the baseline if both came from the same distribution.
+double mannWhitneyGreaterPValue(const std::vector<double>& current, const std::vector<double>& baseline);
+
+std::vector<MetricComparison> compareResults(const BenchmarkResults& baseline, const BenchmarkResults& current,
+                                             double threshold, double alpha);
+
+bool saveResults(const std::string& path, const BenchmarkResults& results);
+bool loadResults(const std::string& path, BenchmarkResults& results);
+
+}
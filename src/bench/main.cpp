@@ -0,0 +1,529 @@
+#include "forkenizer/Tokenizer.hpp"
+#include "forkenizer/IdCodec.hpp"
+#include "forkenizer/Vocab.hpp"
+#include "../trainer/Trainer.hpp"
+#include "PerfCounters.hpp"
+#include "Stats.hpp"
+#include "forkenizer/PreTokenizer.hpp"
+#include <algorithm>
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include <unistd.h>
+
+namespace {
+
+struct BenchConfig {
+    std::vector<std::string> corpusFiles;
+    std::string modelDir;
+    std::string saveBaseline;
+    std::string compareBaseline;
+    uint32_t reps = 15;
+    size_t targetBytes = 1 << 18;
+    size_t lookupKeys = 200000;
+    double threshold = 0.05;
+    double alpha = 0.01;
+    bool counters = true;
+};
+
+// Hardware counter readings for one measured region, one per timed rep.
+struct CounterRegion {
+    std::string name;
+    size_t bytes = 0;
+    size_t tokens = 0;
+    std::vector<forkenizer::PerfReading> readings;
+};
+
+volatile size_t benchSink = 0;
+
+template <typename F>
+double timeNs(F&& fn) {
+    auto start = std::chrono::steady_clock::now();
+    fn();
+    auto end = std::chrono::steady_clock::now();
+    return static_cast<double>(std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count());
+}
+
+// Times fn and, when counters are open and readings is set, counts it as well. The
+// counter syscalls sit outside the timed span.
+template <typename F>
+double measure(forkenizer::PerfCounters& counters, std::vector<forkenizer::PerfReading>* readings, F&& fn) {
+    if (readings == nullptr || !counters.available()) {
+        return timeNs(fn);
+    }
+    counters.start();
+    double ns = timeNs(fn);
+    readings->push_back(counters.stop());
+    return ns;
+}
+
+void printUsage() {
+    std::cerr << "Usage: forkenizer-bench [--corpus <file>...] [--model <dir>] [--reps <n>] [--bytes <n>]\n"
+              << "                        [--lookup-keys <n>]\n"
+              << "                        [--save-baseline <file>] [--compare <file>]\n"
+              << "                        [--threshold <fraction>] [--alpha <p>] [--no-counters]\n"
+              << "\nExit status: 0 ok, 1 error, 2 regression against the baseline\n";
+}
+
+bool parseArgs(int argc, char* argv[], BenchConfig& config) {
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--corpus") {
+            while (i + 1 < argc && argv[i + 1][0] != '-') {
+                config.corpusFiles.push_back(argv[++i]);
+            }
+        } else if (arg == "--model" && i + 1 < argc) {
+            config.modelDir = argv[++i];
+        } else if (arg == "--reps" && i + 1 < argc) {
+            config.reps = static_cast<uint32_t>(std::stoul(argv[++i]));
+        } else if (arg == "--bytes" && i + 1 < argc) {
+            config.targetBytes = static_cast<size_t>(std::stoull(argv[++i]));
+        } else if (arg == "--lookup-keys" && i + 1 < argc) {
+            config.lookupKeys = static_cast<size_t>(std::stoull(argv[++i]));
+        } else if (arg == "--save-baseline" && i + 1 < argc) {
+            config.saveBaseline = argv[++i];
+        } else if (arg == "--compare" && i + 1 < argc) {
+            config.compareBaseline = argv[++i];
+        } else if (arg == "--threshold" && i + 1 < argc) {
+            config.threshold = std::stod(argv[++i]);
+        } else if (arg == "--alpha" && i + 1 < argc) {
+            config.alpha = std::stod(argv[++i]);
+        } else if (arg == "--no-counters") {
+            config.counters = false;
+        } else {
+            return false;
+        }
+    }
+    return config.reps > 0;
+}
+
+std::vector<std::string> defaultCorpus() {
+    const char* candidates[] = {"data_examples", "../data_examples"};
+    for (const char* dir : candidates) {
+        std::string tiny = std::string(dir) + "/tiny_corpus.txt";
+        std::string math = std::string(dir) + "/numbers_and_math_examples.txt";
+        if (std::filesystem::exists(tiny) && std::filesystem::exists(math)) {
+            return {tiny, math};
+        }
+    }
+    return {};
+}
+
+bool readCorpus(const std::vector<std::string>& files, size_t targetBytes, std::string& text) {
+    std::string corpus;
+    for (const auto& path : files) {
+        std::ifstream file(path);
+        if (!file.is_open()) {
+            std::cerr << "Failed to open corpus " << path << "\n";
+            return false;
+        }
+        corpus.append((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+    }
+    if (corpus.empty()) {
+        std::cerr << "Corpus is empty\n";
+        return false;
+    }
+
+    text.clear();
+    text.reserve(targetBytes + corpus.size());
+    while (text.size() < targetBytes) {
+        text += corpus;
+    }
+    return true;
+}
+
+std::vector<std::string> syntheticTokens(size_t count) {
+    std::vector<std::string> tokens;
+    tokens.reserve(count);
+    uint64_t state = 0x2545f4914f6cdd1dULL;
+    for (size_t i = 0; i < count; ++i) {
+        state ^= state << 13;
+        state ^= state >> 7;
+        state ^= state << 17;
+        std::string token = std::to_string(i) + "_";
+        size_t extra = 1 + state % 10;
+        for (size_t j = 0; j < extra; ++j) {
+            token += static_cast<char>('a' + (state >> (j * 5)) % 26);
+        }
+        tokens.push_back(std::move(token));
+    }
+    return tokens;
+}
+
+// Compares the sealed Vocab (minimal perfect hash) against the std::unordered_map the
+// tokenizer used before, on half hits and half misses like encode's probe loop.
+void benchVocabLookup(const BenchConfig& config, forkenizer::BenchmarkResults& results) {
+    if (config.lookupKeys == 0) {
+        return;
+    }
+
+    std::vector<std::string> tokens = syntheticTokens(config.lookupKeys);
+    std::vector<std::string> queries;
+    queries.reserve(tokens.size() * 2);
+    for (const auto& token : tokens) {
+        queries.push_back(token);
+        queries.push_back(token + "#");
+    }
+
+    auto& mphBuild = results["vocab_mph_build_ms"];
+    auto& mapBuild = results["vocab_map_build_ms"];
+    auto& mphLookup = results["vocab_mph_lookup_ns"];
+    auto& mapLookup = results["vocab_map_lookup_ns"];
+    mphBuild.unit = "ms";
+    mapBuild.unit = "ms";
+    mphLookup.unit = "ns/lookup";
+    mapLookup.unit = "ns/lookup";
+
+    forkenizer::Vocab vocab;
+    std::unordered_map<std::string, uint32_t> map;
+    for (uint32_t rep = 0; rep <= config.reps; ++rep) {
+        vocab.clear();
+        double ns = timeNs([&] {
+            for (uint32_t id = 0; id < tokens.size(); ++id) {
+                vocab.set(tokens[id], id);
+            }
+            vocab.seal();
+        });
+        if (rep > 0) mphBuild.samples.push_back(ns / 1e6);
+
+        map.clear();
+        ns = timeNs([&] {
+            std::unordered_map<std::string, uint32_t> fresh;
+            for (uint32_t id = 0; id < tokens.size(); ++id) {
+                fresh[tokens[id]] = id;
+            }
+            map = std::move(fresh);
+        });
+        if (rep > 0) mapBuild.samples.push_back(ns / 1e6);
+    }
+
+    for (uint32_t rep = 0; rep <= config.reps; ++rep) {
+        double ns = timeNs([&] {
+            size_t hits = 0;
+            for (const auto& query : queries) {
+                hits += vocab.find(query).has_value();
+            }
+            benchSink = benchSink + hits;
+        });
+        if (rep > 0) mphLookup.samples.push_back(ns / static_cast<double>(queries.size()));
+
+        ns = timeNs([&] {
+            size_t hits = 0;
+            for (const auto& query : queries) {
+                hits += map.find(query) != map.end();
+            }
+            benchSink = benchSink + hits;
+        });
+        if (rep > 0) mapLookup.samples.push_back(ns / static_cast<double>(queries.size()));
+    }
+
+    size_t mapBytes = map.bucket_count() * sizeof(void*);
+    for (const auto& [key, id] : map) {
+        mapBytes += sizeof(void*) * 2 + sizeof(std::string) + sizeof(uint64_t) +
+                    (key.size() >= sizeof(std::string) - 1 ? key.capacity() + 1 : 0);
+    }
+    std::cout << "vocab lookup keys: " << tokens.size() << ", perfect hash " << std::fixed << std::setprecision(1)
+              << static_cast<double>(vocab.memoryBytes()) / static_cast<double>(tokens.size())
+              << " bytes/key (with arena), unordered_map "
+              << static_cast<double>(mapBytes) / static_cast<double>(tokens.size()) << " bytes/key\n";
+}
+
+void printResults(const forkenizer::BenchmarkResults& results) {
+    std::cout << std::left << std::setw(24) << "metric" << std::right << std::setw(14) << "median"
+              << std::setw(14) << "min" << "  unit\n";
+    for (const auto& [name, metric] : results) {
+        if (metric.samples.empty()) continue;
+        double minValue = *std::min_element(metric.samples.begin(), metric.samples.end());
+        std::cout << std::left << std::setw(24) << name << std::right << std::fixed << std::setprecision(3)
+                  << std::setw(14) << forkenizer::median(metric.samples)
+                  << std::setw(14) << minValue << "  " << metric.unit << "\n";
+    }
+}
+
+// Medians per input byte and per output token, plus IPC, for every counter the host
+// provided.
+void printCounters(const std::vector<CounterRegion>& regions) {
+    if (std::all_of(regions.begin(), regions.end(), [](const CounterRegion& region) { return region.readings.empty(); })) {
+        return;
+    }
+    std::cout << "\n" << std::left << std::setw(32) << "counter" << std::right << std::setw(14) << "per byte"
+              << std::setw(14) << "per token" << "\n";
+    for (const auto& region : regions) {
+        if (region.readings.empty()) continue;
+        for (size_t e = 0; e < forkenizer::kPerfEventCount; ++e) {
+            const auto event = static_cast<forkenizer::PerfEvent>(e);
+            std::vector<double> perByte, perToken;
+            for (const auto& reading : region.readings) {
+                if (!reading.has(event)) continue;
+                perByte.push_back(reading[event] / static_cast<double>(std::max<size_t>(region.bytes, 1)));
+                perToken.push_back(reading[event] / static_cast<double>(std::max<size_t>(region.tokens, 1)));
+            }
+            if (perByte.empty()) continue;
+            std::cout << std::left << std::setw(32) << region.name + " " + forkenizer::perfEventName(event)
+                      << std::right << std::fixed << std::setprecision(4) << std::setw(14)
+                      << forkenizer::median(perByte) << std::setw(14) << forkenizer::median(perToken) << "\n";
+        }
+        std::vector<double> ipc;
+        for (const auto& reading : region.readings) {
+            if (reading.has(forkenizer::PerfEvent::Cycles) && reading.has(forkenizer::PerfEvent::Instructions) &&
+                reading[forkenizer::PerfEvent::Cycles] > 0.0) {
+                ipc.push_back(reading[forkenizer::PerfEvent::Instructions] / reading[forkenizer::PerfEvent::Cycles]);
+            }
+        }
+        if (!ipc.empty()) {
+            std::cout << std::left << std::setw(32) << region.name + " ipc" << std::right << std::fixed
+                      << std::setprecision(4) << std::setw(14) << forkenizer::median(ipc) << "\n";
+        }
+    }
+}
+
+// Per-byte counts go into the results so --compare also catches a region that now
+// executes more instructions or misses more, not just one that got slower.
+void addCounterResults(const std::vector<CounterRegion>& regions, forkenizer::BenchmarkResults& results) {
+    for (const auto& region : regions) {
+        for (size_t e = 0; e < forkenizer::kPerfEventCount; ++e) {
+            const auto event = static_cast<forkenizer::PerfEvent>(e);
+            forkenizer::MetricSamples metric;
+            metric.unit = std::string(forkenizer::perfEventName(event)) + "/byte";
+            for (const auto& reading : region.readings) {
+                if (reading.has(event)) {
+                    metric.samples.push_back(reading[event] / static_cast<double>(std::max<size_t>(region.bytes, 1)));
+                }
+            }
+            if (!metric.samples.empty()) {
+                results[region.name + "_" + forkenizer::perfEventName(event) + "_per_byte"] = std::move(metric);
+            }
+        }
+    }
+}
+
+int compareAgainstBaseline(const BenchConfig& config, const forkenizer::BenchmarkResults& current) {
+    forkenizer::BenchmarkResults baseline;
+    if (!forkenizer::loadResults(config.compareBaseline, baseline)) {
+        std::cerr << "Failed to read baseline " << config.compareBaseline << "\n";
+        return 1;
+    }
+
+    auto comparisons = forkenizer::compareResults(baseline, current, config.threshold, config.alpha);
+    bool anyRegression = false;
+    std::cout << "\nComparison against " << config.compareBaseline << " (threshold "
+              << config.threshold * 100.0 << "%, alpha " << config.alpha << ")\n";
+    for (const auto& cmp : comparisons) {
+        std::cout << std::left << std::setw(24) << cmp.name << std::right << std::fixed << std::setprecision(3)
+                  << std::setw(14) << cmp.baselineMedian << " -> " << std::setw(14) << cmp.currentMedian
+                  << std::showpos << std::setw(10) << cmp.relativeChange * 100.0 << "%" << std::noshowpos
+                  << "  p=" << std::setprecision(4) << cmp.pValue
+                  << (cmp.regressed ? "  REGRESSION" : "") << "\n";
+        anyRegression = anyRegression || cmp.regressed;
+    }
+    return anyRegression ? 2 : 0;
+}
+
+}
+
+int main(int argc, char* argv[]) {
+    BenchConfig config;
+    if (!parseArgs(argc, argv, config)) {
+        printUsage();
+        return 1;
+    }
+    if (config.corpusFiles.empty()) {
+        config.corpusFiles = defaultCorpus();
+    }
+    if (config.corpusFiles.empty()) {
+        std::cerr << "No corpus found. Use --corpus <file>...\n";
+        return 1;
+    }
+
+    std::string text;
+    if (!readCorpus(config.corpusFiles, config.targetBytes, text)) {
+        return 1;
+    }
+
+    std::filesystem::path workDir = std::filesystem::temp_directory_path() /
+                                    ("forkenizer-bench-" + std::to_string(getpid()));
+    std::string trainDir = (workDir / "model").string();
+
+    forkenizer::BenchmarkResults results;
+    auto& train = results["train_ms"];
+    auto& load = results["load_ms"];
+    auto& encode = results["encode_ns_per_byte"];
+    auto& decode = results["decode_ns_per_token"];
+    train.unit = "ms";
+    load.unit = "ms";
+    encode.unit = "ns/byte";
+    decode.unit = "ns/token";
+
+    forkenizer::Trainer trainer;
+    for (uint32_t rep = 0; rep <= config.reps; ++rep) {
+        bool ok = true;
+        double ns = timeNs([&] { ok = trainer.train(config.corpusFiles, trainDir, 512, 128); });
+        if (!ok) {
+            std::cerr << "Training failed\n";
+            std::filesystem::remove_all(workDir);
+            return 1;
+        }
+        if (rep > 0) train.samples.push_back(ns / 1e6);
+    }
+
+    std::string modelDir = config.modelDir.empty() ? trainDir : config.modelDir;
+    forkenizer::Tokenizer tokenizer;
+    for (uint32_t rep = 0; rep <= config.reps; ++rep) {
+        forkenizer::Tokenizer fresh;
+        bool ok = true;
+        double ns = timeNs([&] { ok = fresh.load(modelDir); });
+        if (!ok) {
+            std::cerr << "Failed to load model from " << modelDir << "\n";
+            std::filesystem::remove_all(workDir);
+            return 1;
+        }
+        if (rep > 0) load.samples.push_back(ns / 1e6);
+    }
+    tokenizer.load(modelDir);
+
+    forkenizer::PerfCounters counters;
+    if (config.counters && !counters.open()) {
+        std::cout << "hardware counters unavailable, wall clock only: " << counters.error() << "\n";
+    }
+    std::vector<CounterRegion> regions(4);
+    CounterRegion& pretokenizeRegion = regions[0];
+    CounterRegion& encodeRegion = regions[1];
+    CounterRegion& offsetsRegion = regions[2];
+    CounterRegion& decodeRegion = regions[3];
+    pretokenizeRegion.name = "pretokenize";
+    encodeRegion.name = "encode";
+    offsetsRegion.name = "encode_offsets";
+    decodeRegion.name = "decode";
+
+    auto& pretokenize = results["pretokenize_ns_per_byte"];
+    pretokenize.unit = "ns/byte";
+    forkenizer::PreTokenizer preTokenizer;
+    std::vector<forkenizer::PreTokenSpan> spans;
+    for (uint32_t rep = 0; rep <= config.reps; ++rep) {
+        double ns = measure(counters, rep > 0 ? &pretokenizeRegion.readings : nullptr, [&] {
+            preTokenizer.preTokenizeSpans(text, spans);
+            benchSink = benchSink + spans.size();
+        });
+        if (rep > 0) pretokenize.samples.push_back(ns / static_cast<double>(text.size()));
+    }
+    pretokenizeRegion.bytes = text.size();
+    pretokenizeRegion.tokens = spans.size();
+
+    std::vector<uint32_t> ids;
+    for (uint32_t rep = 0; rep <= config.reps; ++rep) {
+        double ns = measure(counters, rep > 0 ? &encodeRegion.readings : nullptr, [&] {
+            auto tokens = tokenizer.encode(text);
+            benchSink = benchSink + tokens->size();
+            if (rep == 0) ids = std::move(*tokens);
+        });
+        if (rep > 0) encode.samples.push_back(ns / static_cast<double>(text.size()));
+    }
+
+    auto& encodeOffsets = results["encode_offsets_ns_per_byte"];
+    encodeOffsets.unit = "ns/byte";
+    for (uint32_t rep = 0; rep <= config.reps; ++rep) {
+        double ns = measure(counters, rep > 0 ? &offsetsRegion.readings : nullptr, [&] {
+            auto encoding = tokenizer.encodeWithOffsets(text);
+            benchSink = benchSink + encoding->ends.size();
+        });
+        if (rep > 0) encodeOffsets.samples.push_back(ns / static_cast<double>(text.size()));
+    }
+
+    // Same text split for the fewest tokens instead of greedily.
+    auto& encodeMinTokens = results["encode_min_tokens_ns_per_byte"];
+    encodeMinTokens.unit = "ns/byte";
+    size_t minTokens = 0;
+    tokenizer.setEncodeMode(forkenizer::EncodeMode::MinTokens);
+    for (uint32_t rep = 0; rep <= config.reps; ++rep) {
+        double ns = timeNs([&] {
+            auto tokens = tokenizer.encode(text);
+            minTokens = tokens->size();
+        });
+        if (rep > 0) encodeMinTokens.samples.push_back(ns / static_cast<double>(text.size()));
+    }
+    tokenizer.setEncodeMode(forkenizer::EncodeMode::Greedy);
+
+    // One byte typed into the middle of the corpus and deleted again, re-encoding only
+    // around the edit; what remains is shifting the offsets after it.
+    auto& applyEdit = results["apply_edit_us"];
+    applyEdit.unit = "us";
+    if (auto editable = tokenizer.encodeEditable(text)) {
+        std::string edited = text;
+        const size_t middle = text.size() / 2;
+        for (uint32_t rep = 0; rep <= config.reps; ++rep) {
+            edited.insert(middle, 1, 'x');
+            double ns = timeNs([&] {
+                bool ok = tokenizer.applyEdit(edited, forkenizer::TextEdit{middle, 0, 1}, *editable);
+                benchSink = benchSink + ok;
+            });
+            edited.erase(middle, 1);
+            ns += timeNs([&] {
+                bool ok = tokenizer.applyEdit(edited, forkenizer::TextEdit{middle, 1, 0}, *editable);
+                benchSink = benchSink + ok;
+            });
+            if (rep > 0) applyEdit.samples.push_back(ns / 2000.0);
+        }
+    }
+
+    for (uint32_t rep = 0; rep <= config.reps; ++rep) {
+        double ns = measure(counters, rep > 0 ? &decodeRegion.readings : nullptr, [&] {
+            auto decoded = tokenizer.decode(ids);
+            benchSink = benchSink + decoded->size();
+        });
+        if (rep > 0 && !ids.empty()) decode.samples.push_back(ns / static_cast<double>(ids.size()));
+    }
+    for (CounterRegion* region : {&encodeRegion, &offsetsRegion, &decodeRegion}) {
+        region->bytes = text.size();
+        region->tokens = ids.size();
+    }
+
+    std::filesystem::remove_all(workDir);
+
+    // Packed id streams trade disk and page cache for this decode step.
+    auto& idDecode = results["id_decode_ns_per_id"];
+    idDecode.unit = "ns/id";
+    std::vector<uint8_t> packed(forkenizer::maxEncodedIdBytes(ids.size()));
+    packed.resize(forkenizer::encodeIds(ids.data(), ids.size(), packed.data()));
+    std::vector<uint32_t> unpacked(ids.size());
+    for (uint32_t rep = 0; rep <= config.reps; ++rep) {
+        double ns = timeNs([&] {
+            bool ok = forkenizer::decodeIds(packed.data(), packed.size(), unpacked.data(), unpacked.size());
+            benchSink = benchSink + ok;
+        });
+        if (rep > 0 && !ids.empty()) idDecode.samples.push_back(ns / static_cast<double>(ids.size()));
+    }
+
+    benchVocabLookup(config, results);
+
+    std::cout << "corpus bytes: " << text.size() << ", tokens: " << ids.size()
+              << ", packed id bytes: " << packed.size() << ", reps: " << config.reps << "\n";
+    if (!text.empty()) {
+        const double bytes = static_cast<double>(text.size());
+        std::cout << "tokens/byte: greedy " << ids.size() / bytes << ", min-tokens " << minTokens / bytes;
+        if (!ids.empty()) {
+            std::cout << " (" << 100.0 * (static_cast<double>(minTokens) / ids.size() - 1.0) << "%)";
+        }
+        std::cout << "\n";
+    }
+    printResults(results);
+    printCounters(regions);
+    addCounterResults(regions, results);
+
+    if (!config.saveBaseline.empty()) {
+        if (!forkenizer::saveResults(config.saveBaseline, results)) {
+            std::cerr << "Failed to write baseline " << config.saveBaseline << "\n";
+            return 1;
+        }
+        std::cout << "Baseline saved to " << config.saveBaseline << "\n";
+    }
+
+    if (!config.compareBaseline.empty()) {
+        return compareAgainstBaseline(config, results);
+    }
+    return 0;
+}
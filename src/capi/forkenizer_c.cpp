@@ -0,0 +1,125 @@
+#include "forkenizer/forkenizer.h"
+#include "forkenizer/Tokenizer.hpp"
+#include <cstring>
+#include <exception>
+#include <new>
+
+struct forkenizer_model {
+    forkenizer::Tokenizer tokenizer;
+};
+
+namespace {
+
+thread_local char lastError[256] = "";
+
+int fail(int code, const char* message) {
+    std::strncpy(lastError, message, sizeof(lastError) - 1);
+    lastError[sizeof(lastError) - 1] = '\0';
+    return code;
+}
+
+// No exception may unwind into an FFI caller; map whatever escapes to an error code.
+int failCurrentException() {
+    try {
+        throw;
+    } catch (const std::bad_alloc&) {
+        return fail(FORKENIZER_ERROR_INTERNAL, "out of memory");
+    } catch (const std::exception& e) {
+        return fail(FORKENIZER_ERROR_INTERNAL, e.what());
+    } catch (...) {
+        return fail(FORKENIZER_ERROR_INTERNAL, "unknown exception");
+    }
+}
+
+}
+
+extern "C" {
+
+const char* forkenizer_version(void) {
+    return FORKENIZER_VERSION;
+}
+
+forkenizer_model* forkenizer_model_load(const char* model_dir) {
+    if (model_dir == nullptr) {
+        fail(FORKENIZER_ERROR_INVALID_ARGUMENT, "model_dir is NULL");
+        return nullptr;
+    }
+    forkenizer_model* model = nullptr;
+    try {
+        model = new forkenizer_model();
+        if (!model->tokenizer.load(model_dir)) {
+            delete model;
+            fail(FORKENIZER_ERROR_LOAD_FAILED, "failed to load model");
+            return nullptr;
+        }
+        return model;
+    } catch (...) {
+        delete model;
+        failCurrentException();
+        return nullptr;
+    }
+}
+
+void forkenizer_model_free(forkenizer_model* model) {
+    delete model;
+}
+
+size_t forkenizer_vocab_size(const forkenizer_model* model) {
+    return model != nullptr ? model->tokenizer.vocabSize() : 0;
+}
+
+int forkenizer_encode_batch(const forkenizer_model* model, const char* data, const int64_t* text_offsets,
+                            size_t count, uint32_t* ids, size_t ids_capacity, int64_t* id_offsets) {
+    if (model == nullptr || text_offsets == nullptr || id_offsets == nullptr ||
+        (data == nullptr && count > 0 && text_offsets[count] > text_offsets[0]) ||
+        (ids == nullptr && ids_capacity > 0)) {
+        return fail(FORKENIZER_ERROR_INVALID_ARGUMENT, "NULL model, offsets or buffer");
+    }
+
+    size_t written = 0;
+    id_offsets[0] = 0;
+    try {
+        for (size_t i = 0; i < count; ++i) {
+            const int64_t begin = text_offsets[i];
+            const int64_t end = text_offsets[i + 1];
+            if (begin < 0 || end < begin) {
+                return fail(FORKENIZER_ERROR_INVALID_ARGUMENT, "text_offsets must be non-decreasing");
+            }
+            std::string_view text(data + begin, static_cast<size_t>(end - begin));
+            const size_t room = written < ids_capacity ? ids_capacity - written : 0;
+            written += model->tokenizer.encodeToBuffer(text, room > 0 ? ids + written : nullptr, room);
+            id_offsets[i + 1] = static_cast<int64_t>(written);
+        }
+    } catch (...) {
+        return failCurrentException();
+    }
+
+    if (written > ids_capacity) {
+        return fail(FORKENIZER_ERROR_BUFFER_TOO_SMALL, "ids buffer too small; see id_offsets[count]");
+    }
+    return FORKENIZER_OK;
+}
+
+int forkenizer_decode(const forkenizer_model* model, const uint32_t* ids, size_t count, char* out,
+                      size_t out_capacity, size_t* out_length) {
+    if (model == nullptr || out_length == nullptr || (ids == nullptr && count > 0) ||
+        (out == nullptr && out_capacity > 0)) {
+        return fail(FORKENIZER_ERROR_INVALID_ARGUMENT, "NULL model, ids or buffer");
+    }
+
+    try {
+        *out_length = model->tokenizer.decodeToBuffer(ids, count, out, out_capacity);
+    } catch (...) {
+        return failCurrentException();
+    }
+    if (*out_length > out_capacity) {
+        return fail(FORKENIZER_ERROR_BUFFER_TOO_SMALL, "output buffer too small; see out_length");
+    }
+    return FORKENIZER_OK;
+}
+
+const char* forkenizer_last_error(void) {
+    return lastError;
+}
+
+}
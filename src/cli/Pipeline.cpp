@@ -0,0 +1,356 @@
+#include "Pipeline.hpp"
+#include "forkenizer/IdCodec.hpp"
+#include "../tokenizer/Unicode.hpp"
+#include "../util/Parallel.hpp"
+#include "../util/SpscQueue.hpp"
+#include <atomic>
+#include <charconv>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <thread>
+#include <vector>
+
+namespace forkenizer {
+
+namespace {
+
+void skipSpace(std::string_view s, size_t& i) {
+    while (i < s.size() && (s[i] == ' ' || s[i] == '\t' || s[i] == '\r' || s[i] == '\n')) ++i;
+}
+
+int hexValue(char c) {
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+    return -1;
+}
+
+bool readHex4(std::string_view s, size_t i, uint32_t& value) {
+    if (i + 4 > s.size()) return false;
+    value = 0;
+    for (size_t k = 0; k < 4; ++k) {
+        int h = hexValue(s[i + k]);
+        if (h < 0) return false;
+        value = (value << 4) | static_cast<uint32_t>(h);
+    }
+    return true;
+}
+
+// Parses the JSON string starting at the opening quote s[i]; appends the unescaped
+// value to out (when non-null) and leaves i after the closing quote.
+bool parseString(std::string_view s, size_t& i, std::string* out) {
+    ++i;
+    while (i < s.size()) {
+        const char c = s[i];
+        if (c == '"') {
+            ++i;
+            return true;
+        }
+        if (c != '\\') {
+            size_t run = i;
+            while (run < s.size() && s[run] != '"' && s[run] != '\\') ++run;
+            if (out) out->append(s.data() + i, run - i);
+            i = run;
+            continue;
+        }
+        if (i + 1 >= s.size()) return false;
+        const char e = s[i + 1];
+        i += 2;
+        char simple = 0;
+        switch (e) {
+            case '"': simple = '"'; break;
+            case '\\': simple = '\\'; break;
+            case '/': simple = '/'; break;
+            case 'b': simple = '\b'; break;
+            case 'f': simple = '\f'; break;
+            case 'n': simple = '\n'; break;
+            case 'r': simple = '\r'; break;
+            case 't': simple = '\t'; break;
+            case 'u': {
+                uint32_t cp;
+                if (!readHex4(s, i, cp)) return false;
+                i += 4;
+                if (cp >= 0xD800 && cp <= 0xDBFF) {
+                    uint32_t low;
+                    if (i + 1 < s.size() && s[i] == '\\' && s[i + 1] == 'u' && readHex4(s, i + 2, low) &&
+                        low >= 0xDC00 && low <= 0xDFFF) {
+                        cp = 0x10000 + ((cp - 0xD800) << 10) + (low - 0xDC00);
+                        i += 6;
+                    } else {
+                        cp = 0xFFFD;
+                    }
+                } else if (cp >= 0xDC00 && cp <= 0xDFFF) {
+                    cp = 0xFFFD;
+                }
+                if (out) appendUtf8(cp, *out);
+                continue;
+            }
+            default:
+                return false;
+        }
+        if (out) *out += simple;
+    }
+    return false;
+}
+
+// Skips any JSON value starting at s[i].
+bool skipValue(std::string_view s, size_t& i) {
+    if (i >= s.size()) return false;
+    if (s[i] == '"') return parseString(s, i, nullptr);
+    if (s[i] != '{' && s[i] != '[') {
+        while (i < s.size() && s[i] != ',' && s[i] != '}' && s[i] != ']' && s[i] != ' ' && s[i] != '\t' &&
+               s[i] != '\r' && s[i] != '\n') {
+            ++i;
+        }
+        return true;
+    }
+    size_t depth = 0;
+    while (i < s.size()) {
+        const char c = s[i];
+        if (c == '"') {
+            if (!parseString(s, i, nullptr)) return false;
+            continue;
+        }
+        if (c == '{' || c == '[') ++depth;
+        if (c == '}' || c == ']') {
+            if (--depth == 0) {
+                ++i;
+                return true;
+            }
+        }
+        ++i;
+    }
+    return false;
+}
+
+using BatchPtr = std::unique_ptr<RecordBatch>;
+
+void encodeBatch(const Tokenizer& tokenizer, RecordBatch& batch) {
+    batch.idOffsets.assign(1, 0);
+    size_t written = 0;
+    for (size_t r = 0; r < batch.size(); ++r) {
+        std::string_view text = batch.recordText(r);
+        size_t room = batch.ids.size() - written;
+        size_t count = tokenizer.encodeToBuffer(text, batch.ids.data() + written, room);
+        if (count > room) {
+            batch.ids.resize(std::max(batch.ids.size() * 2, written + count));
+            tokenizer.encodeToBuffer(text, batch.ids.data() + written, count);
+        }
+        written += count;
+        batch.idOffsets.push_back(written);
+    }
+}
+
+bool writeBatch(const RecordBatch& batch, IdFormat format, std::string& buffer, std::ostream& out,
+                IdStreamWriter& packed) {
+    if (format == IdFormat::Packed) {
+        for (size_t r = 0; r < batch.size(); ++r) {
+            const size_t begin = batch.idOffsets[r];
+            if (!packed.addDocument(batch.ids.data() + begin, batch.idOffsets[r + 1] - begin)) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    buffer.clear();
+    for (size_t r = 0; r < batch.size(); ++r) {
+        const size_t begin = batch.idOffsets[r];
+        const size_t end = batch.idOffsets[r + 1];
+        if (format == IdFormat::Binary) {
+            const uint32_t count = static_cast<uint32_t>(end - begin);
+            buffer.append(reinterpret_cast<const char*>(&count), sizeof(count));
+            buffer.append(reinterpret_cast<const char*>(batch.ids.data() + begin), (end - begin) * sizeof(uint32_t));
+            continue;
+        }
+        char digits[16];
+        for (size_t k = begin; k < end; ++k) {
+            if (k > begin) buffer += ' ';
+            auto result = std::to_chars(digits, digits + sizeof(digits), batch.ids[k]);
+            buffer.append(digits, result.ptr);
+        }
+        buffer += '\n';
+    }
+    out.write(buffer.data(), static_cast<std::streamsize>(buffer.size()));
+    return static_cast<bool>(out);
+}
+
+// Leaves i at the value of the top-level member `field` of the object in `line`.
+bool findJsonField(std::string_view line, std::string_view field, size_t& i) {
+    i = 0;
+    skipSpace(line, i);
+    if (i >= line.size() || line[i] != '{') return false;
+    ++i;
+
+    std::string key;
+    while (true) {
+        skipSpace(line, i);
+        if (i >= line.size() || line[i] != '"') return false;
+        key.clear();
+        if (!parseString(line, i, &key)) return false;
+        skipSpace(line, i);
+        if (i >= line.size() || line[i] != ':') return false;
+        ++i;
+        skipSpace(line, i);
+        if (key == field) {
+            return i < line.size();
+        }
+        if (!skipValue(line, i)) return false;
+        skipSpace(line, i);
+        if (i >= line.size() || line[i] != ',') return false;
+        ++i;
+    }
+}
+
+}
+
+bool extractJsonStringField(std::string_view line, std::string_view field, std::string& out) {
+    size_t i;
+    return findJsonField(line, field, i) && line[i] == '"' && parseString(line, i, &out);
+}
+
+bool extractJsonNumberField(std::string_view line, std::string_view field, uint64_t& out) {
+    size_t i;
+    if (!findJsonField(line, field, i)) return false;
+    auto result = std::from_chars(line.data() + i, line.data() + line.size(), out);
+    return result.ec == std::errc();
+}
+
+void appendJsonString(std::string& out, std::string_view value) {
+    out += '"';
+    for (unsigned char c : value) {
+        if (c == '"' || c == '\\') {
+            out += '\\';
+            out += static_cast<char>(c);
+        } else if (c < 0x20) {
+            char escaped[8];
+            std::snprintf(escaped, sizeof(escaped), "\\u%04x", c);
+            out += escaped;
+        } else {
+            out += static_cast<char>(c);
+        }
+    }
+    out += '"';
+}
+
+bool runOrderedEncode(const Tokenizer& tokenizer, unsigned threads, size_t queueDepth,
+                      const std::function<bool(RecordBatch&)>& fill,
+                      const std::function<bool(const RecordBatch&)>& drain) {
+    const unsigned workers = resolveThreadCount(threads);
+    std::vector<std::unique_ptr<SpscQueue<BatchPtr>>> toWorkers;
+    std::vector<std::unique_ptr<SpscQueue<BatchPtr>>> toWriter;
+    for (unsigned w = 0; w < workers; ++w) {
+        toWorkers.push_back(std::make_unique<SpscQueue<BatchPtr>>(queueDepth));
+        toWriter.push_back(std::make_unique<SpscQueue<BatchPtr>>(queueDepth));
+    }
+    SpscQueue<BatchPtr> recycled(workers * queueDepth * 2 + 2);
+    std::atomic<bool> cancelled{false};
+
+    std::vector<std::thread> pool;
+    for (unsigned w = 0; w < workers; ++w) {
+        pool.emplace_back([&, w] {
+            while (BatchPtr batch = toWorkers[w]->pop()) {
+                encodeBatch(tokenizer, *batch);
+                toWriter[w]->push(std::move(batch));
+            }
+            toWriter[w]->push(nullptr);
+        });
+    }
+
+    pool.emplace_back([&] {
+        size_t next = 0;
+        bool more = true;
+        while (more && !cancelled.load(std::memory_order_relaxed)) {
+            BatchPtr batch;
+            if (!recycled.tryPop(batch)) batch = std::make_unique<RecordBatch>();
+            batch->reset();
+            more = fill(*batch);
+            if (batch->size() == 0) {
+                continue;
+            }
+            toWorkers[next]->push(std::move(batch));
+            next = (next + 1) % workers;
+        }
+        for (unsigned w = 0; w < workers; ++w) {
+            toWorkers[(next + w) % workers]->push(nullptr);
+        }
+    });
+
+    bool ok = true;
+    for (size_t next = 0;; next = (next + 1) % workers) {
+        BatchPtr batch = toWriter[next]->pop();
+        if (!batch) break;
+        if (ok && !drain(*batch)) {
+            // Keep draining so the reader and workers can run to their end markers.
+            ok = false;
+            cancelled.store(true, std::memory_order_relaxed);
+        }
+        recycled.tryPush(batch);
+    }
+    for (auto& thread : pool) {
+        thread.join();
+    }
+    return ok;
+}
+
+bool runEncodePipeline(const Tokenizer& tokenizer, const PipelineOptions& options, PipelineStats& stats) {
+    std::ifstream inputFile;
+    std::istream* input = &std::cin;
+    if (options.inputPath != "-") {
+        inputFile.open(options.inputPath, std::ios::binary);
+        if (!inputFile.is_open()) return false;
+        input = &inputFile;
+    }
+    std::ofstream outputFile;
+    std::ostream* output = &std::cout;
+    if (!options.outputPath.empty() && options.outputPath != "-") {
+        outputFile.open(options.outputPath, std::ios::binary);
+        if (!outputFile.is_open()) return false;
+        output = &outputFile;
+    }
+
+    const size_t batchRecords = std::max<size_t>(options.batchRecords, 1);
+    uint64_t skipped = 0;
+    std::string line;
+    auto fill = [&](RecordBatch& batch) {
+        while (batch.size() < batchRecords) {
+            if (!std::getline(*input, line)) {
+                return false;
+            }
+            bool present = true;
+            if (options.jsonl) {
+                const size_t before = batch.text.size();
+                present = extractJsonStringField(line, options.field, batch.text);
+                if (!present) {
+                    batch.text.resize(before);
+                    ++skipped;
+                }
+            } else {
+                if (!line.empty() && line.back() == '\r') line.pop_back();
+                batch.text += line;
+            }
+            batch.addRecord(present);
+        }
+        return true;
+    };
+
+    std::string buffer;
+    IdStreamWriter packed(*output);
+    auto drain = [&](const RecordBatch& batch) {
+        stats.records += batch.size();
+        stats.tokens += batch.idOffsets.back();
+        return writeBatch(batch, options.format, buffer, *output, packed);
+    };
+
+    bool ok = runOrderedEncode(tokenizer, options.threads, options.queueDepth, fill, drain);
+    stats.skipped = skipped;
+    if (ok && options.format == IdFormat::Packed) {
+        ok = packed.finish();
+    }
+    output->flush();
+    return ok && static_cast<bool>(*output);
+}
+
+}
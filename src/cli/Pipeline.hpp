@@ -0,0 +1,88 @@
+#pragma once
+
+#include "forkenizer/Tokenizer.hpp"
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace forkenizer {
+
+// Finds the top-level string member `field` of the JSON object in `line` and appends
+// its unescaped UTF-8 value to `out`. Returns false when the line is not an object or
+// the member is missing or not a string.
+bool extractJsonStringField(std::string_view line, std::string_view field, std::string& out);
+bool extractJsonNumberField(std::string_view line, std::string_view field, uint64_t& out);
+// Appends value as a quoted JSON string, escaping quotes, backslashes and control bytes.
+void appendJsonString(std::string& out, std::string_view value);
+
+struct RecordOrigin {
+    uint32_t input = 0;
+    uint64_t record = 0;
+};
+
+// A batch of records moving through the pipeline. The reader fills text/textOffsets
+// (and origins if it needs them downstream); workers fill ids/idOffsets.
+struct RecordBatch {
+    std::string text;
+    std::vector<size_t> textOffsets;
+    std::vector<uint8_t> present;
+    std::vector<RecordOrigin> origins;
+    std::vector<uint32_t> ids;
+    std::vector<size_t> idOffsets;
+
+    void reset() {
+        text.clear();
+        textOffsets.assign(1, 0);
+        present.clear();
+        origins.clear();
+        idOffsets.clear();
+    }
+    size_t size() const { return present.size(); }
+    void addRecord(bool isPresent) {
+        textOffsets.push_back(text.size());
+        present.push_back(isPresent ? 1 : 0);
+    }
+    std::string_view recordText(size_t r) const {
+        return std::string_view(text).substr(textOffsets[r], textOffsets[r + 1] - textOffsets[r]);
+    }
+};
+
+// Runs reader -> N encoder workers -> ordered writer. fill() runs on a reader thread and
+// appends records to an empty batch, returning false once input is exhausted; drain()
+// runs on the calling thread and sees batches in input order, returning false to stop
+// early. Batches move between stages over bounded SPSC rings: the reader deals them
+// round-robin to the workers and the writer collects them in the same order, so order
+// is kept without a reorder buffer, and spent batches flow back to the reader.
+bool runOrderedEncode(const Tokenizer& tokenizer, unsigned threads, size_t queueDepth,
+                      const std::function<bool(RecordBatch&)>& fill,
+                      const std::function<bool(const RecordBatch&)>& drain);
+
+enum class IdFormat { Text, Binary, Packed };
+
+struct PipelineOptions {
+    std::string inputPath;   // "-" reads stdin
+    std::string outputPath;  // empty or "-" writes stdout
+    bool jsonl = false;
+    std::string field = "text";
+    IdFormat format = IdFormat::Text;
+    unsigned threads = 0;
+    size_t batchRecords = 256;
+    size_t queueDepth = 4;
+};
+
+struct PipelineStats {
+    uint64_t records = 0;
+    uint64_t tokens = 0;
+    uint64_t skipped = 0;
+};
+
+// Encodes a JSONL or line-delimited stream. Text output is one line of space-separated
+// ids per record. Binary output is, per record, a uint32 count followed by that many
+// uint32 ids in host byte order. Packed output is an IdStreamWriter stream with one
+// document per record. Records whose JSON field is missing produce an empty line /
+// zero count / empty document and are counted in stats.skipped.
+bool runEncodePipeline(const Tokenizer& tokenizer, const PipelineOptions& options, PipelineStats& stats);
+
+}
@@ -0,0 +1,346 @@
+#include "Profile.hpp"
+#include "Pipeline.hpp"
+#include "../tokenizer/Unicode.hpp"
+#include "../util/Parallel.hpp"
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+#include <functional>
+#include <list>
+#include <numeric>
+#include <unordered_map>
+#include <unordered_set>
+
+namespace forkenizer {
+
+namespace {
+
+constexpr size_t kDocumentChunk = 64;
+
+// Pretokens are classed by their first byte.
+enum PieceClass : size_t { kLetter, kDigit, kSpace, kPunct, kNonAscii, kPieceClasses };
+constexpr const char* kPieceClassNames[kPieceClasses] = {"letter", "digit", "space", "punct", "non_ascii"};
+
+PieceClass classify(unsigned char c) {
+    if (c >= 0x80) return kNonAscii;
+    if ((c | 0x20) >= 'a' && (c | 0x20) <= 'z') return kLetter;
+    if (c >= '0' && c <= '9') return kDigit;
+    if (c == ' ' || (c >= '\t' && c <= '\r')) return kSpace;
+    return kPunct;
+}
+
+struct Volume {
+    uint64_t documents = 0;
+    uint64_t pieces = 0;
+    uint64_t bytes = 0;
+    uint64_t tokens = 0;
+
+    void add(const Volume& other) {
+        documents += other.documents;
+        pieces += other.pieces;
+        bytes += other.bytes;
+        tokens += other.tokens;
+    }
+};
+
+// What one worker gathers; merged once every document is encoded.
+struct WorkerCounts {
+    std::vector<Volume> inputs;
+    Volume classes[kPieceClasses];
+    std::vector<uint64_t> tokenCounts;
+    std::vector<uint64_t> tokenLengths;
+    std::vector<uint64_t> trieDepths;
+    uint64_t fallbackTokens = 0;
+    uint64_t fallbackBytes = 0;
+    uint64_t partialTokens = 0;
+};
+
+void bump(std::vector<uint64_t>& histogram, size_t value, uint64_t count = 1) {
+    if (value >= histogram.size()) histogram.resize(value + 1, 0);
+    histogram[value] += count;
+}
+
+void addHistogram(std::vector<uint64_t>& into, const std::vector<uint64_t>& from) {
+    for (size_t value = 0; value < from.size(); ++value) {
+        if (from[value] != 0) bump(into, value, from[value]);
+    }
+}
+
+// True when token is not a run of whole UTF-8 characters: emitting it means the vocab
+// had no token for some character and spelled it in bytes.
+bool splitsCharacter(std::string_view token) {
+    for (size_t i = 0; i < token.size();) {
+        size_t length;
+        if (decodeUtf8(token, i, length) == kInvalidCodePoint) return true;
+        i += length;
+    }
+    return false;
+}
+
+// Replays the pretoken stream through an LRU cache of `capacity` pieces.
+uint64_t lruHits(const std::vector<std::vector<uint64_t>>& streams, size_t capacity) {
+    if (capacity == 0) return 0;
+    std::list<uint64_t> recent;
+    std::unordered_map<uint64_t, std::list<uint64_t>::iterator> slots;
+    uint64_t hits = 0;
+    for (const auto& stream : streams) {
+        for (uint64_t key : stream) {
+            auto it = slots.find(key);
+            if (it != slots.end()) {
+                ++hits;
+                recent.splice(recent.begin(), recent, it->second);
+                continue;
+            }
+            if (recent.size() == capacity) {
+                slots.erase(recent.back());
+                recent.pop_back();
+            }
+            recent.push_front(key);
+            slots.emplace(key, recent.begin());
+        }
+    }
+    return hits;
+}
+
+void appendNumber(std::string& out, double value) {
+    char text[32];
+    std::snprintf(text, sizeof(text), "%.6g", value);
+    out += text;
+}
+
+double ratio(uint64_t numerator, uint64_t denominator) {
+    return denominator == 0 ? 0.0 : static_cast<double>(numerator) / static_cast<double>(denominator);
+}
+
+void appendVolume(std::string& out, const Volume& volume) {
+    out += "\"pieces\": " + std::to_string(volume.pieces) + ", \"bytes\": " + std::to_string(volume.bytes) +
+           ", \"tokens\": " + std::to_string(volume.tokens) + ", \"bytes_per_token\": ";
+    appendNumber(out, ratio(volume.bytes, volume.tokens));
+}
+
+// {"<value>": count, ...} over the nonzero buckets, plus the mean.
+void appendHistogram(std::string& out, const char* name, const std::vector<uint64_t>& histogram) {
+    uint64_t total = 0, sum = 0;
+    out += "  \"" + std::string(name) + "\": {\"mean\": ";
+    for (size_t value = 0; value < histogram.size(); ++value) {
+        total += histogram[value];
+        sum += value * histogram[value];
+    }
+    appendNumber(out, ratio(sum, total));
+    out += ", \"counts\": {";
+    bool first = true;
+    for (size_t value = 0; value < histogram.size(); ++value) {
+        if (histogram[value] == 0) continue;
+        out += first ? "" : ", ";
+        out += "\"" + std::to_string(value) + "\": " + std::to_string(histogram[value]);
+        first = false;
+    }
+    out += "}},\n";
+}
+
+}
+
+bool profileCorpus(const Tokenizer& tokenizer, const ProfileOptions& options, std::string& json,
+                   std::string& error) {
+    if (!tokenizer.isLoaded()) {
+        error = "no model loaded";
+        return false;
+    }
+
+    struct Document {
+        uint32_t input;
+        std::string_view text;
+    };
+    std::vector<std::string> contents(options.inputs.size());
+    std::vector<Document> documents;
+    for (size_t input = 0; input < options.inputs.size(); ++input) {
+        std::ifstream file(options.inputs[input], std::ios::binary);
+        if (!file.is_open()) {
+            error = "cannot read " + options.inputs[input];
+            return false;
+        }
+        contents[input].assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+        std::string_view text = contents[input];
+        while (!text.empty()) {
+            const size_t newline = std::min(text.find('\n'), text.size());
+            if (newline > 0) {
+                documents.push_back(Document{static_cast<uint32_t>(input), text.substr(0, newline)});
+            }
+            text.remove_prefix(std::min(newline + 1, text.size()));
+        }
+    }
+
+    // Every prefix of a vocab token is a trie node, so a longest-match walk from a
+    // position reads as many bytes as the longest prefix found there.
+    // Tables are indexed by id; ids without a token (gaps) decode to nothing.
+    const size_t idCount = tokenizer.idCount();
+    std::vector<std::string> tokenText(idCount);
+    std::vector<uint8_t> partial(idCount, 0);
+    std::unordered_set<std::string_view> prefixes;
+    for (uint32_t id = 0; id < idCount; ++id) {
+        tokenText[id] = tokenizer.decode({id}).value_or("");
+        partial[id] = splitsCharacter(tokenText[id]);
+    }
+    for (const auto& token : tokenText) {
+        for (size_t length = 1; length <= token.size(); ++length) {
+            prefixes.insert(std::string_view(token).substr(0, length));
+        }
+    }
+
+    const unsigned threads = resolveThreadCount(options.threads);
+    std::vector<WorkerCounts> workers(threads);
+    for (auto& counts : workers) {
+        counts.inputs.resize(options.inputs.size());
+        counts.tokenCounts.assign(idCount, 0);
+    }
+    std::vector<std::vector<uint64_t>> pieceKeys(documents.size());
+    parallelFor(documents.size(), threads, kDocumentChunk, [&](unsigned worker, size_t begin, size_t end) {
+        WorkerCounts& counts = workers[worker];
+        for (size_t d = begin; d < end; ++d) {
+            const std::string_view text = documents[d].text;
+            auto encoding = tokenizer.encodeEditable(text);
+            if (!encoding) continue;
+            const auto& tokens = encoding->tokens;
+            const size_t pieces = encoding->pieceBegins.size();
+            Volume& volume = counts.inputs[documents[d].input];
+            ++volume.documents;
+            volume.pieces += pieces;
+            volume.bytes += text.size();
+            volume.tokens += tokens.ids.size();
+
+            pieceKeys[d].reserve(pieces);
+            for (size_t p = 0; p < pieces; ++p) {
+                const size_t pieceBegin = encoding->pieceBegins[p];
+                const size_t pieceEnd = p + 1 < pieces ? encoding->pieceBegins[p + 1] : text.size();
+                const size_t firstToken = encoding->pieceFirstTokens[p];
+                const size_t endToken = p + 1 < pieces ? encoding->pieceFirstTokens[p + 1] : tokens.ids.size();
+                const std::string_view piece = text.substr(pieceBegin, pieceEnd - pieceBegin);
+                pieceKeys[d].push_back(std::hash<std::string_view>{}(piece));
+
+                Volume& pieceClass = counts.classes[classify(static_cast<unsigned char>(piece[0]))];
+                ++pieceClass.pieces;
+                pieceClass.bytes += piece.size();
+                pieceClass.tokens += endToken - firstToken;
+
+                // Once the trie matches nothing, greedy matching emits the rest of the
+                // piece as byte tokens (or <unk> for bytes missing from the vocab).
+                bool fellBack = false;
+                for (size_t t = firstToken; t < endToken; ++t) {
+                    const uint32_t id = tokens.ids[t];
+                    const size_t at = tokens.begins[t] - pieceBegin;
+                    const size_t length = tokens.ends[t] - tokens.begins[t];
+                    size_t depth = 0;
+                    while (at + depth < piece.size() && prefixes.count(piece.substr(at, depth + 1)) != 0) {
+                        ++depth;
+                    }
+                    fellBack = fellBack || depth == 0;
+                    ++counts.tokenCounts[id];
+                    bump(counts.tokenLengths, length);
+                    bump(counts.trieDepths, depth);
+                    if (fellBack) {
+                        ++counts.fallbackTokens;
+                        counts.fallbackBytes += length;
+                    }
+                    counts.partialTokens += partial[id];
+                }
+            }
+        }
+    });
+
+    WorkerCounts total;
+    total.inputs.resize(options.inputs.size());
+    total.tokenCounts.assign(idCount, 0);
+    for (const auto& counts : workers) {
+        for (size_t input = 0; input < counts.inputs.size(); ++input) total.inputs[input].add(counts.inputs[input]);
+        for (size_t c = 0; c < kPieceClasses; ++c) total.classes[c].add(counts.classes[c]);
+        for (size_t id = 0; id < idCount; ++id) total.tokenCounts[id] += counts.tokenCounts[id];
+        addHistogram(total.tokenLengths, counts.tokenLengths);
+        addHistogram(total.trieDepths, counts.trieDepths);
+        total.fallbackTokens += counts.fallbackTokens;
+        total.fallbackBytes += counts.fallbackBytes;
+        total.partialTokens += counts.partialTokens;
+    }
+    Volume corpus;
+    for (const auto& volume : total.inputs) corpus.add(volume);
+
+    json = "{\n  \"vocab_size\": " + std::to_string(tokenizer.vocabSize()) + ",\n  \"corpus\": {\"documents\": " +
+           std::to_string(corpus.documents) + ", ";
+    appendVolume(json, corpus);
+    json += "},\n  \"inputs\": [";
+    for (size_t input = 0; input < total.inputs.size(); ++input) {
+        json += input == 0 ? "\n    {\"path\": " : ",\n    {\"path\": ";
+        appendJsonString(json, options.inputs[input]);
+        json += ", \"documents\": " + std::to_string(total.inputs[input].documents) + ", ";
+        appendVolume(json, total.inputs[input]);
+        json += "}";
+    }
+    json += "\n  ],\n  \"piece_classes\": {";
+    for (size_t c = 0; c < kPieceClasses; ++c) {
+        json += std::string(c == 0 ? "\n" : ",\n") + "    \"" + kPieceClassNames[c] + "\": {";
+        appendVolume(json, total.classes[c]);
+        json += "}";
+    }
+    json += "\n  },\n  \"byte_fallback\": {\"tokens\": " + std::to_string(total.fallbackTokens) + ", \"token_rate\": ";
+    appendNumber(json, ratio(total.fallbackTokens, corpus.tokens));
+    json += ", \"bytes\": " + std::to_string(total.fallbackBytes) + ", \"byte_rate\": ";
+    appendNumber(json, ratio(total.fallbackBytes, corpus.bytes));
+    json += ", \"partial_character_tokens\": " + std::to_string(total.partialTokens) + "},\n";
+
+    std::vector<uint32_t> order(idCount);
+    std::iota(order.begin(), order.end(), 0u);
+    const size_t hot = std::min(options.topTokens, idCount);
+    const auto& counts = total.tokenCounts;
+    std::partial_sort(order.begin(), order.begin() + static_cast<std::ptrdiff_t>(hot), order.end(),
+                      [&](uint32_t a, uint32_t b) { return counts[a] != counts[b] ? counts[a] > counts[b] : a < b; });
+    json += "  \"hot_tokens\": [";
+    bool first = true;
+    for (size_t i = 0; i < hot && total.tokenCounts[order[i]] > 0; ++i) {
+        const uint32_t id = order[i];
+        json += first ? "\n    {\"id\": " : ",\n    {\"id\": ";
+        json += std::to_string(id);
+        if (partial[id]) {
+            // Not valid UTF-8 on its own; give the bytes instead.
+            json += ", \"bytes\": \"";
+            for (unsigned char byte : tokenText[id]) {
+                char hex[4];
+                std::snprintf(hex, sizeof(hex), "%02x", byte);
+                json += hex;
+            }
+            json += "\"";
+        } else {
+            json += ", \"token\": ";
+            appendJsonString(json, tokenText[id]);
+        }
+        json += ", \"count\": " + std::to_string(total.tokenCounts[id]) + ", \"share\": ";
+        appendNumber(json, ratio(total.tokenCounts[id], corpus.tokens));
+        json += "}";
+        first = false;
+    }
+    json += "\n  ],\n";
+
+    std::string unused;
+    uint64_t unusedCount = 0;
+    for (uint32_t id = 0; id < idCount; ++id) {
+        if (total.tokenCounts[id] != 0 || tokenText[id].empty()) continue;
+        unused += unusedCount++ == 0 ? "" : ", ";
+        unused += std::to_string(id);
+    }
+    json += "  \"unused_tokens\": {\"count\": " + std::to_string(unusedCount) + ", \"ids\": [" + unused + "]},\n";
+    appendHistogram(json, "token_lengths", total.tokenLengths);
+    appendHistogram(json, "trie_depths", total.trieDepths);
+
+    std::unordered_set<uint64_t> distinct;
+    for (const auto& keys : pieceKeys) distinct.insert(keys.begin(), keys.end());
+    json += "  \"pretoken_cache\": {\"lookups\": " + std::to_string(corpus.pieces) +
+            ", \"distinct_pieces\": " + std::to_string(distinct.size()) + ", \"lru\": [";
+    for (size_t i = 0; i < options.cacheSizes.size(); ++i) {
+        json += i == 0 ? "\n    {\"entries\": " : ",\n    {\"entries\": ";
+        json += std::to_string(options.cacheSizes[i]) + ", \"hit_rate\": ";
+        appendNumber(json, ratio(lruHits(pieceKeys, options.cacheSizes[i]), corpus.pieces));
+        json += "}";
+    }
+    json += "\n  ]}\n}\n";
+    return true;
+}
+
+}
@@ -0,0 +1,27 @@
+#pragma once
+
+#include "forkenizer/Tokenizer.hpp"
+#include <cstddef>
+#include <string>
+#include <vector>
+
+namespace forkenizer {
+
+struct ProfileOptions {
+    std::vector<std::string> inputs;  // each file is a category; its lines are documents
+    size_t topTokens = 50;
+    std::vector<size_t> cacheSizes = {1024, 4096, 16384, 65536};
+    unsigned threads = 0;
+};
+
+// Encodes every line of the inputs in parallel and writes a JSON report to `json`:
+// bytes per token per input file and per pretoken class; the byte fallback rate
+// (tokens emitted after the trie stopped matching, plus tokens holding part of a
+// UTF-8 character); the hottest and never used token ids; histograms of matched
+// token lengths and of the bytes each longest-match trie walk reads; and LRU hit
+// rates of a pretoken -> tokens cache at each size, replayed in corpus order.
+// Expects greedy encoding without normalization. The inputs are held in memory.
+bool profileCorpus(const Tokenizer& tokenizer, const ProfileOptions& options, std::string& json,
+                   std::string& error);
+
+}
@@ -0,0 +1,625 @@
+#include "Shard.hpp"
+#include "Pipeline.hpp"
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <fcntl.h>
+#include <unistd.h>
+
+namespace forkenizer {
+
+namespace {
+
+namespace fs = std::filesystem;
+
+constexpr size_t kWriteBufferBytes = 8 << 20;
+constexpr size_t kBatchRecords = 1024;
+constexpr uint64_t kFormatVersion = 2;
+
+const char* dtypeName(size_t width) {
+    return width == 2 ? "uint16" : "uint32";
+}
+
+const char* documentsName(ShardDocuments documents) {
+    switch (documents) {
+        case ShardDocuments::File: return "file";
+        case ShardDocuments::Line: return "line";
+        case ShardDocuments::Jsonl: return "jsonl";
+    }
+    return "file";
+}
+
+std::string shardName(uint64_t index, const char* extension) {
+    char name[32];
+    std::snprintf(name, sizeof(name), "shard_%05llu.%s", static_cast<unsigned long long>(index), extension);
+    return name;
+}
+
+uint64_t hashInputs(const std::vector<std::string>& inputs) {
+    uint64_t hash = 1469598103934665603ull;
+    for (const auto& input : inputs) {
+        for (unsigned char c : input) {
+            hash = (hash ^ c) * 1099511628211ull;
+        }
+        hash = (hash ^ 0xFF) * 1099511628211ull;
+    }
+    return hash;
+}
+
+// Size and modification time of an input, so a resume notices edited files.
+struct InputStat {
+    uint64_t bytes = 0;
+    int64_t mtimeNs = 0;
+};
+
+bool statInputs(const std::vector<std::string>& inputs, std::vector<InputStat>& stats, std::string& error) {
+    stats.clear();
+    for (const auto& input : inputs) {
+        std::error_code ec;
+        InputStat stat;
+        stat.bytes = fs::file_size(input, ec);
+        const auto written = fs::last_write_time(input, ec);
+        if (ec) {
+            error = "cannot stat " + input;
+            return false;
+        }
+        stat.mtimeNs = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                           std::chrono::file_clock::to_sys(written).time_since_epoch())
+                           .count();
+        stats.push_back(stat);
+    }
+    return true;
+}
+
+uint64_t hashInputStats(const std::vector<InputStat>& stats) {
+    uint64_t hash = 1469598103934665603ull;
+    for (const auto& stat : stats) {
+        for (uint64_t value : {stat.bytes, static_cast<uint64_t>(stat.mtimeNs)}) {
+            for (int shift = 0; shift < 64; shift += 8) {
+                hash = (hash ^ ((value >> shift) & 0xFF)) * 1099511628211ull;
+            }
+        }
+    }
+    return hash;
+}
+
+bool writeAll(int fd, const char* data, size_t size, uint64_t offset) {
+    while (size > 0) {
+        ssize_t written = ::pwrite(fd, data, size, static_cast<off_t>(offset));
+        if (written < 0) {
+            if (errno == EINTR) continue;
+            return false;
+        }
+        data += written;
+        size -= static_cast<size_t>(written);
+        offset += static_cast<uint64_t>(written);
+    }
+    return true;
+}
+
+bool writeFileDurably(const fs::path& path, const std::string& contents) {
+    int fd = ::open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) return false;
+    bool ok = writeAll(fd, contents.data(), contents.size(), 0) && ::fdatasync(fd) == 0;
+    return ::close(fd) == 0 && ok;
+}
+
+bool collectInputs(const std::vector<std::string>& roots, std::vector<std::string>& files, std::string& error) {
+    std::error_code ec;
+    for (const auto& root : roots) {
+        if (fs::is_directory(root, ec)) {
+            std::vector<std::string> found;
+            for (fs::recursive_directory_iterator it(root, ec), end; !ec && it != end; it.increment(ec)) {
+                if (it->is_regular_file(ec)) {
+                    found.push_back(it->path().string());
+                }
+            }
+            if (ec) {
+                error = "cannot read directory " + root;
+                return false;
+            }
+            std::sort(found.begin(), found.end());
+            files.insert(files.end(), found.begin(), found.end());
+        } else if (fs::is_regular_file(root, ec)) {
+            files.push_back(root);
+        } else {
+            error = "input not found: " + root;
+            return false;
+        }
+    }
+    return true;
+}
+
+struct Manifest {
+    std::string dtype;
+    std::string documents;
+    std::string field;
+    bool hasEos = false;
+    uint64_t eosId = 0;
+    uint64_t shardBytes = 0;
+    uint64_t inputCount = 0;
+    uint64_t inputsHash = 0;
+    uint64_t inputStatsHash = 0;
+    uint64_t modelFingerprint = 0;
+    uint64_t shardCount = 0;
+    uint64_t resumeInput = 0;
+    uint64_t resumeRecord = 0;
+
+    bool sameModel(const Manifest& other) const { return modelFingerprint == other.modelFingerprint; }
+    bool sameInputContents(const Manifest& other) const { return inputStatsHash == other.inputStatsHash; }
+    bool sameConfiguration(const Manifest& other) const {
+        return dtype == other.dtype && documents == other.documents && field == other.field &&
+               hasEos == other.hasEos && eosId == other.eosId && shardBytes == other.shardBytes &&
+               inputCount == other.inputCount && inputsHash == other.inputsHash;
+    }
+};
+
+bool readManifest(const fs::path& path, Manifest& manifest) {
+    std::ifstream in(path, std::ios::binary);
+    if (!in) return false;
+    std::stringstream buffer;
+    buffer << in.rdbuf();
+    const std::string text = buffer.str();
+
+    uint64_t version = 0;
+    if (!extractJsonNumberField(text, "version", version) || version != kFormatVersion) return false;
+    manifest.hasEos = extractJsonNumberField(text, "eos_id", manifest.eosId);
+    return extractJsonStringField(text, "dtype", manifest.dtype) &&
+           extractJsonStringField(text, "documents", manifest.documents) &&
+           extractJsonStringField(text, "field", manifest.field) &&
+           extractJsonNumberField(text, "shard_bytes", manifest.shardBytes) &&
+           extractJsonNumberField(text, "input_count", manifest.inputCount) &&
+           extractJsonNumberField(text, "inputs_hash", manifest.inputsHash) &&
+           extractJsonNumberField(text, "input_stats_hash", manifest.inputStatsHash) &&
+           extractJsonNumberField(text, "model_fingerprint", manifest.modelFingerprint) &&
+           extractJsonNumberField(text, "shard_count", manifest.shardCount) &&
+           extractJsonNumberField(text, "resume_input", manifest.resumeInput) &&
+           extractJsonNumberField(text, "resume_record", manifest.resumeRecord);
+}
+
+struct SealedShard {
+    uint64_t tokens = 0;
+    uint64_t documents = 0;
+};
+
+// Writes manifest.json through a temporary file and rename so a crash leaves either
+// the previous or the new manifest.
+bool writeManifest(const fs::path& dir, const Manifest& manifest, const std::vector<std::string>& inputs,
+                   const std::vector<InputStat>& inputStats, const std::vector<SealedShard>& shards) {
+    uint64_t tokens = 0;
+    uint64_t documents = 0;
+    for (const auto& shard : shards) {
+        tokens += shard.tokens;
+        documents += shard.documents;
+    }
+
+    std::string out = "{\n";
+    auto number = [&](const char* key, uint64_t value) {
+        out += "  \"";
+        out += key;
+        out += "\": " + std::to_string(value) + ",\n";
+    };
+    auto string = [&](const char* key, std::string_view value) {
+        out += "  \"";
+        out += key;
+        out += "\": ";
+        appendJsonString(out, value);
+        out += ",\n";
+    };
+    out += "  \"format\": \"forkenizer-shards\",\n";
+    number("version", kFormatVersion);
+    string("dtype", manifest.dtype);
+    string("documents", manifest.documents);
+    string("field", manifest.field);
+    if (manifest.hasEos) number("eos_id", manifest.eosId);
+    number("shard_bytes", manifest.shardBytes);
+    number("input_count", manifest.inputCount);
+    number("inputs_hash", manifest.inputsHash);
+    number("input_stats_hash", manifest.inputStatsHash);
+    number("model_fingerprint", manifest.modelFingerprint);
+    number("shard_count", shards.size());
+    number("document_count", documents);
+    number("token_count", tokens);
+    number("resume_input", manifest.resumeInput);
+    number("resume_record", manifest.resumeRecord);
+    out += "  \"inputs\": [";
+    for (size_t i = 0; i < inputs.size(); ++i) {
+        out += i == 0 ? "\n    {\"path\": " : ",\n    {\"path\": ";
+        appendJsonString(out, inputs[i]);
+        out += ", \"bytes\": " + std::to_string(inputStats[i].bytes) +
+               ", \"mtime_ns\": " + std::to_string(inputStats[i].mtimeNs) + "}";
+    }
+    out += "\n  ],\n  \"shards\": [";
+    for (size_t i = 0; i < shards.size(); ++i) {
+        out += i == 0 ? "\n    " : ",\n    ";
+        out += "{\"bin\": \"" + shardName(i, "bin") + "\", \"idx\": \"" + shardName(i, "idx") +
+               "\", \"tokens\": " + std::to_string(shards[i].tokens) +
+               ", \"documents\": " + std::to_string(shards[i].documents) + "}";
+    }
+    out += "\n  ]\n}\n";
+
+    const fs::path temporary = dir / "manifest.json.tmp";
+    if (!writeFileDurably(temporary, out)) return false;
+    std::error_code ec;
+    fs::rename(temporary, dir / "manifest.json", ec);
+    return !ec;
+}
+
+// Recovers a sealed shard's counts from its index file.
+bool readSealedShard(const fs::path& dir, uint64_t index, SealedShard& shard) {
+    std::ifstream in(dir / shardName(index, "idx"), std::ios::binary | std::ios::ate);
+    if (!in) return false;
+    const auto size = static_cast<uint64_t>(in.tellg());
+    if (size < sizeof(uint64_t) || size % sizeof(uint64_t) != 0) return false;
+    in.seekg(static_cast<std::streamoff>(size - sizeof(uint64_t)));
+    in.read(reinterpret_cast<char*>(&shard.tokens), sizeof(shard.tokens));
+    shard.documents = size / sizeof(uint64_t) - 1;
+    return static_cast<bool>(in);
+}
+
+class ShardWriter {
+public:
+    ShardWriter(fs::path dir, size_t width, uint64_t capacityTokens)
+        : dir_(std::move(dir)), width_(width), capacityTokens_(capacityTokens) {
+        buffer_.reserve(kWriteBufferBytes);
+    }
+
+    ~ShardWriter() {
+        if (fd_ >= 0) ::close(fd_);
+    }
+
+    uint64_t tokens() const { return tokens_; }
+    size_t documents() const { return documentStarts_.size(); }
+    bool fits(uint64_t count) const { return documentStarts_.empty() || tokens_ + count <= capacityTokens_; }
+
+    bool open(uint64_t index) {
+        index_ = index;
+        tokens_ = 0;
+        fileOffset_ = 0;
+        documentStarts_.clear();
+        buffer_.clear();
+        fd_ = ::open((dir_ / shardName(index, "bin")).c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+        return fd_ >= 0;
+    }
+
+    // Returns false when an id does not fit the shard's token width.
+    bool append(const uint32_t* ids, size_t count, const uint32_t* eos) {
+        documentStarts_.push_back(tokens_);
+        return appendIds(ids, count) && (eos == nullptr || appendIds(eos, 1));
+    }
+
+    bool seal() {
+        if (!flush() || ::fdatasync(fd_) != 0 || ::close(fd_) != 0) {
+            fd_ = -1;
+            return false;
+        }
+        fd_ = -1;
+        documentStarts_.push_back(tokens_);
+        std::string index(reinterpret_cast<const char*>(documentStarts_.data()),
+                          documentStarts_.size() * sizeof(uint64_t));
+        return writeFileDurably(dir_ / shardName(index_, "idx"), index);
+    }
+
+private:
+    bool appendIds(const uint32_t* ids, size_t count) {
+        tokens_ += count;
+        for (size_t i = 0; i < count; ++i) {
+            if (width_ == 2) {
+                if (ids[i] > UINT16_MAX) return false;
+                const uint16_t narrow = static_cast<uint16_t>(ids[i]);
+                buffer_.append(reinterpret_cast<const char*>(&narrow), sizeof(narrow));
+            } else {
+                buffer_.append(reinterpret_cast<const char*>(ids + i), sizeof(uint32_t));
+            }
+            if (buffer_.size() >= kWriteBufferBytes && !flush()) return false;
+        }
+        return true;
+    }
+
+    bool flush() {
+        if (!writeAll(fd_, buffer_.data(), buffer_.size(), fileOffset_)) return false;
+        fileOffset_ += buffer_.size();
+        buffer_.clear();
+        return true;
+    }
+
+    fs::path dir_;
+    size_t width_;
+    uint64_t capacityTokens_;
+    uint64_t index_ = 0;
+    uint64_t tokens_ = 0;
+    uint64_t fileOffset_ = 0;
+    int fd_ = -1;
+    std::string buffer_;
+    std::vector<uint64_t> documentStarts_;
+};
+
+// Reads input files into batches of documents, starting at a resume position.
+class DocumentReader {
+public:
+    DocumentReader(const std::vector<std::string>& inputs, const ShardOptions& options, RecordOrigin start)
+        : inputs_(inputs), options_(options), input_(start.input), start_(start) {}
+
+    bool failed() const { return failed_; }
+    const std::string& failedPath() const { return failedPath_; }
+
+    bool fill(RecordBatch& batch) {
+        while (batch.size() < kBatchRecords && batch.text.size() < std::max<size_t>(options_.batchBytes, 1)) {
+            if (!stream_.is_open() && !openNext()) {
+                return false;
+            }
+            if (options_.documents == ShardDocuments::File) {
+                readWholeFile(batch);
+                continue;
+            }
+            if (!std::getline(stream_, line_)) {
+                closeCurrent();
+                continue;
+            }
+            if (record_++ < skip_) {
+                continue;
+            }
+            bool present = true;
+            if (options_.documents == ShardDocuments::Jsonl) {
+                const size_t before = batch.text.size();
+                present = extractJsonStringField(line_, options_.field, batch.text);
+                if (!present) batch.text.resize(before);
+            } else {
+                if (!line_.empty() && line_.back() == '\r') line_.pop_back();
+                batch.text += line_;
+            }
+            batch.origins.push_back(RecordOrigin{input_, record_ - 1});
+            batch.addRecord(present);
+        }
+        return true;
+    }
+
+private:
+    bool openNext() {
+        while (input_ < inputs_.size()) {
+            skip_ = input_ == start_.input ? start_.record : 0;
+            record_ = 0;
+            if (options_.documents == ShardDocuments::File && skip_ > 0) {
+                ++input_;
+                continue;
+            }
+            stream_.open(inputs_[input_], std::ios::binary);
+            if (!stream_.is_open()) {
+                failed_ = true;
+                failedPath_ = inputs_[input_];
+                return false;
+            }
+            return true;
+        }
+        return false;
+    }
+
+    void closeCurrent() {
+        stream_.close();
+        stream_.clear();
+        ++input_;
+    }
+
+    void readWholeFile(RecordBatch& batch) {
+        stream_.seekg(0, std::ios::end);
+        const auto size = static_cast<size_t>(stream_.tellg());
+        stream_.seekg(0, std::ios::beg);
+        const size_t before = batch.text.size();
+        batch.text.resize(before + size);
+        stream_.read(batch.text.data() + before, static_cast<std::streamsize>(size));
+        batch.origins.push_back(RecordOrigin{input_, 0});
+        batch.addRecord(true);
+        closeCurrent();
+    }
+
+    const std::vector<std::string>& inputs_;
+    const ShardOptions& options_;
+    uint32_t input_;
+    RecordOrigin start_;
+    uint64_t record_ = 0;
+    uint64_t skip_ = 0;
+    std::ifstream stream_;
+    std::string line_;
+    bool failed_ = false;
+    std::string failedPath_;
+};
+
+}
+
+bool runShard(const Tokenizer& tokenizer, const ShardOptions& options, ShardStats& stats, std::string& error) {
+    std::vector<std::string> inputs;
+    if (!collectInputs(options.inputs, inputs, error)) {
+        return false;
+    }
+    if (inputs.size() > UINT32_MAX) {
+        error = "too many input files";
+        return false;
+    }
+
+    std::vector<InputStat> inputStats;
+    if (!statInputs(inputs, inputStats, error)) {
+        return false;
+    }
+
+    size_t width = 4;
+    if (options.dtype == ShardDtype::U16 ||
+        (options.dtype == ShardDtype::Auto && tokenizer.idCount() <= UINT16_MAX + 1ull)) {
+        width = 2;
+    }
+
+    Manifest manifest;
+    manifest.dtype = dtypeName(width);
+    manifest.documents = documentsName(options.documents);
+    manifest.field = options.documents == ShardDocuments::Jsonl ? options.field : "";
+    manifest.shardBytes = options.shardBytes;
+    manifest.inputCount = inputs.size();
+    manifest.inputsHash = hashInputs(inputs);
+    manifest.inputStatsHash = hashInputStats(inputStats);
+    manifest.modelFingerprint = tokenizer.fingerprint();
+    uint32_t eosId = 0;
+    if (options.appendEos) {
+        auto id = tokenizer.tokenId("<eos>");
+        if (!id.has_value()) {
+            error = "model has no <eos> token";
+            return false;
+        }
+        eosId = *id;
+        manifest.hasEos = true;
+        manifest.eosId = eosId;
+    }
+
+    const fs::path dir(options.outputDir);
+    std::error_code ec;
+    fs::create_directories(dir, ec);
+    if (ec) {
+        error = "cannot create " + options.outputDir;
+        return false;
+    }
+
+    std::vector<SealedShard> sealed;
+    Manifest previous;
+    if (fs::exists(dir / "manifest.json", ec)) {
+        if (!readManifest(dir / "manifest.json", previous)) {
+            error = "cannot read manifest.json in " + options.outputDir + "; remove the directory to start over";
+            return false;
+        }
+        if (!previous.sameModel(manifest)) {
+            error = "manifest.json in " + options.outputDir + " was written with a different model or encode settings";
+            return false;
+        }
+        if (!previous.sameInputContents(manifest)) {
+            error = "inputs changed size or modification time since manifest.json in " + options.outputDir +
+                    " was written";
+            return false;
+        }
+        if (!previous.sameConfiguration(manifest)) {
+            error = "manifest.json in " + options.outputDir + " was written for different inputs or options";
+            return false;
+        }
+        for (uint64_t i = 0; i < previous.shardCount; ++i) {
+            SealedShard shard;
+            if (!readSealedShard(dir, i, shard)) {
+                error = "missing or damaged " + shardName(i, "idx");
+                return false;
+            }
+            sealed.push_back(shard);
+        }
+        manifest.resumeInput = previous.resumeInput;
+        manifest.resumeRecord = previous.resumeRecord;
+        stats.resumed = true;
+    }
+    // Anything past the last sealed shard is a partial write from an interrupted run.
+    for (uint64_t i = sealed.size();; ++i) {
+        const bool bin = fs::remove(dir / shardName(i, "bin"), ec);
+        const bool idx = fs::remove(dir / shardName(i, "idx"), ec);
+        if (!bin && !idx) break;
+    }
+
+    auto finish = [&] {
+        for (const auto& shard : sealed) {
+            stats.tokens += shard.tokens;
+            stats.documents += shard.documents;
+        }
+        stats.shards = sealed.size();
+        stats.complete = manifest.resumeInput >= manifest.inputCount;
+    };
+    if (manifest.resumeInput >= manifest.inputCount) {
+        if (!stats.resumed && !writeManifest(dir, manifest, inputs, inputStats, sealed)) {
+            error = "cannot write manifest.json";
+            return false;
+        }
+        finish();
+        return true;
+    }
+
+    const uint64_t capacityTokens = std::max<uint64_t>(options.shardBytes / width, 1);
+    ShardWriter writer(dir, width, capacityTokens);
+    if (!writer.open(sealed.size())) {
+        error = "cannot create " + shardName(sealed.size(), "bin");
+        return false;
+    }
+
+    DocumentReader reader(inputs, options,
+                          RecordOrigin{static_cast<uint32_t>(manifest.resumeInput), manifest.resumeRecord});
+    RecordOrigin last{static_cast<uint32_t>(manifest.resumeInput), manifest.resumeRecord};
+    bool hasLast = false;
+    bool stopped = false;
+
+    auto sealCurrent = [&] {
+        const SealedShard shard{writer.tokens(), writer.documents()};
+        if (!writer.seal()) {
+            error = "cannot write " + shardName(sealed.size(), "bin");
+            return false;
+        }
+        sealed.push_back(shard);
+        if (hasLast) {
+            manifest.resumeInput = last.input;
+            manifest.resumeRecord = last.record + 1;
+        }
+        if (!writeManifest(dir, manifest, inputs, inputStats, sealed)) {
+            error = "cannot write manifest.json";
+            return false;
+        }
+        return true;
+    };
+
+    auto drain = [&](const RecordBatch& batch) {
+        for (size_t r = 0; r < batch.size(); ++r) {
+            const size_t begin = batch.idOffsets[r];
+            const size_t count = batch.idOffsets[r + 1] - begin;
+            if (!batch.present[r] || count == 0) {
+                continue;
+            }
+            const uint64_t total = count + (options.appendEos ? 1 : 0);
+            if (!writer.fits(total)) {
+                if (!sealCurrent()) return false;
+                if (options.maxShards != 0 && sealed.size() >= options.maxShards) {
+                    stopped = true;
+                    return false;
+                }
+                if (!writer.open(sealed.size())) {
+                    error = "cannot create " + shardName(sealed.size(), "bin");
+                    return false;
+                }
+            }
+            if (!writer.append(batch.ids.data() + begin, count, options.appendEos ? &eosId : nullptr)) {
+                error = "token id does not fit uint16; use --dtype uint32";
+                return false;
+            }
+            last = batch.origins[r];
+            hasLast = true;
+        }
+        return true;
+    };
+
+    auto fill = [&](RecordBatch& batch) { return reader.fill(batch); };
+    const bool ok = runOrderedEncode(tokenizer, options.threads, options.queueDepth, fill, drain);
+    if (!ok && !stopped) {
+        return false;
+    }
+    if (reader.failed()) {
+        error = "cannot read " + reader.failedPath();
+        return false;
+    }
+    if (!stopped) {
+        if (writer.documents() > 0) {
+            if (!sealCurrent()) return false;
+        } else {
+            fs::remove(dir / shardName(sealed.size(), "bin"), ec);
+        }
+        manifest.resumeInput = manifest.inputCount;
+        manifest.resumeRecord = 0;
+        if (!writeManifest(dir, manifest, inputs, inputStats, sealed)) {
+            error = "cannot write manifest.json";
+            return false;
+        }
+    }
+    finish();
+    return true;
+}
+
+}
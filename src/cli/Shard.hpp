@@ -0,0 +1,47 @@
+#pragma once
+
+#include "forkenizer/Tokenizer.hpp"
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace forkenizer {
+
+enum class ShardDocuments : uint8_t { File, Line, Jsonl };
+enum class ShardDtype : uint8_t { Auto, U16, U32 };
+
+struct ShardOptions {
+    std::vector<std::string> inputs;  // files, or directories walked recursively in sorted order
+    std::string outputDir;
+    ShardDocuments documents = ShardDocuments::File;
+    std::string field = "text";
+    ShardDtype dtype = ShardDtype::Auto;  // Auto picks uint16 when the vocab fits
+    uint64_t shardBytes = 1ull << 30;
+    bool appendEos = true;
+    unsigned threads = 0;
+    size_t batchBytes = 4 << 20;
+    size_t queueDepth = 2;
+    size_t maxShards = 0;  // stop after sealing this many shards in this run; 0 = no limit
+};
+
+struct ShardStats {
+    uint64_t shards = 0;
+    uint64_t documents = 0;
+    uint64_t tokens = 0;
+    bool resumed = false;
+    bool complete = false;
+};
+
+// Encodes a corpus into shard_NNNNN.bin files of uint16/uint32 ids in host byte order,
+// each at most shardBytes unless a single document is larger. Documents are never
+// split across shards and each is followed by <eos>. shard_NNNNN.idx holds
+// documents + 1 uint64 token offsets, so document i is [idx[i], idx[i + 1]). Empty
+// documents are dropped.
+//
+// manifest.json is rewritten after every sealed shard with the input position that
+// follows it. Rerunning with the same inputs and options resumes from there, deleting
+// any partially written shard. A different configuration, a model with another
+// Tokenizer::fingerprint(), or inputs whose size or modification time changed is refused.
+bool runShard(const Tokenizer& tokenizer, const ShardOptions& options, ShardStats& stats, std::string& error);
+
+}
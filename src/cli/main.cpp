@@ -1,10 +1,17 @@
 #include "forkenizer/Tokenizer.hpp"
+#include "forkenizer/IdCodec.hpp"
 #include "forkenizer/ModelIO.hpp"
 #include "../trainer/Trainer.hpp"
+#include "Pipeline.hpp"
+#include "Profile.hpp"
+#include "Shard.hpp"
+#include <algorithm>
 #include <iostream>
 #include <fstream>
 #include <vector>
 #include <string>
+#include <optional>
+#include <chrono>
 #include <sys/stat.h>
 
 static std::string findDefaultModel() {
@@ -30,32 +37,90 @@ static void printUsage() {
               << "       forkenizer-cli decode <file>            # decode token file\n"
               << "       forkenizer-cli train <corpus>...         # train model\n"
               << "\nFull options:\n"
-              << "  encode --model <dir> --text <text> [--ids-out <file>]\n"
-              << "  decode --model <dir> --ids-file <file> [--text-out <file>]\n"
-              << "  inspect --model <dir> --token <token-string>\n";
+              << "  encode --model <dir> --text <text> [--ids-out <file>] [--no-special]\n"
+              << "         [--norm on|nfc|nfkc] [--lowercase] [--collapse-ws] [--mode greedy|min-tokens]\n"
+              << "  encode --model <dir> (--jsonl <file> [--field text] | --lines <file>)\n"
+              << "         [--format text|binary|packed] [--threads <n>] [--ids-out <file>]   # '-' is stdin\n"
+              << "  decode --model <dir> --ids-file <file> [--text-out <file>]   # text or packed ids\n"
+              << "  shard --model <dir> --out <dir> [--documents file|line|jsonl] [--field text]\n"
+              << "        [--dtype auto|uint16|uint32] [--shard-size <bytes>[K|M|G]] [--no-eos]\n"
+              << "        [--threads <n>] <files-or-dirs>...   # rerun with the same args to resume\n"
+              << "  optimize --model <dir> --corpus <files>... [--out <dir>]   # profile-guided trie layout\n"
+              << "  inspect --model <dir> --token <token-string>\n"
+              << "  inspect --model <dir> --profile <files>... [--top <n>] [--cache-sizes <n>,<n>...]\n"
+              << "          [--threads <n>] [--out <file>]   # JSON vocab and cache report; lines are documents\n"
+              << "  train --corpus <files>... --out <dir> [--vocab-size <n>] [--merges <n>]\n"
+              << "        [--pretokenizer default|digits|digits3|gpt2|code|<rules-file>]\n"
+              << "        [--merge-batch <k>] [--threads <n>] [--report-divergence]\n";
 }
 
 static int cmdEncode(int argc, char* argv[]) {
     std::string modelDir, text, idsOut;
-    bool normEnabled = false;
+    forkenizer::NormalizationOptions norm{forkenizer::NormalizationForm::None, false, false};
+    bool specialTokens = true;
+    forkenizer::EncodeMode mode = forkenizer::EncodeMode::Greedy;
+    forkenizer::PipelineOptions pipeline;
+    bool valid = true;
 
     for (int i = 2; i < argc; ++i) {
         std::string arg = argv[i];
         if (arg == "--model" && i + 1 < argc) {
             modelDir = argv[++i];
+        } else if (arg == "--jsonl" && i + 1 < argc) {
+            pipeline.inputPath = argv[++i];
+            pipeline.jsonl = true;
+        } else if (arg == "--lines" && i + 1 < argc) {
+            pipeline.inputPath = argv[++i];
+            pipeline.jsonl = false;
+        } else if (arg == "--field" && i + 1 < argc) {
+            pipeline.field = argv[++i];
+        } else if (arg == "--format" && i + 1 < argc) {
+            std::string format = argv[++i];
+            if (format == "text") {
+                pipeline.format = forkenizer::IdFormat::Text;
+            } else if (format == "binary") {
+                pipeline.format = forkenizer::IdFormat::Binary;
+            } else if (format == "packed") {
+                pipeline.format = forkenizer::IdFormat::Packed;
+            } else {
+                valid = false;
+            }
+        } else if (arg == "--threads" && i + 1 < argc) {
+            pipeline.threads = static_cast<unsigned>(std::stoul(argv[++i]));
         } else if (arg == "--text" && i + 1 < argc) {
             text = argv[++i];
         } else if (arg == "--ids-out" && i + 1 < argc) {
             idsOut = argv[++i];
         } else if (arg == "--norm") {
-            if (i + 1 < argc && std::string(argv[i + 1]) == "on") {
-                normEnabled = true;
-                ++i;
+            if (i + 1 < argc) {
+                std::string form = argv[i + 1];
+                if (form == "on" || form == "nfc") {
+                    norm.form = forkenizer::NormalizationForm::NFC;
+                    ++i;
+                } else if (form == "nfkc") {
+                    norm.form = forkenizer::NormalizationForm::NFKC;
+                    ++i;
+                }
+            }
+        } else if (arg == "--lowercase") {
+            norm.lowercase = true;
+        } else if (arg == "--collapse-ws") {
+            norm.collapseWhitespace = true;
+        } else if (arg == "--no-special") {
+            specialTokens = false;
+        } else if (arg == "--mode" && i + 1 < argc) {
+            std::string name = argv[++i];
+            if (name == "greedy") {
+                mode = forkenizer::EncodeMode::Greedy;
+            } else if (name == "min-tokens") {
+                mode = forkenizer::EncodeMode::MinTokens;
+            } else {
+                valid = false;
             }
         }
     }
 
-    if (modelDir.empty() || text.empty()) {
+    if (!valid || modelDir.empty() || (text.empty() && pipeline.inputPath.empty())) {
         printUsage();
         return 1;
     }
@@ -66,7 +131,25 @@ static int cmdEncode(int argc, char* argv[]) {
         return 1;
     }
 
-    tokenizer.setNormalization(normEnabled);
+    tokenizer.setNormalization(norm);
+    tokenizer.setSpecialTokens(specialTokens);
+    tokenizer.setEncodeMode(mode);
+
+    if (!pipeline.inputPath.empty()) {
+        pipeline.outputPath = idsOut;
+        forkenizer::PipelineStats stats;
+        if (!forkenizer::runEncodePipeline(tokenizer, pipeline, stats)) {
+            std::cerr << "Failed to encode " << pipeline.inputPath << "\n";
+            return 1;
+        }
+        std::cerr << "Encoded " << stats.records << " records, " << stats.tokens << " tokens";
+        if (stats.skipped > 0) {
+            std::cerr << " (" << stats.skipped << " without field \"" << pipeline.field << "\")";
+        }
+        std::cerr << "\n";
+        return 0;
+    }
+
     auto tokens = tokenizer.encode(text);
     if (!tokens.has_value()) {
         std::cerr << "Failed to encode text\n";
@@ -76,7 +159,7 @@ static int cmdEncode(int argc, char* argv[]) {
     std::ostream* out = &std::cout;
     std::ofstream fileOut;
     if (!idsOut.empty()) {
-        fileOut.open(idsOut);
+        fileOut.open(idsOut, std::ios::binary);
         if (!fileOut.is_open()) {
             std::cerr << "Failed to open output file " << idsOut << "\n";
             return 1;
@@ -84,6 +167,15 @@ static int cmdEncode(int argc, char* argv[]) {
         out = &fileOut;
     }
 
+    if (pipeline.format == forkenizer::IdFormat::Packed) {
+        forkenizer::IdStreamWriter writer(*out);
+        if (!writer.addDocument(tokens->data(), tokens->size()) || !writer.finish()) {
+            std::cerr << "Failed to write packed ids\n";
+            return 1;
+        }
+        return 0;
+    }
+
     for (size_t i = 0; i < tokens->size(); ++i) {
         if (i > 0) *out << " ";
         *out << (*tokens)[i];
@@ -93,6 +185,28 @@ static int cmdEncode(int argc, char* argv[]) {
     return 0;
 }
 
+// Decodes a packed id stream a block at a time, writing each document on its own line.
+static bool decodePackedIds(const forkenizer::Tokenizer& tokenizer, const std::string& path, std::ostream& out) {
+    std::ifstream file(path, std::ios::binary);
+    forkenizer::IdStreamReader reader(file);
+    forkenizer::IdBlock block;
+    forkenizer::DecodedBatch decoded;
+    while (reader.readBlock(block)) {
+        if (!tokenizer.decodeBatch(block.ids.data(), block.offsets.data(), block.documents(), {}, decoded)) {
+            std::cerr << "Failed to decode tokens\n";
+            return false;
+        }
+        for (size_t d = 0; d < decoded.size(); ++d) {
+            out << decoded[d] << "\n";
+        }
+    }
+    if (!reader.error().empty()) {
+        std::cerr << "Failed to read packed ids from " << path << ": " << reader.error() << "\n";
+        return false;
+    }
+    return static_cast<bool>(out);
+}
+
 static int cmdDecode(int argc, char* argv[]) {
     std::string modelDir, idsFile, textOut;
 
@@ -112,6 +226,23 @@ static int cmdDecode(int argc, char* argv[]) {
         return 1;
     }
 
+    if (forkenizer::isPackedIdFile(idsFile)) {
+        forkenizer::Tokenizer tokenizer;
+        if (!tokenizer.load(modelDir)) {
+            std::cerr << "Failed to load model from " << modelDir << "\n";
+            return 1;
+        }
+        std::ofstream fileOut;
+        if (!textOut.empty()) {
+            fileOut.open(textOut);
+            if (!fileOut.is_open()) {
+                std::cerr << "Failed to open output file " << textOut << "\n";
+                return 1;
+            }
+        }
+        return decodePackedIds(tokenizer, idsFile, textOut.empty() ? std::cout : fileOut) ? 0 : 1;
+    }
+
     std::ifstream file(idsFile);
     if (!file.is_open()) {
         std::cerr << "Failed to open ids file " << idsFile << "\n";
@@ -152,7 +283,9 @@ static int cmdDecode(int argc, char* argv[]) {
 }
 
 static int cmdInspect(int argc, char* argv[]) {
-    std::string modelDir, token;
+    std::string modelDir, token, outputPath;
+    forkenizer::ProfileOptions profile;
+    bool valid = true;
 
     for (int i = 2; i < argc; ++i) {
         std::string arg = argv[i];
@@ -160,24 +293,69 @@ static int cmdInspect(int argc, char* argv[]) {
             modelDir = argv[++i];
         } else if (arg == "--token" && i + 1 < argc) {
             token = argv[++i];
+        } else if (arg == "--profile") {
+            while (i + 1 < argc && argv[i + 1][0] != '-') {
+                profile.inputs.push_back(argv[++i]);
+            }
+        } else if (arg == "--top" && i + 1 < argc) {
+            profile.topTokens = std::stoul(argv[++i]);
+        } else if (arg == "--cache-sizes" && i + 1 < argc) {
+            profile.cacheSizes.clear();
+            std::string sizes = argv[++i];
+            for (size_t pos = 0; pos < sizes.size();) {
+                size_t comma = std::min(sizes.find(',', pos), sizes.size());
+                if (comma == pos || sizes.find_first_not_of("0123456789", pos) < comma) {
+                    valid = false;
+                    break;
+                }
+                profile.cacheSizes.push_back(std::stoul(sizes.substr(pos, comma - pos)));
+                pos = comma + 1;
+            }
+        } else if (arg == "--threads" && i + 1 < argc) {
+            profile.threads = static_cast<unsigned>(std::stoul(argv[++i]));
+        } else if (arg == "--out" && i + 1 < argc) {
+            outputPath = argv[++i];
         }
     }
 
-    if (modelDir.empty() || token.empty()) {
+    if (!valid || modelDir.empty() || (token.empty() == profile.inputs.empty())) {
         printUsage();
         return 1;
     }
 
+    if (!profile.inputs.empty()) {
+        forkenizer::Tokenizer tokenizer;
+        if (!tokenizer.load(modelDir)) {
+            std::cerr << "Failed to load model from " << modelDir << "\n";
+            return 1;
+        }
+        std::string json, error;
+        if (!forkenizer::profileCorpus(tokenizer, profile, json, error)) {
+            std::cerr << "Profiling failed: " << error << "\n";
+            return 1;
+        }
+        if (outputPath.empty()) {
+            std::cout << json;
+            return 0;
+        }
+        std::ofstream out(outputPath, std::ios::binary);
+        if (!(out << json)) {
+            std::cerr << "Failed to write " << outputPath << "\n";
+            return 1;
+        }
+        return 0;
+    }
+
     forkenizer::ModelData data;
     if (!forkenizer::loadModel(modelDir, data)) {
         std::cerr << "Failed to load model\n";
         return 1;
     }
 
-    auto it = data.tokenToId.find(token);
-    if (it != data.tokenToId.end()) {
+    auto id = data.vocab.find(token);
+    if (id.has_value()) {
         std::cout << "Token: " << token << "\n";
-        std::cout << "ID: " << it->second << "\n";
+        std::cout << "ID: " << *id << "\n";
         std::cout << "Bytes: ";
         for (unsigned char byte : token) {
             std::cout << static_cast<int>(byte) << " ";
@@ -246,6 +424,30 @@ static int cmdDecodeFile(const std::string& modelDir, const std::string& inputFi
         return 1;
     }
 
+    size_t dotPos = inputFile.find_last_of('.');
+    std::string baseName = (dotPos != std::string::npos && dotPos > 0) 
+        ? inputFile.substr(0, dotPos) 
+        : inputFile;
+    std::string outFile = baseName + "_decoded.txt";
+
+    if (forkenizer::isPackedIdFile(inputFile)) {
+        forkenizer::Tokenizer tokenizer;
+        if (!tokenizer.load(modelDir)) {
+            std::cerr << "Failed to load model from " << modelDir << "\n";
+            return 1;
+        }
+        std::ofstream out(outFile);
+        if (!out.is_open()) {
+            std::cerr << "Failed to create " << outFile << "\n";
+            return 1;
+        }
+        if (!decodePackedIds(tokenizer, inputFile, out)) {
+            return 1;
+        }
+        std::cout << "Created: " << outFile << "\n";
+        return 0;
+    }
+
     std::vector<uint32_t> tokens;
     uint32_t id;
     while (file >> id) {
@@ -265,12 +467,6 @@ static int cmdDecodeFile(const std::string& modelDir, const std::string& inputFi
         return 1;
     }
 
-    size_t dotPos = inputFile.find_last_of('.');
-    std::string baseName = (dotPos != std::string::npos && dotPos > 0) 
-        ? inputFile.substr(0, dotPos) 
-        : inputFile;
-    std::string outFile = baseName + "_decoded.txt";
-
     std::ofstream out(outFile);
     if (!out.is_open()) {
         std::cerr << "Failed to create " << outFile << "\n";
@@ -282,11 +478,159 @@ static int cmdDecodeFile(const std::string& modelDir, const std::string& inputFi
     return 0;
 }
 
+static std::optional<uint64_t> parseByteSize(const std::string& text) {
+    size_t consumed = 0;
+    uint64_t value = 0;
+    try {
+        value = std::stoull(text, &consumed);
+    } catch (...) {
+        return std::nullopt;
+    }
+    const std::string suffix = text.substr(consumed);
+    if (suffix == "K") return value << 10;
+    if (suffix == "M") return value << 20;
+    if (suffix == "G") return value << 30;
+    if (suffix.empty()) return value;
+    return std::nullopt;
+}
+
+static int cmdShard(int argc, char* argv[]) {
+    std::string modelDir;
+    forkenizer::ShardOptions options;
+    bool valid = true;
+
+    for (int i = 2; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--model" && i + 1 < argc) {
+            modelDir = argv[++i];
+        } else if (arg == "--out" && i + 1 < argc) {
+            options.outputDir = argv[++i];
+        } else if (arg == "--documents" && i + 1 < argc) {
+            std::string mode = argv[++i];
+            if (mode == "file") {
+                options.documents = forkenizer::ShardDocuments::File;
+            } else if (mode == "line") {
+                options.documents = forkenizer::ShardDocuments::Line;
+            } else if (mode == "jsonl") {
+                options.documents = forkenizer::ShardDocuments::Jsonl;
+            } else {
+                valid = false;
+            }
+        } else if (arg == "--field" && i + 1 < argc) {
+            options.field = argv[++i];
+        } else if (arg == "--dtype" && i + 1 < argc) {
+            std::string dtype = argv[++i];
+            if (dtype == "auto") {
+                options.dtype = forkenizer::ShardDtype::Auto;
+            } else if (dtype == "uint16") {
+                options.dtype = forkenizer::ShardDtype::U16;
+            } else if (dtype == "uint32") {
+                options.dtype = forkenizer::ShardDtype::U32;
+            } else {
+                valid = false;
+            }
+        } else if (arg == "--shard-size" && i + 1 < argc) {
+            auto size = parseByteSize(argv[++i]);
+            valid = valid && size.has_value() && *size > 0;
+            options.shardBytes = size.value_or(0);
+        } else if (arg == "--no-eos") {
+            options.appendEos = false;
+        } else if (arg == "--threads" && i + 1 < argc) {
+            options.threads = static_cast<unsigned>(std::stoul(argv[++i]));
+        } else if (arg[0] != '-') {
+            options.inputs.push_back(arg);
+        } else {
+            valid = false;
+        }
+    }
+
+    if (!valid || modelDir.empty() || options.outputDir.empty() || options.inputs.empty()) {
+        printUsage();
+        return 1;
+    }
+
+    forkenizer::Tokenizer tokenizer;
+    if (!tokenizer.load(modelDir)) {
+        std::cerr << "Failed to load model from " << modelDir << "\n";
+        return 1;
+    }
+
+    forkenizer::ShardStats stats;
+    std::string error;
+    if (!forkenizer::runShard(tokenizer, options, stats, error)) {
+        std::cerr << "Sharding failed: " << error << "\n";
+        return 1;
+    }
+    std::cerr << (stats.resumed ? "Resumed; " : "") << stats.shards << " shards, " << stats.documents
+              << " documents, " << stats.tokens << " tokens in " << options.outputDir << "\n";
+    return 0;
+}
+
+static int cmdOptimize(int argc, char* argv[]) {
+    std::string modelDir, outputDir;
+    std::vector<std::string> corpusFiles;
+
+    for (int i = 2; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--model" && i + 1 < argc) {
+            modelDir = argv[++i];
+        } else if (arg == "--corpus") {
+            while (i + 1 < argc && argv[i + 1][0] != '-') {
+                corpusFiles.push_back(argv[++i]);
+            }
+        } else if (arg == "--out" && i + 1 < argc) {
+            outputDir = argv[++i];
+        }
+    }
+
+    if (modelDir.empty() || corpusFiles.empty()) {
+        printUsage();
+        return 1;
+    }
+    if (outputDir.empty()) {
+        outputDir = modelDir;
+    }
+
+    forkenizer::Tokenizer tokenizer;
+    if (!tokenizer.load(modelDir)) {
+        std::cerr << "Failed to load model from " << modelDir << "\n";
+        return 1;
+    }
+
+    std::vector<std::string> samples;
+    for (const auto& path : corpusFiles) {
+        std::ifstream file(path, std::ios::binary);
+        if (!file.is_open()) {
+            std::cerr << "Failed to open " << path << "\n";
+            return 1;
+        }
+        samples.emplace_back((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+    }
+    std::vector<std::string_view> views(samples.begin(), samples.end());
+
+    forkenizer::TrieLayoutStats stats;
+    if (!tokenizer.optimizeTrieLayout(views, &stats) || !tokenizer.save(outputDir)) {
+        std::cerr << "Optimization failed\n";
+        return 1;
+    }
+
+    std::cout << "Trie nodes: " << stats.nodes << " (" << stats.bytes / 1024 << " KiB)\n";
+    std::cout << "Node visits: " << stats.visits << "\n";
+    std::cout << "90% of visits land in the first " << stats.hotNodes << " nodes (" << stats.hotBytes / 1024
+              << " KiB)\n";
+    std::cout << "Layout profile saved to " << outputDir << "\n";
+    return 0;
+}
+
 static int cmdTrain(int argc, char* argv[]) {
     std::vector<std::string> corpusFiles;
     std::string outputDir;
     uint32_t vocabSize = 256;
     uint32_t numMerges = 32;
+    std::string preTokenizerRules;
+    uint32_t mergeBatch = 1;
+    unsigned threads = 0;
+    bool reportDivergence = false;
 
     for (int i = 2; i < argc; ++i) {
         std::string arg = argv[i];
@@ -300,6 +644,14 @@ static int cmdTrain(int argc, char* argv[]) {
             vocabSize = static_cast<uint32_t>(std::stoul(argv[++i]));
         } else if (arg == "--merges" && i + 1 < argc) {
             numMerges = static_cast<uint32_t>(std::stoul(argv[++i]));
+        } else if (arg == "--pretokenizer" && i + 1 < argc) {
+            preTokenizerRules = argv[++i];
+        } else if (arg == "--merge-batch" && i + 1 < argc) {
+            mergeBatch = static_cast<uint32_t>(std::stoul(argv[++i]));
+        } else if (arg == "--threads" && i + 1 < argc) {
+            threads = static_cast<unsigned>(std::stoul(argv[++i]));
+        } else if (arg == "--report-divergence") {
+            reportDivergence = true;
         }
     }
 
@@ -309,12 +661,73 @@ static int cmdTrain(int argc, char* argv[]) {
     }
 
     forkenizer::Trainer trainer;
+    if (!preTokenizerRules.empty()) {
+        // A readable file is a rule spec; anything else names a preset.
+        std::optional<forkenizer::PreTokenizer> preTokenizer;
+        std::ifstream rulesFile(preTokenizerRules);
+        if (rulesFile.is_open()) {
+            std::string spec((std::istreambuf_iterator<char>(rulesFile)), std::istreambuf_iterator<char>());
+            preTokenizer = forkenizer::PreTokenizer::fromSpec(spec);
+        } else {
+            preTokenizer = forkenizer::PreTokenizer::fromPreset(preTokenizerRules);
+        }
+        if (!preTokenizer.has_value()) {
+            std::cerr << "Invalid pretokenizer rules: " << preTokenizerRules << "\n";
+            return 1;
+        }
+        trainer.setPreTokenizer(*preTokenizer);
+    }
+    trainer.setMergeBatch(mergeBatch);
+    trainer.setNumThreads(threads);
+    auto start = std::chrono::steady_clock::now();
     if (!trainer.train(corpusFiles, outputDir, vocabSize, numMerges)) {
         std::cerr << "Training failed\n";
         return 1;
     }
+    const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
 
     std::cout << "Training completed. Model saved to " << outputDir << "\n";
+    if (!reportDivergence) {
+        return 0;
+    }
+
+    // Train the exact model alongside for comparison, then measure how well each
+    // compresses the training corpus.
+    const std::string exactDir = outputDir + ".exact";
+    trainer.setMergeBatch(1);
+    start = std::chrono::steady_clock::now();
+    if (!trainer.train(corpusFiles, exactDir, vocabSize, numMerges)) {
+        std::cerr << "Exact training failed\n";
+        return 1;
+    }
+    const double exactSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    forkenizer::ModelData approximate, exact;
+    forkenizer::Tokenizer approximateTokenizer, exactTokenizer;
+    if (!forkenizer::loadModel(outputDir, approximate) || !forkenizer::loadModel(exactDir, exact) ||
+        !approximateTokenizer.load(outputDir) || !exactTokenizer.load(exactDir)) {
+        std::cerr << "Failed to reload trained models\n";
+        return 1;
+    }
+    uint64_t bytes = 0, approximateTokens = 0, exactTokens = 0;
+    for (const auto& file : corpusFiles) {
+        std::ifstream in(file);
+        std::string line;
+        while (std::getline(in, line)) {
+            bytes += line.size();
+            approximateTokens += approximateTokenizer.encode(line).value_or(std::vector<uint32_t>{}).size();
+            exactTokens += exactTokenizer.encode(line).value_or(std::vector<uint32_t>{}).size();
+        }
+    }
+    const auto divergence = forkenizer::compareMerges(exact.merges, approximate.merges);
+    const double perByte = bytes == 0 ? 0.0 : 1.0 / static_cast<double>(bytes);
+    std::cout << "Divergence from exact training (exact model in " << exactDir << "):\n"
+              << "  merges:           " << divergence.approximateMerges << " vs " << divergence.exactMerges << " exact\n"
+              << "  identical prefix: " << divergence.commonPrefix << "\n"
+              << "  shared tokens:    " << divergence.sharedTokens << "\n"
+              << "  mean rank shift:  " << divergence.meanRankShift << "\n"
+              << "  tokens/byte:      " << approximateTokens * perByte << " vs " << exactTokens * perByte << " exact\n"
+              << "  train seconds:    " << seconds << " vs " << exactSeconds << " exact\n";
     return 0;
 }
 
@@ -352,7 +765,7 @@ int main(int argc, char* argv[]) {
     }
 
     // Simple train: forkenizer-cli train <corpus>...
-    if (command == "train" && argc >= 3) {
+    if (command == "train" && argc >= 3 && argv[2][0] != '-') {
         std::vector<std::string> files;
         for (int i = 2; i < argc; ++i) {
             files.push_back(argv[i]);
@@ -375,6 +788,10 @@ int main(int argc, char* argv[]) {
         return cmdEncode(argc, argv);
     } else if (command == "decode") {
         return cmdDecode(argc, argv);
+    } else if (command == "optimize") {
+        return cmdOptimize(argc, argv);
+    } else if (command == "shard") {
+        return cmdShard(argc, argv);
     } else if (command == "inspect") {
         return cmdInspect(argc, argv);
     } else if (command == "train") {
@@ -0,0 +1,196 @@
+#include "forkenizer/EmbeddedModel.hpp"
+#include "forkenizer/ModelIO.hpp"
+#include "forkenizer/PreTokenizer.hpp"
+#include "../tokenizer/FlatTrie.hpp"
+#include <cctype>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+// Build-time generator behind the forkenizer_embed_model() CMake function: turns a
+// model directory into <name>.hpp / <name>.cpp holding the tables a Tokenizer binds
+// to through forkenizer::EmbeddedModel.
+
+namespace {
+
+void printUsage() {
+    std::cerr << "Usage: forkenizer-embed --model <dir> --name <identifier> --out-dir <dir>\n";
+}
+
+bool isIdentifier(const std::string& name) {
+    if (name.empty() || std::isdigit(static_cast<unsigned char>(name[0]))) return false;
+    for (char c : name) {
+        if (!std::isalnum(static_cast<unsigned char>(c)) && c != '_') return false;
+    }
+    return true;
+}
+
+// Adjacent string literals, 64 source bytes each; every byte that isn't plain
+// printable ASCII becomes a three-digit octal escape.
+void writeStringLiteral(std::ostream& out, std::string_view bytes) {
+    static const char* octal = "01234567";
+    if (bytes.empty()) {
+        out << " \"\"";
+        return;
+    }
+    for (size_t begin = 0; begin < bytes.size(); begin += 64) {
+        out << "\n    \"";
+        for (size_t i = begin; i < std::min(bytes.size(), begin + 64); ++i) {
+            const unsigned char c = static_cast<unsigned char>(bytes[i]);
+            if (c >= 0x20 && c < 0x7f && c != '"' && c != '\\' && c != '?') {
+                out << static_cast<char>(c);
+            } else {
+                out << '\\' << octal[c >> 6] << octal[(c >> 3) & 7] << octal[c & 7];
+            }
+        }
+        out << '"';
+    }
+}
+
+// Writes `constexpr <type> <name>[] = {...};` and returns the expression for its
+// address, or nullptr for an empty table (C++ has no zero-length arrays).
+template <typename T, typename F>
+std::string writeArray(std::ostream& out, const char* type, const std::string& name, const T* data, size_t size,
+                       F&& element) {
+    if (size == 0) {
+        return "nullptr";
+    }
+    out << "constexpr " << type << " " << name << "[] = {";
+    for (size_t i = 0; i < size; ++i) {
+        out << (i % 12 == 0 ? "\n    " : " ");
+        element(out, data[i]);
+        out << ",";
+    }
+    out << "\n};\n\n";
+    return name;
+}
+
+void writeNumber(std::ostream& out, uint32_t value) { out << value; }
+
+}
+
+int main(int argc, char* argv[]) {
+    std::string modelDir, name, outDir;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--model" && i + 1 < argc) {
+            modelDir = argv[++i];
+        } else if (arg == "--name" && i + 1 < argc) {
+            name = argv[++i];
+        } else if (arg == "--out-dir" && i + 1 < argc) {
+            outDir = argv[++i];
+        } else {
+            printUsage();
+            return 1;
+        }
+    }
+    if (modelDir.empty() || outDir.empty() || !isIdentifier(name)) {
+        printUsage();
+        return 1;
+    }
+
+    forkenizer::ModelData data;
+    if (!forkenizer::loadModel(modelDir, data) || !data.vocab.sealed()) {
+        std::cerr << "Failed to load model from " << modelDir << "\n";
+        return 1;
+    }
+    if (!data.preTokenizerRules.empty() && !forkenizer::PreTokenizer::fromSpec(data.preTokenizerRules)) {
+        std::cerr << "Invalid pretokenizer rules in " << modelDir << "\n";
+        return 1;
+    }
+    forkenizer::FlatTrie trie;
+    if (!trie.build(data.vocab, data.trieProfile)) {
+        std::cerr << "Ignoring trie.profile recorded for a different vocab\n";
+        data.trieProfile.clear();
+    }
+    std::vector<uint32_t> mergeIds;
+    for (const auto& [left, right] : data.merges) {
+        auto leftId = data.vocab.find(left);
+        auto rightId = data.vocab.find(right);
+        if (!leftId || !rightId) {
+            std::cerr << "Merge \"" << left << "\" \"" << right << "\" uses a token missing from the vocab\n";
+            return 1;
+        }
+        mergeIds.push_back(*leftId);
+        mergeIds.push_back(*rightId);
+    }
+
+    const auto& vocab = data.vocab;
+    const auto& hash = vocab.perfectHash();
+    std::ostringstream source;
+    source << "// Generated by forkenizer-embed from " << modelDir << ". Do not edit.\n"
+           << "#include \"" << name << ".hpp\"\n\nnamespace {\n\n";
+
+    source << "constexpr char kArena[] =";
+    writeStringLiteral(source, vocab.arena());
+    source << ";\n\n";
+    const std::string spans = writeArray(source, "forkenizer::Vocab::Span", "kSpans", vocab.spans().data(),
+                                         vocab.spans().size(), [](std::ostream& out, const auto& span) {
+                                             out << "{" << span.offset << ", " << span.length << "}";
+                                         });
+    const std::string pilots = writeArray(source, "uint32_t", "kHashPilots", hash.pilots().data(),
+                                          hash.pilots().size(), writeNumber);
+    const std::string slots = writeArray(source, "forkenizer::PerfectHash::Slot", "kHashSlots", hash.slots().data(),
+                                         hash.slots().size(), [](std::ostream& out, const auto& slot) {
+                                             out << "{" << slot.value << ", " << slot.fingerprint << "u}";
+                                         });
+    const std::string nodes = writeArray(source, "forkenizer::TrieNode", "kTrieNodes", trie.nodes().data(),
+                                         trie.nodes().size(), [](std::ostream& out, const auto& node) {
+                                             out << "{" << node.tokenId << "u, " << node.firstEdge << ", "
+                                                 << node.edgeCount << "}";
+                                         });
+    const std::string labels = writeArray(source, "uint8_t", "kTrieEdgeLabels", trie.edgeLabels().data(),
+                                          trie.edgeLabels().size(), [](std::ostream& out, uint8_t label) {
+                                              out << static_cast<unsigned>(label);
+                                          });
+    const std::string targets = writeArray(source, "uint32_t", "kTrieEdgeTargets", trie.edgeTargets().data(),
+                                           trie.edgeTargets().size(), writeNumber);
+    const std::string root = writeArray(source, "uint32_t", "kTrieRootChildren", trie.rootChildren().data(),
+                                        trie.rootChildren().size(),
+                                        [](std::ostream& out, uint32_t value) { out << value << "u"; });
+    const std::string canonical = writeArray(source, "uint32_t", "kTrieCanonical", trie.canonical().data(),
+                                             trie.canonical().size(), writeNumber);
+    const std::string profile = writeArray(source, "uint32_t", "kTrieProfile", data.trieProfile.data(),
+                                           data.trieProfile.size(), writeNumber);
+    const std::string merges = writeArray(source, "uint32_t", "kMergeIds", mergeIds.data(), mergeIds.size(),
+                                          writeNumber);
+    source << "constexpr char kPreTokenizerRules[] =";
+    writeStringLiteral(source, data.preTokenizerRules);
+    source << ";\n\n}\n\n";
+
+    source << "const forkenizer::EmbeddedModel " << name << " = {\n"
+           << "    kArena, " << vocab.arena().size() << ",\n"
+           << "    " << spans << ", " << vocab.idCount() << ",\n"
+           << "    " << hash.seed() << "ULL,\n"
+           << "    " << pilots << ", " << hash.pilots().size() << ",\n"
+           << "    " << slots << ", " << hash.slots().size() << ",\n"
+           << "    " << nodes << ", " << trie.nodes().size() << ",\n"
+           << "    " << labels << ", " << targets << ", " << trie.edgeLabels().size() << ",\n"
+           << "    " << root << ",\n"
+           << "    " << canonical << ",\n"
+           << "    " << profile << ", " << data.trieProfile.size() << ",\n"
+           << "    " << merges << ", " << data.merges.size() << ",\n"
+           << "    kPreTokenizerRules,\n"
+           << "};\n";
+
+    std::ostringstream header;
+    header << "// Generated by forkenizer-embed from " << modelDir << ". Do not edit.\n"
+           << "#pragma once\n\n#include \"forkenizer/EmbeddedModel.hpp\"\n\n"
+           << "extern const forkenizer::EmbeddedModel " << name << ";\n";
+
+    std::error_code error;
+    std::filesystem::create_directories(outDir, error);
+    const std::filesystem::path base = std::filesystem::path(outDir) / name;
+    std::ofstream sourceFile(base.string() + ".cpp");
+    std::ofstream headerFile(base.string() + ".hpp");
+    sourceFile << source.str();
+    headerFile << header.str();
+    if (!sourceFile.good() || !headerFile.good()) {
+        std::cerr << "Failed to write " << base.string() << ".cpp/.hpp\n";
+        return 1;
+    }
+    return 0;
+}
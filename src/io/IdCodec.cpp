@@ -0,0 +1,318 @@
+#include "forkenizer/IdCodec.hpp"
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cstring>
+#include <fstream>
+#include <istream>
+#include <ostream>
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#endif
+
+namespace forkenizer {
+
+namespace {
+
+constexpr char kMagic[4] = {'F', 'K', 'I', 'D'};
+constexpr uint8_t kVersion = 1;
+constexpr size_t kStreamHeaderBytes = 8;
+constexpr size_t kBlockHeaderBytes = 16;
+constexpr size_t kReadChunkBytes = 1 << 20;
+
+// Per control byte: the data bytes its four ids take, and the pshufb mask that
+// spreads those bytes into four little-endian uint32 lanes.
+struct DecodeTables {
+    uint8_t length[256];
+    uint8_t shuffle[256][16];
+};
+
+constexpr DecodeTables makeDecodeTables() {
+    DecodeTables tables{};
+    for (unsigned control = 0; control < 256; ++control) {
+        uint8_t pos = 0;
+        for (unsigned lane = 0; lane < 4; ++lane) {
+            const uint8_t length = static_cast<uint8_t>(((control >> (2 * lane)) & 3) + 1);
+            for (uint8_t b = 0; b < 4; ++b) {
+                tables.shuffle[control][4 * lane + b] = b < length ? static_cast<uint8_t>(pos + b) : 0xFF;
+            }
+            pos = static_cast<uint8_t>(pos + length);
+        }
+        tables.length[control] = pos;
+    }
+    return tables;
+}
+
+constexpr DecodeTables kTables = makeDecodeTables();
+
+uint32_t toLittleEndian(uint32_t value) {
+    if constexpr (std::endian::native == std::endian::big) {
+        return __builtin_bswap32(value);
+    }
+    return value;
+}
+
+void storeLe32(uint8_t* out, uint32_t value) {
+    value = toLittleEndian(value);
+    std::memcpy(out, &value, sizeof(value));
+}
+
+uint32_t loadLe32(const uint8_t* in) {
+    uint32_t value;
+    std::memcpy(&value, in, sizeof(value));
+    return toLittleEndian(value);
+}
+
+size_t controlBytesFor(size_t count) { return (count + 3) / 4; }
+
+// Every id takes at least one byte, so a count is only as plausible as its byte size.
+size_t minEncodedIdBytes(size_t count) { return controlBytesFor(count) + count; }
+
+bool plausibleByteCount(uint32_t bytes, uint32_t count) {
+    return bytes >= minEncodedIdBytes(count) && bytes <= maxEncodedIdBytes(count);
+}
+
+// Decodes ids [first, count) one at a time; `data` must hold exactly their bytes.
+void decodeScalar(const uint8_t* control, const uint8_t* data, const uint8_t* end, uint32_t* out, size_t first,
+                  size_t count) {
+    for (size_t i = first; i < count; ++i) {
+        const size_t length = ((control[i >> 2] >> ((i & 3) * 2)) & 3) + 1;
+        if (end - data >= 4) {
+            out[i] = loadLe32(data) & (length == 4 ? 0xFFFFFFFFu : (1u << (8 * length)) - 1);
+        } else {
+            uint32_t value = 0;
+            for (size_t b = 0; b < length; ++b) {
+                value |= static_cast<uint32_t>(data[b]) << (8 * b);
+            }
+            out[i] = value;
+        }
+        data += length;
+    }
+}
+
+#if defined(__x86_64__) || defined(__i386__)
+// Decodes whole groups of four while 16 bytes of input remain readable and returns
+// how many groups it finished.
+__attribute__((target("ssse3"))) size_t decodeGroupsSsse3(const uint8_t* control, const uint8_t*& data,
+                                                            const uint8_t* end, uint32_t* out, size_t groups) {
+    size_t g = 0;
+    for (; g < groups && end - data >= 16; ++g) {
+        const uint8_t c = control[g];
+        const __m128i bytes = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data));
+        const __m128i mask = _mm_loadu_si128(reinterpret_cast<const __m128i*>(kTables.shuffle[c]));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(out + 4 * g), _mm_shuffle_epi8(bytes, mask));
+        data += kTables.length[c];
+    }
+    return g;
+}
+
+bool hasSsse3() {
+    static const bool supported = __builtin_cpu_supports("ssse3");
+    return supported;
+}
+#endif
+
+}
+
+size_t maxEncodedIdBytes(size_t count) {
+    return controlBytesFor(count) + count * sizeof(uint32_t);
+}
+
+size_t encodeIds(const uint32_t* ids, size_t count, uint8_t* out) {
+    uint8_t* control = out;
+    uint8_t* data = out + controlBytesFor(count);
+    std::memset(control, 0, controlBytesFor(count));
+    for (size_t i = 0; i < count; ++i) {
+        const uint32_t id = ids[i];
+        const uint32_t code = id < (1u << 8) ? 0 : id < (1u << 16) ? 1 : id < (1u << 24) ? 2 : 3;
+        control[i >> 2] |= static_cast<uint8_t>(code << ((i & 3) * 2));
+        // Every earlier id took at most four bytes, so four more always fit.
+        storeLe32(data, id);
+        data += code + 1;
+    }
+    return static_cast<size_t>(data - out);
+}
+
+bool decodeIds(const uint8_t* in, size_t bytes, uint32_t* out, size_t count) {
+    const size_t controlBytes = controlBytesFor(count);
+    if (bytes < controlBytes) {
+        return false;
+    }
+    const uint8_t* control = in;
+    const size_t groups = count / 4;
+    size_t dataBytes = 0;
+    for (size_t g = 0; g < groups; ++g) {
+        dataBytes += kTables.length[control[g]];
+    }
+    for (size_t i = groups * 4; i < count; ++i) {
+        dataBytes += ((control[i >> 2] >> ((i & 3) * 2)) & 3) + 1;
+    }
+    if (dataBytes != bytes - controlBytes) {
+        return false;
+    }
+
+    const uint8_t* data = in + controlBytes;
+    const uint8_t* end = in + bytes;
+    size_t decoded = 0;
+#if defined(__x86_64__) || defined(__i386__)
+    if (hasSsse3()) {
+        decoded = decodeGroupsSsse3(control, data, end, out, groups) * 4;
+    }
+#endif
+    decodeScalar(control, data, end, out, decoded, count);
+    return true;
+}
+
+IdStreamWriter::IdStreamWriter(std::ostream& out, size_t blockIds)
+    : out_(out), blockIds_(std::max<size_t>(blockIds, 1)) {}
+
+bool IdStreamWriter::addDocument(const uint32_t* ids, size_t count) {
+    if (maxEncodedIdBytes(count) > UINT32_MAX) {
+        return false;
+    }
+    if (maxEncodedIdBytes(ids_.size() + count) > UINT32_MAX && !flush_()) {
+        return false;
+    }
+    ids_.insert(ids_.end(), ids, ids + count);
+    lengths_.push_back(static_cast<uint32_t>(count));
+    if (ids_.size() >= blockIds_) {
+        return flush_();
+    }
+    return static_cast<bool>(out_);
+}
+
+bool IdStreamWriter::finish() {
+    if (!flush_()) {
+        return false;
+    }
+    out_.flush();
+    return static_cast<bool>(out_);
+}
+
+bool IdStreamWriter::flush_() {
+    if (!headerWritten_) {
+        const uint8_t header[kStreamHeaderBytes] = {'F', 'K', 'I', 'D', kVersion, 0, 0, 0};
+        out_.write(reinterpret_cast<const char*>(header), sizeof(header));
+        headerWritten_ = true;
+    }
+    if (lengths_.empty()) {
+        return static_cast<bool>(out_);
+    }
+
+    buffer_.resize(kBlockHeaderBytes + maxEncodedIdBytes(lengths_.size()) + maxEncodedIdBytes(ids_.size()));
+    uint8_t* payload = buffer_.data() + kBlockHeaderBytes;
+    const size_t lengthBytes = encodeIds(lengths_.data(), lengths_.size(), payload);
+    const size_t idBytes = encodeIds(ids_.data(), ids_.size(), payload + lengthBytes);
+    storeLe32(buffer_.data(), static_cast<uint32_t>(lengths_.size()));
+    storeLe32(buffer_.data() + 4, static_cast<uint32_t>(ids_.size()));
+    storeLe32(buffer_.data() + 8, static_cast<uint32_t>(lengthBytes));
+    storeLe32(buffer_.data() + 12, static_cast<uint32_t>(idBytes));
+    out_.write(reinterpret_cast<const char*>(buffer_.data()),
+               static_cast<std::streamsize>(kBlockHeaderBytes + lengthBytes + idBytes));
+    ids_.clear();
+    lengths_.clear();
+    return static_cast<bool>(out_);
+}
+
+IdStreamReader::IdStreamReader(std::istream& in) : in_(in) {
+    uint8_t header[kStreamHeaderBytes];
+    in_.read(reinterpret_cast<char*>(header), sizeof(header));
+    valid_ = in_.gcount() == static_cast<std::streamsize>(sizeof(header)) &&
+             std::memcmp(header, kMagic, sizeof(kMagic)) == 0 && header[4] == kVersion;
+    if (!valid_) {
+        error_ = "not a packed id stream";
+    }
+}
+
+bool IdStreamReader::readHeader_(Header& header) {
+    if (pending_) {
+        header = *pending_;
+        pending_.reset();
+        return true;
+    }
+    uint8_t bytes[kBlockHeaderBytes];
+    in_.read(reinterpret_cast<char*>(bytes), sizeof(bytes));
+    if (in_.gcount() != static_cast<std::streamsize>(sizeof(bytes))) {
+        if (in_.gcount() != 0) {
+            error_ = "truncated block header";
+        }
+        return false;
+    }
+    header = Header{loadLe32(bytes), loadLe32(bytes + 4), loadLe32(bytes + 8), loadLe32(bytes + 12)};
+    if (!plausibleByteCount(header.lengthBytes, header.documents) || !plausibleByteCount(header.idBytes, header.ids)) {
+        error_ = "corrupt block header";
+        return false;
+    }
+    return true;
+}
+
+bool IdStreamReader::readBlock(IdBlock& block) {
+    Header header;
+    if (!valid_ || !error_.empty() || !readHeader_(header)) {
+        return false;
+    }
+
+    // The header's sizes are untrusted, so the buffer grows with the bytes that actually
+    // arrive: a header claiming gigabytes over a short stream allocates about what is there.
+    const size_t payload = static_cast<size_t>(header.lengthBytes) + header.idBytes;
+    buffer_.clear();
+    while (buffer_.size() < payload) {
+        const size_t filled = buffer_.size();
+        buffer_.resize(filled + std::min(payload - filled, std::max(filled, kReadChunkBytes)));
+        const auto want = static_cast<std::streamsize>(buffer_.size() - filled);
+        in_.read(reinterpret_cast<char*>(buffer_.data() + filled), want);
+        if (in_.gcount() != want) {
+            error_ = "truncated block";
+            return false;
+        }
+    }
+    lengths_.resize(header.documents);
+    block.ids.resize(header.ids);
+    if (!decodeIds(buffer_.data(), header.lengthBytes, lengths_.data(), lengths_.size()) ||
+        !decodeIds(buffer_.data() + header.lengthBytes, header.idBytes, block.ids.data(), block.ids.size())) {
+        error_ = "corrupt block";
+        return false;
+    }
+
+    block.offsets.resize(lengths_.size() + 1);
+    block.offsets[0] = 0;
+    for (size_t d = 0; d < lengths_.size(); ++d) {
+        block.offsets[d + 1] = block.offsets[d] + lengths_[d];
+    }
+    if (block.offsets.back() != block.ids.size()) {
+        error_ = "document lengths do not match the block's id count";
+        return false;
+    }
+    nextDocument_ += header.documents;
+    return true;
+}
+
+std::optional<uint64_t> IdStreamReader::seekDocument(uint64_t document) {
+    Header header;
+    while (valid_ && error_.empty() && readHeader_(header)) {
+        if (document < nextDocument_ + header.documents) {
+            pending_ = header;
+            return nextDocument_;
+        }
+        const std::streamoff payload = static_cast<std::streamoff>(header.lengthBytes) + header.idBytes;
+        if (!in_.seekg(payload, std::ios::cur)) {
+            // Pipes can't seek; read past the payload instead.
+            in_.clear();
+            in_.ignore(payload);
+            if (in_.gcount() != payload) {
+                error_ = "truncated block";
+                return std::nullopt;
+            }
+        }
+        nextDocument_ += header.documents;
+    }
+    return std::nullopt;
+}
+
+bool isPackedIdFile(const std::string& path) {
+    std::ifstream file(path, std::ios::binary);
+    char magic[sizeof(kMagic)];
+    return file.read(magic, sizeof(magic)) && std::memcmp(magic, kMagic, sizeof(kMagic)) == 0;
+}
+
+}
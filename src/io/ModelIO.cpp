@@ -1,13 +1,19 @@
 #include "forkenizer/ModelIO.hpp"
+#include <cstdio>
+#include <cstring>
 #include <fstream>
 #include <sstream>
+#include <iomanip>
 #include <cctype>
+#include <string_view>
 #include <sys/stat.h>
 #include <sys/types.h>
 
 namespace forkenizer {
 
-static std::string escapeJsonString(const std::string& str) {
+static constexpr char kTrieProfileMagic[4] = {'F', 'K', 'T', 'P'};
+
+static std::string escapeJsonString(std::string_view str) {
     std::stringstream ss;
     ss << '"';
     for (char c : str) {
@@ -17,7 +23,8 @@ static std::string escapeJsonString(const std::string& str) {
         else if (c == '\r') ss << "\\r";
         else if (c == '\t') ss << "\\t";
         else if (static_cast<unsigned char>(c) < 32) {
-            ss << "\\x" << std::hex << (static_cast<unsigned int>(static_cast<unsigned char>(c)) & 0xFF);
+            ss << "\\x" << std::hex << std::setw(2) << std::setfill('0')
+               << (static_cast<unsigned int>(static_cast<unsigned char>(c)) & 0xFF) << std::dec;
         } else {
             ss << c;
         }
@@ -26,10 +33,9 @@ static std::string escapeJsonString(const std::string& str) {
     return ss.str();
 }
 
-static std::string unescapeJsonString(const std::string& str) {
-    std::string result;
-    result.reserve(str.length());
-    
+static void unescapeJsonString(const std::string& str, std::string& result) {
+    result.clear();
+
     for (size_t i = 0; i < str.length(); ++i) {
         if (str[i] == '\\' && i + 1 < str.length()) {
             ++i;
@@ -59,11 +65,11 @@ static std::string unescapeJsonString(const std::string& str) {
             result += str[i];
         }
     }
-    
-    return result;
 }
 
-static bool parseJsonVocab(const std::string& content, std::unordered_map<std::string, uint32_t>& tokenToId) {
+static bool parseJsonVocab(const std::string& content, Vocab& vocab) {
+    std::string token;
+    std::string unescaped;
     size_t i = 0;
     while (i < content.length() && std::isspace(static_cast<unsigned char>(content[i]))) ++i;
     if (i >= content.length() || content[i] != '{') return false;
@@ -76,7 +82,7 @@ static bool parseJsonVocab(const std::string& content, std::unordered_map<std::s
         if (content[i] != '"') return false;
         
         ++i;
-        std::string token;
+        token.clear();
         while (i < content.length() && content[i] != '"') {
             if (content[i] == '\\' && i + 1 < content.length()) {
                 token += content[i];
@@ -90,7 +96,7 @@ static bool parseJsonVocab(const std::string& content, std::unordered_map<std::s
         if (i >= content.length()) return false;
         ++i;
 
-        token = unescapeJsonString(token);
+        unescapeJsonString(token, unescaped);
 
         while (i < content.length() && std::isspace(static_cast<unsigned char>(content[i]))) ++i;
         if (i >= content.length() || content[i] != ':') return false;
@@ -104,7 +110,7 @@ static bool parseJsonVocab(const std::string& content, std::unordered_map<std::s
             ++i;
         }
 
-        tokenToId[token] = id;
+        vocab.set(unescaped, id);
 
         while (i < content.length() && std::isspace(static_cast<unsigned char>(content[i]))) ++i;
         if (i < content.length() && content[i] == ',') {
@@ -128,21 +134,12 @@ bool loadModel(const std::string& modelDir, ModelData& data) {
                              std::istreambuf_iterator<char>());
     vocabFile.close();
 
-    if (!parseJsonVocab(vocabContent, data.tokenToId)) {
+    // Token bytes never exceed the file size, so the arena is sized once up front.
+    data.vocab.reserve(0, vocabContent.size());
+    if (!parseJsonVocab(vocabContent, data.vocab)) {
         return false;
     }
 
-    uint32_t maxId = 0;
-    for (const auto& pair : data.tokenToId) {
-        if (pair.second > maxId) maxId = pair.second;
-    }
-    data.idToToken.resize(maxId + 1);
-    for (const auto& pair : data.tokenToId) {
-        if (pair.second < data.idToToken.size()) {
-            data.idToToken[pair.second] = pair.first;
-        }
-    }
-
     std::ifstream mergesFile(mergesPath);
     if (mergesFile.is_open()) {
         std::string line;
@@ -159,6 +156,28 @@ bool loadModel(const std::string& modelDir, ModelData& data) {
         mergesFile.close();
     }
 
+    std::ifstream rulesFile(modelDir + "/pretokenizer.rules");
+    if (rulesFile.is_open()) {
+        data.preTokenizerRules.assign((std::istreambuf_iterator<char>(rulesFile)),
+                                      std::istreambuf_iterator<char>());
+    }
+
+    std::ifstream profileFile(modelDir + "/trie.profile", std::ios::binary);
+    if (profileFile.is_open()) {
+        char magic[4];
+        uint32_t count = 0;
+        profileFile.read(magic, sizeof(magic));
+        profileFile.read(reinterpret_cast<char*>(&count), sizeof(count));
+        if (profileFile && std::memcmp(magic, kTrieProfileMagic, sizeof(magic)) == 0) {
+            data.trieProfile.resize(count);
+            profileFile.read(reinterpret_cast<char*>(data.trieProfile.data()), count * sizeof(uint32_t));
+            if (!profileFile) {
+                data.trieProfile.clear();
+            }
+        }
+    }
+
+    data.vocab.seal();
     return true;
 }
 
@@ -187,11 +206,11 @@ bool saveModel(const std::string& modelDir, const ModelData& data) {
 
     vocabFile << '{';
     bool first = true;
-    for (const auto& pair : data.tokenToId) {
+    data.vocab.forEach([&](uint32_t id, std::string_view token) {
         if (!first) vocabFile << ',';
         first = false;
-        vocabFile << '\n' << "  " << escapeJsonString(pair.first) << ": " << pair.second;
-    }
+        vocabFile << '\n' << "  " << escapeJsonString(token) << ": " << id;
+    });
     vocabFile << '\n' << '}' << '\n';
     vocabFile.close();
 
@@ -206,6 +225,30 @@ bool saveModel(const std::string& modelDir, const ModelData& data) {
     }
     mergesFile.close();
 
+    if (!data.preTokenizerRules.empty()) {
+        std::ofstream rulesFile(modelDir + "/pretokenizer.rules");
+        if (!rulesFile.is_open()) {
+            return false;
+        }
+        rulesFile << data.preTokenizerRules;
+    }
+
+    if (!data.trieProfile.empty()) {
+        std::ofstream profileFile(modelDir + "/trie.profile", std::ios::binary);
+        if (!profileFile.is_open()) {
+            return false;
+        }
+        const uint32_t count = static_cast<uint32_t>(data.trieProfile.size());
+        profileFile.write(kTrieProfileMagic, 4);
+        profileFile.write(reinterpret_cast<const char*>(&count), sizeof(count));
+        profileFile.write(reinterpret_cast<const char*>(data.trieProfile.data()), count * sizeof(uint32_t));
+        if (!profileFile) {
+            return false;
+        }
+    } else {
+        std::remove((modelDir + "/trie.profile").c_str());
+    }
+
     return true;
 }
 
@@ -0,0 +1,155 @@
+#include "FlatTrie.hpp"
+#include <algorithm>
+#include <queue>
+#include <utility>
+
+namespace forkenizer {
+
+namespace {
+
+struct BuildNode {
+    uint32_t tokenId = FlatTrie::kNoToken;
+    std::vector<std::pair<uint8_t, uint32_t>> children;
+};
+
+}
+
+bool FlatTrie::build(const Vocab& vocab, const std::vector<uint32_t>& profile) {
+    // Pointer-free build trie; index 0 is the root.
+    std::vector<BuildNode> trie(1);
+    vocab.forEach([&](uint32_t id, std::string_view token) {
+        if (token.empty() || token.size() > kMaxTokenBytes) {
+            return;
+        }
+        uint32_t node = 0;
+        for (unsigned char byte : token) {
+            uint32_t next = kNoNode;
+            for (const auto& [label, target] : trie[node].children) {
+                if (label == byte) {
+                    next = target;
+                    break;
+                }
+            }
+            if (next == kNoNode) {
+                next = static_cast<uint32_t>(trie.size());
+                trie[node].children.emplace_back(byte, next);
+                trie.emplace_back();
+            }
+            node = next;
+        }
+        trie[node].tokenId = id;
+    });
+
+    std::vector<uint32_t> canonicalIndex(trie.size(), kNoNode);
+    uint32_t canonicalCount = 0;
+    std::queue<uint32_t> bfs;
+    bfs.push(0);
+    while (!bfs.empty()) {
+        uint32_t node = bfs.front();
+        bfs.pop();
+        auto& children = trie[node].children;
+        std::sort(children.begin(), children.end());
+        for (const auto& edge : children) {
+            canonicalIndex[edge.second] = canonicalCount++;
+            bfs.push(edge.second);
+        }
+    }
+
+    const bool useProfile = !profile.empty() && profile.size() == canonicalCount;
+    auto visits = [&](uint32_t node) -> uint32_t {
+        return useProfile ? profile[canonicalIndex[node]] : 0;
+    };
+
+    // Best-first by visits, canonical order breaking ties. Children enter the frontier
+    // only once their parent is placed, so parents precede children; with no profile
+    // this reduces to the canonical BFS.
+    auto colder = [&](uint32_t a, uint32_t b) {
+        const uint32_t va = visits(a);
+        const uint32_t vb = visits(b);
+        return va != vb ? va < vb : canonicalIndex[a] > canonicalIndex[b];
+    };
+    std::priority_queue<uint32_t, std::vector<uint32_t>, decltype(colder)> frontier(colder);
+    for (const auto& edge : trie[0].children) {
+        frontier.push(edge.second);
+    }
+    std::vector<uint32_t> order;
+    std::vector<uint32_t> layoutIndex(trie.size(), kNoNode);
+    order.reserve(canonicalCount);
+    while (!frontier.empty()) {
+        uint32_t node = frontier.top();
+        frontier.pop();
+        layoutIndex[node] = static_cast<uint32_t>(order.size());
+        order.push_back(node);
+        for (const auto& edge : trie[node].children) {
+            frontier.push(edge.second);
+        }
+    }
+
+    std::vector<Node> nodes(order.size());
+    std::vector<uint8_t> edgeLabels;
+    std::vector<uint32_t> edgeTargets;
+    std::vector<uint32_t> canonical(order.size());
+    edgeLabels.reserve(order.size());
+    edgeTargets.reserve(order.size());
+    rootChildren_.fill(kNoNode);
+    for (const auto& [label, target] : trie[0].children) {
+        rootChildren_[label] = layoutIndex[target];
+    }
+
+    for (size_t i = 0; i < order.size(); ++i) {
+        BuildNode& source = trie[order[i]];
+        std::stable_sort(source.children.begin(), source.children.end(),
+                         [&](const auto& a, const auto& b) { return visits(a.second) > visits(b.second); });
+        Node& node = nodes[i];
+        node.tokenId = source.tokenId;
+        node.firstEdge = static_cast<uint32_t>(edgeLabels.size());
+        node.edgeCount = static_cast<uint32_t>(source.children.size());
+        for (const auto& [label, target] : source.children) {
+            edgeLabels.push_back(label);
+            edgeTargets.push_back(layoutIndex[target]);
+        }
+        canonical[i] = canonicalIndex[order[i]];
+    }
+    nodes_ = std::move(nodes);
+    edgeLabels_ = std::move(edgeLabels);
+    edgeTargets_ = std::move(edgeTargets);
+    canonical_ = std::move(canonical);
+    return profile.empty() || useProfile;
+}
+
+void FlatTrie::bind(const EmbeddedModel& model) {
+    nodes_ = Table<Node>::borrow(model.trieNodes, model.trieNodeCount);
+    edgeLabels_ = Table<uint8_t>::borrow(model.trieEdgeLabels, model.trieEdgeCount);
+    edgeTargets_ = Table<uint32_t>::borrow(model.trieEdgeTargets, model.trieEdgeCount);
+    canonical_ = Table<uint32_t>::borrow(model.trieCanonical, model.trieNodeCount);
+    std::copy(model.trieRootChildren, model.trieRootChildren + rootChildren_.size(), rootChildren_.begin());
+}
+
+size_t FlatTrie::memoryBytes() const {
+    return nodes_.size() * sizeof(Node) + edgeLabels_.size() + edgeTargets_.size() * sizeof(uint32_t) +
+           sizeof(rootChildren_);
+}
+
+void FlatTrie::countVisits(std::string_view piece, std::vector<uint32_t>& counts) const {
+    size_t pos = 0;
+    while (pos < piece.size()) {
+        const size_t limit = std::min(piece.size() - pos, kMaxTokenBytes);
+        uint32_t node = rootChildren_[static_cast<unsigned char>(piece[pos])];
+        size_t depth = 1;
+        size_t length = 0;
+        while (node != kNoNode) {
+            uint32_t& count = counts[canonical_[node]];
+            if (count != UINT32_MAX) ++count;
+            if (nodes_[node].tokenId != kNoToken) length = depth;
+            if (depth == limit) break;
+            node = child(nodes_[node], static_cast<unsigned char>(piece[pos + depth]));
+            ++depth;
+        }
+        if (length == 0) {
+            break;
+        }
+        pos += length;
+    }
+}
+
+}
@@ -0,0 +1,103 @@
+#pragma once
+
+#include "forkenizer/EmbeddedModel.hpp"
+#include "forkenizer/Table.hpp"
+#include "forkenizer/Vocab.hpp"
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+#include <vector>
+
+namespace forkenizer {
+
+// Byte trie over the vocab stored as flat arrays. Each node's outgoing edges are
+// contiguous, hottest first, and the root fans out through a dense 256-entry table.
+//
+// Nodes have a canonical numbering (BFS, children in byte order) that depends only on
+// the vocab; a profile is one visit count per canonical node. With a profile, nodes
+// are laid out best-first by visits so the paths most text walks share the first cache
+// lines; without one the layout is the canonical BFS.
+class FlatTrie {
+public:
+    static constexpr uint32_t kNoToken = UINT32_MAX;
+    static constexpr uint32_t kNoNode = UINT32_MAX;
+    static constexpr size_t kMaxTokenBytes = 256;
+
+    using Node = TrieNode;
+
+    // Returns false and falls back to the canonical layout when `profile` is non-empty
+    // but was recorded for a different vocab (wrong node count).
+    bool build(const Vocab& vocab, const std::vector<uint32_t>& profile);
+    // Reads an embedded model's trie tables in place.
+    void bind(const EmbeddedModel& model);
+
+    size_t nodeCount() const { return nodes_.size(); }
+    size_t memoryBytes() const;
+
+    // Longest vocab token that is a prefix of text[pos..]; sets `length` and returns
+    // its id, or kNoToken when no token matches.
+    uint32_t longestMatch(std::string_view text, size_t pos, size_t& length) const {
+        const size_t limit = std::min(text.size() - pos, kMaxTokenBytes);
+        if (limit == 0) return kNoToken;
+        uint32_t node = rootChildren_[static_cast<unsigned char>(text[pos])];
+        uint32_t best = kNoToken;
+        size_t depth = 1;
+        while (node != kNoNode) {
+            const Node& current = nodes_[node];
+            if (current.tokenId != kNoToken) {
+                best = current.tokenId;
+                length = depth;
+            }
+            if (depth == limit) break;
+            node = child(current, static_cast<unsigned char>(text[pos + depth]));
+            ++depth;
+        }
+        return best;
+    }
+
+    // Calls fn(tokenId, length) for every vocab token that is a prefix of text[pos..],
+    // shortest first.
+    template <typename F>
+    void forEachMatch(std::string_view text, size_t pos, F&& fn) const {
+        const size_t limit = std::min(text.size() - pos, kMaxTokenBytes);
+        if (limit == 0) return;
+        uint32_t node = rootChildren_[static_cast<unsigned char>(text[pos])];
+        size_t depth = 1;
+        while (node != kNoNode) {
+            const Node& current = nodes_[node];
+            if (current.tokenId != kNoToken) fn(current.tokenId, depth);
+            if (depth == limit) break;
+            node = child(current, static_cast<unsigned char>(text[pos + depth]));
+            ++depth;
+        }
+    }
+
+    // Adds the nodes that greedy longest-match encoding of `piece` visits to
+    // `counts`, indexed canonically. `counts` must have nodeCount() entries.
+    void countVisits(std::string_view piece, std::vector<uint32_t>& counts) const;
+
+    const Table<Node>& nodes() const { return nodes_; }
+    const Table<uint8_t>& edgeLabels() const { return edgeLabels_; }
+    const Table<uint32_t>& edgeTargets() const { return edgeTargets_; }
+    const std::array<uint32_t, 256>& rootChildren() const { return rootChildren_; }
+    const Table<uint32_t>& canonical() const { return canonical_; }
+
+private:
+    uint32_t child(const Node& node, unsigned char byte) const {
+        const uint8_t* labels = edgeLabels_.data() + node.firstEdge;
+        for (uint32_t i = 0; i < node.edgeCount; ++i) {
+            if (labels[i] == byte) return edgeTargets_[node.firstEdge + i];
+        }
+        return kNoNode;
+    }
+
+    Table<Node> nodes_;
+    Table<uint8_t> edgeLabels_;
+    Table<uint32_t> edgeTargets_;
+    std::array<uint32_t, 256> rootChildren_{};
+    Table<uint32_t> canonical_;  // layout index -> canonical index
+};
+
+}
@@ -0,0 +1,51 @@
+#include "forkenizer/Generator.hpp"
+#include <array>
+#include <new>
+
+namespace forkenizer {
+
+namespace {
+
+struct CachedFrame {
+    void* memory = nullptr;
+    size_t size = 0;
+};
+
+constexpr size_t kCachedFrames = 4;
+
+// Frames freed on a thread wait here for the next coroutine started on it. The
+// destructor hands them back when the thread exits.
+struct FrameCache {
+    std::array<CachedFrame, kCachedFrames> frames;
+
+    ~FrameCache() {
+        for (auto& frame : frames) {
+            if (frame.memory != nullptr) ::operator delete(frame.memory, frame.size);
+        }
+    }
+};
+
+thread_local FrameCache frameCache;
+
+}
+
+void* allocateCoroutineFrame(size_t size) {
+    for (auto& frame : frameCache.frames) {
+        if (frame.memory != nullptr && frame.size == size) {
+            return std::exchange(frame.memory, nullptr);
+        }
+    }
+    return ::operator new(size);
+}
+
+void releaseCoroutineFrame(void* memory, size_t size) noexcept {
+    for (auto& frame : frameCache.frames) {
+        if (frame.memory == nullptr) {
+            frame = CachedFrame{memory, size};
+            return;
+        }
+    }
+    ::operator delete(memory, size);
+}
+
+}
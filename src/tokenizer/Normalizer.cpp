@@ -0,0 +1,156 @@
+#include "Normalizer.hpp"
+#include "Unicode.hpp"
+#include <algorithm>
+
+namespace forkenizer {
+
+namespace {
+
+// Bytes that fail UTF-8 validation travel through the code point buffer tagged with
+// this bit and are written back verbatim.
+constexpr uint32_t kRawByteTag = 0x80000000u;
+
+bool isAsciiSpace(char c) {
+    return c == ' ' || c == '\t' || c == '\n' || c == '\r';
+}
+
+bool isAsciiUpper(char c) {
+    return c >= 'A' && c <= 'Z';
+}
+
+}
+
+PieceNormalization Normalizer::normalizePiece(std::string_view piece, bool asciiOnly, bool& previousWasSpace,
+                                              std::string& out) const {
+    if (options_.collapseWhitespace && !piece.empty() && std::all_of(piece.begin(), piece.end(), isAsciiSpace)) {
+        if (previousWasSpace) {
+            return PieceNormalization::Dropped;
+        }
+        previousWasSpace = true;
+        if (piece == " ") {
+            return PieceNormalization::Unchanged;
+        }
+        out.assign(1, ' ');
+        return PieceNormalization::Changed;
+    }
+    previousWasSpace = false;
+
+    if (asciiOnly) {
+        if (!options_.lowercase || std::none_of(piece.begin(), piece.end(), isAsciiUpper)) {
+            return PieceNormalization::Unchanged;
+        }
+        out.assign(piece);
+        for (char& c : out) {
+            if (isAsciiUpper(c)) {
+                c = static_cast<char>(c - 'A' + 'a');
+            }
+        }
+        return PieceNormalization::Changed;
+    }
+
+    if (!needsUnicodePath_(piece)) {
+        return PieceNormalization::Unchanged;
+    }
+    normalizeUnicode_(piece, out);
+    return out == piece ? PieceNormalization::Unchanged : PieceNormalization::Changed;
+}
+
+bool Normalizer::needsUnicodePath_(std::string_view piece) const {
+    uint8_t mask = 0;
+    if (options_.form == NormalizationForm::NFC) mask |= unicode::kNfcMaybe;
+    if (options_.form == NormalizationForm::NFKC) mask |= unicode::kNfkcMaybe;
+    if (options_.lowercase) mask |= unicode::kHasLower;
+
+    size_t i = 0;
+    while (i < piece.size()) {
+        size_t length;
+        uint32_t cp = decodeUtf8(piece, i, length);
+        if (cp != kInvalidCodePoint && (unicode::flags(cp) & mask)) {
+            return true;
+        }
+        i += length;
+    }
+    return false;
+}
+
+void Normalizer::normalizeUnicode_(std::string_view piece, std::string& out) const {
+    const bool decomposeEnabled = options_.form != NormalizationForm::None;
+    const bool compat = options_.form == NormalizationForm::NFKC;
+
+    thread_local std::u32string cps;
+    cps.clear();
+    size_t i = 0;
+    while (i < piece.size()) {
+        size_t length;
+        uint32_t cp = decodeUtf8(piece, i, length);
+        if (cp == kInvalidCodePoint) {
+            cps += static_cast<char32_t>(kRawByteTag | static_cast<unsigned char>(piece[i]));
+        } else if (decomposeEnabled) {
+            const size_t start = cps.size();
+            unicode::decompose(cp, compat, cps);
+            if (options_.lowercase) {
+                for (size_t k = start; k < cps.size(); ++k) {
+                    cps[k] = static_cast<char32_t>(unicode::toLower(cps[k]));
+                }
+            }
+        } else {
+            cps += static_cast<char32_t>(options_.lowercase ? unicode::toLower(cp) : cp);
+        }
+        i += length;
+    }
+
+    auto cccOf = [](char32_t cp) -> uint8_t {
+        return (cp & kRawByteTag) ? 0 : unicode::combiningClass(cp);
+    };
+
+    if (decomposeEnabled) {
+        // Canonical ordering: stable sort of each run of non-starters by combining class.
+        for (size_t k = 1; k < cps.size(); ++k) {
+            const uint8_t cc = cccOf(cps[k]);
+            if (cc == 0) {
+                continue;
+            }
+            size_t j = k;
+            while (j > 0 && cccOf(cps[j - 1]) > cc) {
+                std::swap(cps[j - 1], cps[j]);
+                --j;
+            }
+        }
+
+        // Canonical composition. A mark composes with the last starter unless a
+        // character of equal or higher class (or another starter) sits between them.
+        size_t write = 0;
+        size_t starter = SIZE_MAX;
+        uint8_t lastCcc = 0;
+        for (size_t k = 0; k < cps.size(); ++k) {
+            const char32_t cp = cps[k];
+            const uint8_t cc = cccOf(cp);
+            if (starter != SIZE_MAX && !(cps[starter] & kRawByteTag) && !(cp & kRawByteTag) &&
+                (write == starter + 1 || (lastCcc != 0 && lastCcc < cc))) {
+                const uint32_t composite = unicode::compose(cps[starter], cp);
+                if (composite != kInvalidCodePoint) {
+                    cps[starter] = static_cast<char32_t>(composite);
+                    continue;
+                }
+            }
+            if (cc == 0) {
+                starter = write;
+            }
+            lastCcc = cc;
+            cps[write++] = cp;
+        }
+        cps.resize(write);
+    }
+
+    out.clear();
+    out.reserve(piece.size() + 4);
+    for (char32_t cp : cps) {
+        if (cp & kRawByteTag) {
+            out += static_cast<char>(cp & 0xFF);
+        } else {
+            appendUtf8(cp, out);
+        }
+    }
+}
+
+}
@@ -0,0 +1,38 @@
+#pragma once
+
+#include "forkenizer/Tokenizer.hpp"
+#include <string>
+#include <string_view>
+
+namespace forkenizer {
+
+enum class PieceNormalization : uint8_t { Unchanged, Changed, Dropped };
+
+// Normalizes one pre-token piece. Pieces keep combining marks attached to their base
+// code point, so composition never has to look across a piece boundary. `asciiOnly`
+// lets the caller skip the Unicode path after its own SIMD scan; `previousWasSpace`
+// carries whitespace-collapse state between pieces. On Changed the result is in `out`.
+class Normalizer {
+public:
+    explicit Normalizer(const NormalizationOptions& options) : options_(options) {}
+
+    bool active() const {
+        return options_.form != NormalizationForm::None || options_.lowercase || options_.collapseWhitespace;
+    }
+
+    const NormalizationOptions& options() const { return options_; }
+
+    // Whitespace collapse drops repeated space pieces, so a piece can yield no tokens.
+    bool dropsPieces() const { return options_.collapseWhitespace; }
+
+    PieceNormalization normalizePiece(std::string_view piece, bool asciiOnly, bool& previousWasSpace,
+                                      std::string& out) const;
+
+private:
+    NormalizationOptions options_;
+
+    bool needsUnicodePath_(std::string_view piece) const;
+    void normalizeUnicode_(std::string_view piece, std::string& out) const;
+};
+
+}
@@ -0,0 +1,114 @@
+#include "forkenizer/PerfectHash.hpp"
+#include <algorithm>
+
+namespace forkenizer {
+
+static constexpr uint32_t kKeysPerBucket = 3;
+static constexpr uint32_t kMaxPilot = 1u << 24;
+static constexpr uint32_t kMaxSeedAttempts = 8;
+
+void PerfectHash::clear() {
+    seed_ = 0;
+    pilots_ = Table<uint32_t>();
+    slots_ = Table<Slot>();
+}
+
+void PerfectHash::bind(uint64_t seed, const uint32_t* pilots, size_t pilotCount, const Slot* slots,
+                       size_t slotCount) {
+    seed_ = seed;
+    pilots_ = Table<uint32_t>::borrow(pilots, pilotCount);
+    slots_ = Table<Slot>::borrow(slots, slotCount);
+}
+
+bool PerfectHash::build(const std::vector<std::string_view>& keys, const std::vector<uint32_t>& values) {
+    clear();
+    if (keys.empty() || keys.size() != values.size() || keys.size() > UINT32_MAX) {
+        return false;
+    }
+
+    std::vector<uint64_t> hashes(keys.size());
+    for (uint32_t attempt = 0; attempt < kMaxSeedAttempts; ++attempt) {
+        seed_ = mixHash64(0x6b65795f73656564ULL + attempt);
+        for (size_t i = 0; i < keys.size(); ++i) {
+            hashes[i] = hashBytes(keys[i], seed_);
+        }
+        if (tryBuild_(hashes, values)) {
+            return true;
+        }
+    }
+
+    clear();
+    return false;
+}
+
+bool PerfectHash::tryBuild_(const std::vector<uint64_t>& hashes, const std::vector<uint32_t>& values) {
+    const size_t n = hashes.size();
+    const size_t bucketCount = n / kKeysPerBucket + 1;
+    std::vector<uint32_t> pilots(bucketCount, 0);
+    std::vector<Slot> slots(n);
+    auto bucketOf = [&](uint64_t h) { return reduce_(h, bucketCount); };
+
+    std::vector<uint32_t> bucketStart(bucketCount + 1, 0);
+    for (uint64_t h : hashes) {
+        ++bucketStart[bucketOf(h) + 1];
+    }
+    for (size_t b = 0; b < bucketCount; ++b) {
+        bucketStart[b + 1] += bucketStart[b];
+    }
+    std::vector<uint32_t> members(n);
+    std::vector<uint32_t> fill(bucketStart.begin(), bucketStart.end() - 1);
+    for (uint32_t i = 0; i < n; ++i) {
+        members[fill[bucketOf(hashes[i])]++] = i;
+    }
+
+    // Largest buckets first, while the table still has plenty of free slots.
+    std::vector<uint32_t> order(bucketCount);
+    for (uint32_t b = 0; b < bucketCount; ++b) {
+        order[b] = b;
+    }
+    std::stable_sort(order.begin(), order.end(), [&](uint32_t a, uint32_t b) {
+        return bucketStart[a + 1] - bucketStart[a] > bucketStart[b + 1] - bucketStart[b];
+    });
+
+    std::vector<uint8_t> taken(n, 0);
+    std::vector<size_t> positions;
+    for (uint32_t bucket : order) {
+        const uint32_t begin = bucketStart[bucket];
+        const uint32_t end = bucketStart[bucket + 1];
+        if (begin == end) {
+            break;
+        }
+
+        bool placed = false;
+        for (uint32_t pilot = 0; pilot < kMaxPilot && !placed; ++pilot) {
+            positions.clear();
+            bool ok = true;
+            for (uint32_t m = begin; m < end && ok; ++m) {
+                size_t pos = slotIn_(hashes[members[m]], pilot, seed_, n);
+                ok = !taken[pos] && std::find(positions.begin(), positions.end(), pos) == positions.end();
+                positions.push_back(pos);
+            }
+            if (!ok) {
+                continue;
+            }
+
+            pilots[bucket] = pilot;
+            for (uint32_t m = begin; m < end; ++m) {
+                size_t pos = positions[m - begin];
+                taken[pos] = 1;
+                slots[pos] = Slot{values[members[m]], fingerprintOf_(hashes[members[m]])};
+            }
+            placed = true;
+        }
+
+        if (!placed) {
+            return false;
+        }
+    }
+
+    pilots_ = std::move(pilots);
+    slots_ = std::move(slots);
+    return true;
+}
+
+}
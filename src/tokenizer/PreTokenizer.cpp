@@ -1,111 +1,232 @@
 #include "forkenizer/PreTokenizer.hpp"
-#include <cctype>
+#include "RuleDfa.hpp"
+#include "Unicode.hpp"
 #include <string>
 #include <algorithm>
 
 namespace forkenizer {
 
-static bool isDigit(char c) { return std::isdigit(static_cast<unsigned char>(c)); }
-static bool isLetter(char c) { return std::isalpha(static_cast<unsigned char>(c)); }
-static bool isSpace(char c) { return c == ' ' || c == '\t' || c == '\n' || c == '\r'; }
-static bool isPunct(char c) { return std::ispunct(static_cast<unsigned char>(c)); }
+namespace {
+
+struct Preset {
+    const char* name;
+    const char* spec;
+};
+
+// Leading spaces in patterns are written \x20 because a rule's pattern starts at its
+// first non-blank character.
+constexpr Preset kPresets[] = {
+    {"default",
+     "space     [ \\t\\n\\r]\n"
+     "number    [-+]?[0-9]+(\\.[0-9]*)?([eE][-+]?[0-9]*)?\n"
+     "word      [\\p{L}\\p{M}\\p{N}_][\\p{L}\\p{M}\\p{N}_.]*\n"
+     "operator  <=|>=|!=|->|[-+*/^=<>!%]\n"
+     "other     .\n"},
+    {"digits",
+     "space     [ \\t\\n\\r]\n"
+     "digit     \\p{Nd}\n"
+     "word      [\\p{L}\\p{M}_][\\p{L}\\p{M}_.]*\n"
+     "operator  <=|>=|!=|->|[-+*/^=<>!%]\n"
+     "other     .\n"},
+    {"digits3",
+     "space     [ \\t\\n\\r]\n"
+     "digits    \\p{Nd}(\\p{Nd}\\p{Nd}?)?\n"
+     "word      [\\p{L}\\p{M}_][\\p{L}\\p{M}_.]*\n"
+     "operator  <=|>=|!=|->|[-+*/^=<>!%]\n"
+     "other     .\n"},
+    {"gpt2",
+     "contraction  '(s|t|re|ve|m|ll|d)\n"
+     "letters      \\x20?\\p{L}+\n"
+     "numbers      \\x20?\\p{N}+\n"
+     "symbols      \\x20?[^\\s\\p{L}\\p{N}]+\n"
+     "space        \\s+\n"},
+    {"code",
+     "newline     \\r?\\n\n"
+     "space       [ \\t]+\n"
+     "identifier  [\\p{L}_$][\\p{L}\\p{M}\\p{N}_$]*\n"
+     "number      0[xXbB][0-9a-fA-F_]+|[0-9][0-9_]*(\\.[0-9_]+)?([eE][-+]?[0-9]+)?\n"
+     "operator    <<=|>>=|\\.\\.\\.|::|->|=>|==|!=|<=|>=|&&|\\|\\||<<|>>|\\+\\+|--|[-+*/%&|^]=\n"
+     "other       .\n"},
+};
+
+const char* presetSpec(std::string_view name) {
+    for (const Preset& preset : kPresets) {
+        if (name == preset.name) {
+            return preset.spec;
+        }
+    }
+    return nullptr;
+}
 
-static bool isMathOp(char c) {
-    return c == '+' || c == '-' || c == '*' || c == '/' || c == '^' || 
-           c == '=' || c == '<' || c == '>' || c == '!' || c == '%';
+std::string_view trim(std::string_view s) {
+    while (!s.empty() && (s.front() == ' ' || s.front() == '\t')) s.remove_prefix(1);
+    while (!s.empty() && (s.back() == ' ' || s.back() == '\t' || s.back() == '\r')) s.remove_suffix(1);
+    return s;
 }
 
-std::vector<std::string> PreTokenizer::preTokenize(const std::string& utf8Text) const {
-    std::vector<std::string> tokens;
-    size_t i = 0;
-    const size_t len = utf8Text.length();
+// Spec format, one entry per line in priority order:
+//   # comment
+//   preset <name>      include a built-in preset's rules here
+//   <name> <pattern>   one rule; the pattern runs to the end of the line
+bool parseSpec(std::string_view spec, std::vector<PreTokenRule>& rules, int depth) {
+    size_t pos = 0;
+    while (pos < spec.size()) {
+        size_t eol = spec.find('\n', pos);
+        if (eol == std::string_view::npos) eol = spec.size();
+        std::string_view line = trim(spec.substr(pos, eol - pos));
+        pos = eol + 1;
+        if (line.empty() || line.front() == '#') {
+            continue;
+        }
 
-    while (i < len) {
-        if (isSpace(utf8Text[i])) {
-            tokens.emplace_back(1, utf8Text[i]);
-            ++i;
+        size_t split = line.find_first_of(" \t");
+        if (split == std::string_view::npos) {
+            return false;
+        }
+        std::string_view name = line.substr(0, split);
+        std::string_view rest = trim(line.substr(split));
+        if (rest.empty()) {
+            return false;
+        }
+        if (name == "preset") {
+            const char* included = presetSpec(rest);
+            if (included == nullptr || depth > 0 || !parseSpec(included, rules, depth + 1)) {
+                return false;
+            }
             continue;
         }
+        rules.push_back(PreTokenRule{std::string(name), std::string(rest)});
+    }
+    return true;
+}
 
-        if (isDigit(utf8Text[i]) || ((utf8Text[i] == '-' || utf8Text[i] == '+') && 
-            i + 1 < len && isDigit(utf8Text[i + 1]))) {
-            size_t start = i;
-            bool hasDot = false;
+std::shared_ptr<const RuleDfa> compileSpec(std::string_view spec) {
+    std::vector<PreTokenRule> rules;
+    if (!parseSpec(spec, rules, 0)) {
+        return nullptr;
+    }
+    auto dfa = RuleDfa::compile(rules);
+    if (!dfa.has_value()) {
+        return nullptr;
+    }
+    return std::make_shared<const RuleDfa>(std::move(*dfa));
+}
 
-            if (utf8Text[i] == '-' || utf8Text[i] == '+') {
-                ++i;
-            }
+}
 
-            while (i < len && isDigit(utf8Text[i])) {
-                ++i;
-            }
+PreTokenizer::PreTokenizer() {
+    static const std::shared_ptr<const RuleDfa> defaultDfa = compileSpec(kPresets[0].spec);
+    dfa_ = defaultDfa;
+}
 
-            if (i < len && utf8Text[i] == '.' && !hasDot) {
-                hasDot = true;
-                ++i;
-                while (i < len && isDigit(utf8Text[i])) {
-                    ++i;
-                }
-            }
+std::optional<PreTokenizer> PreTokenizer::fromPreset(std::string_view name) {
+    if (presetSpec(name) == nullptr) {
+        return std::nullopt;
+    }
+    return fromSpec("preset " + std::string(name) + "\n");
+}
 
-            if (i < len && (utf8Text[i] == 'e' || utf8Text[i] == 'E')) {
-                ++i;
-                if (i < len && (utf8Text[i] == '-' || utf8Text[i] == '+')) {
-                    ++i;
-                }
-                while (i < len && isDigit(utf8Text[i])) {
-                    ++i;
-                }
-            }
+std::optional<PreTokenizer> PreTokenizer::fromSpec(std::string_view spec) {
+    auto dfa = compileSpec(spec);
+    if (dfa == nullptr) {
+        return std::nullopt;
+    }
+    PreTokenizer preTokenizer;
+    preTokenizer.dfa_ = std::move(dfa);
+    preTokenizer.spec_ = std::string(spec);
+    return preTokenizer;
+}
 
-            tokens.push_back(utf8Text.substr(start, i - start));
-            continue;
-        }
+std::vector<std::string_view> PreTokenizer::presetNames() {
+    std::vector<std::string_view> names;
+    for (const Preset& preset : kPresets) {
+        names.push_back(preset.name);
+    }
+    return names;
+}
 
-        if (isLetter(utf8Text[i]) || utf8Text[i] == '_') {
-            size_t start = i;
-            while (i < len && (isLetter(utf8Text[i]) || isDigit(utf8Text[i]) || 
-                   utf8Text[i] == '_' || utf8Text[i] == '.')) {
-                ++i;
-            }
-            tokens.push_back(utf8Text.substr(start, i - start));
-            continue;
+std::vector<std::string> PreTokenizer::preTokenize(std::string_view utf8Text) const {
+    std::vector<PreTokenSpan> spans;
+    preTokenizeSpans(utf8Text, spans);
+
+    std::vector<std::string> tokens;
+    tokens.reserve(spans.size());
+    for (const auto& span : spans) {
+        tokens.emplace_back(utf8Text.substr(span.begin, span.end - span.begin));
+    }
+    return tokens;
+}
+
+namespace {
+
+// Shared loop behind both preTokenizeSpans overloads; the tracking one also records
+// how far past each piece's end the scan read before the piece was settled.
+template <bool TrackLookahead>
+void splitSpans(const RuleDfa& dfa, std::string_view utf8Text, std::vector<PreTokenSpan>& spans, size_t maxSpans,
+                size_t& lookahead) {
+    spans.clear();
+    size_t i = 0;
+    const size_t len = utf8Text.length();
+    size_t examined = 0;
+    auto settle = [&](size_t read) {
+        if constexpr (TrackLookahead) {
+            if (!spans.empty()) lookahead = std::max(lookahead, std::max(examined, read) - spans.back().end);
         }
+    };
 
-        if (isMathOp(utf8Text[i])) {
-            if (i + 1 < len) {
-                std::string pair = utf8Text.substr(i, 2);
-                if (pair == "<=" || pair == ">=" || pair == "!=" || pair == "->") {
-                    tokens.push_back(pair);
-                    i += 2;
-                    continue;
-                }
+    while (i < len) {
+        if (static_cast<unsigned char>(utf8Text[i]) >= 0x80 && !spans.empty()) {
+            size_t length;
+            uint32_t cp = decodeUtf8(utf8Text, i, length);
+            // Combining marks stay with the piece before them so normalization can compose them.
+            if (cp != kInvalidCodePoint && (unicode::flags(cp) & unicode::kCombinesBackward)) {
+                i += length;
+                spans.back().end = static_cast<uint32_t>(i);
+                continue;
             }
-            tokens.emplace_back(1, utf8Text[i]);
-            ++i;
-            continue;
+            settle(std::min(i + 4, len + 1));
+        } else {
+            settle(i + 1);
         }
-
-        if (utf8Text[i] == '(' || utf8Text[i] == ')' || 
-            utf8Text[i] == '[' || utf8Text[i] == ']' ||
-            utf8Text[i] == '{' || utf8Text[i] == '}') {
-            tokens.emplace_back(1, utf8Text[i]);
-            ++i;
-            continue;
+        if (spans.size() >= maxSpans) {
+            break;
         }
 
-        if (isPunct(utf8Text[i])) {
-            tokens.emplace_back(1, utf8Text[i]);
-            ++i;
-            continue;
+        size_t end;
+        if constexpr (TrackLookahead) {
+            end = dfa.match(utf8Text, i, examined);
+        } else {
+            end = dfa.match(utf8Text, i);
         }
-
-        tokens.emplace_back(1, utf8Text[i]);
-        ++i;
+        if (end == i) {
+            size_t length;
+            decodeUtf8(utf8Text, i, length);
+            end = i + length;
+            if constexpr (TrackLookahead) {
+                examined = std::max(examined, std::min(i + 4, len + 1));
+            }
+        }
+        spans.push_back(PreTokenSpan{static_cast<uint32_t>(i), static_cast<uint32_t>(end)});
+        i = end;
+    }
+    if (i >= len) {
+        // The last piece was settled by running into the end of the text.
+        settle(len + 1);
     }
+}
 
-    return tokens;
 }
 
+void PreTokenizer::preTokenizeSpans(std::string_view utf8Text, std::vector<PreTokenSpan>& spans,
+                                    size_t maxSpans) const {
+    size_t unused = 0;
+    splitSpans<false>(*dfa_, utf8Text, spans, maxSpans, unused);
 }
 
+void PreTokenizer::preTokenizeSpans(std::string_view utf8Text, std::vector<PreTokenSpan>& spans, size_t maxSpans,
+                                    size_t& lookahead) const {
+    lookahead = 0;
+    splitSpans<true>(*dfa_, utf8Text, spans, maxSpans, lookahead);
+}
+
+}
@@ -0,0 +1,395 @@
+#include "RuleDfa.hpp"
+#include <algorithm>
+#include <cctype>
+#include <map>
+
+namespace forkenizer {
+
+namespace {
+
+constexpr uint32_t kNone = UINT32_MAX;
+constexpr size_t kMaxDfaStates = 4096;
+
+size_t classSymbol(unicode::CharClass cls) {
+    return kRuleAsciiSymbols + static_cast<size_t>(cls);
+}
+
+// All symbols of one general-category class: the matching ASCII bytes plus the
+// class symbol for non-ASCII code points.
+RuleSymbolSet categorySymbols(unicode::CharClass cls) {
+    RuleSymbolSet set;
+    for (uint32_t c = 0; c < kRuleAsciiSymbols; ++c) {
+        if (unicode::charClass(c) == cls) {
+            set.set(c);
+        }
+    }
+    set.set(classSymbol(cls));
+    return set;
+}
+
+std::optional<RuleSymbolSet> namedClass(std::string_view name) {
+    using unicode::CharClass;
+    if (name == "L") return categorySymbols(CharClass::Letter);
+    if (name == "M") return categorySymbols(CharClass::Mark);
+    if (name == "Nd") return categorySymbols(CharClass::Digit);
+    if (name == "N") return categorySymbols(CharClass::Digit) | categorySymbols(CharClass::Number);
+    if (name == "Z") return categorySymbols(CharClass::Space);
+    if (name == "P") return categorySymbols(CharClass::Punct);
+    if (name == "S") return categorySymbols(CharClass::Symbol);
+    if (name == "C") {
+        RuleSymbolSet set = categorySymbols(CharClass::Other);
+        set.set(kRuleInvalidSymbol);
+        return set;
+    }
+    return std::nullopt;
+}
+
+RuleSymbolSet asciiSet(std::string_view chars) {
+    RuleSymbolSet set;
+    for (char c : chars) {
+        set.set(static_cast<unsigned char>(c));
+    }
+    return set;
+}
+
+struct NfaState {
+    RuleSymbolSet symbols;
+    uint32_t next = kNone;
+    std::vector<uint32_t> epsilon;
+    uint32_t acceptRule = kNone;
+};
+
+struct Fragment {
+    uint32_t start;
+    uint32_t end;
+};
+
+// Recursive-descent parser emitting Thompson NFA fragments.
+class PatternParser {
+public:
+    PatternParser(std::string_view pattern, std::vector<NfaState>& nfa) : pattern_(pattern), nfa_(nfa) {}
+
+    std::optional<Fragment> parse() {
+        auto fragment = parseAlternation_();
+        if (!fragment.has_value() || pos_ != pattern_.size()) {
+            return std::nullopt;
+        }
+        return fragment;
+    }
+
+private:
+    std::string_view pattern_;
+    std::vector<NfaState>& nfa_;
+    size_t pos_ = 0;
+
+    uint32_t newState_() {
+        nfa_.emplace_back();
+        return static_cast<uint32_t>(nfa_.size() - 1);
+    }
+
+    Fragment symbolFragment_(const RuleSymbolSet& symbols) {
+        uint32_t start = newState_();
+        uint32_t end = newState_();
+        nfa_[start].symbols = symbols;
+        nfa_[start].next = end;
+        return {start, end};
+    }
+
+    Fragment emptyFragment_() {
+        uint32_t start = newState_();
+        uint32_t end = newState_();
+        nfa_[start].epsilon.push_back(end);
+        return {start, end};
+    }
+
+    bool atEnd_() const { return pos_ >= pattern_.size(); }
+
+    std::optional<Fragment> parseAlternation_() {
+        auto left = parseConcatenation_();
+        if (!left.has_value()) {
+            return std::nullopt;
+        }
+        while (!atEnd_() && pattern_[pos_] == '|') {
+            ++pos_;
+            auto right = parseConcatenation_();
+            if (!right.has_value()) {
+                return std::nullopt;
+            }
+            uint32_t start = newState_();
+            uint32_t end = newState_();
+            nfa_[start].epsilon = {left->start, right->start};
+            nfa_[left->end].epsilon.push_back(end);
+            nfa_[right->end].epsilon.push_back(end);
+            left = Fragment{start, end};
+        }
+        return left;
+    }
+
+    std::optional<Fragment> parseConcatenation_() {
+        std::optional<Fragment> result;
+        while (!atEnd_() && pattern_[pos_] != '|' && pattern_[pos_] != ')') {
+            auto next = parseRepetition_();
+            if (!next.has_value()) {
+                return std::nullopt;
+            }
+            if (result.has_value()) {
+                nfa_[result->end].epsilon.push_back(next->start);
+                result->end = next->end;
+            } else {
+                result = next;
+            }
+        }
+        if (!result.has_value()) {
+            result = emptyFragment_();
+        }
+        return result;
+    }
+
+    std::optional<Fragment> parseRepetition_() {
+        auto atom = parseAtom_();
+        if (!atom.has_value()) {
+            return std::nullopt;
+        }
+        while (!atEnd_() && (pattern_[pos_] == '*' || pattern_[pos_] == '+' || pattern_[pos_] == '?')) {
+            const char op = pattern_[pos_++];
+            uint32_t start = newState_();
+            uint32_t end = newState_();
+            nfa_[start].epsilon.push_back(atom->start);
+            if (op != '+') {
+                nfa_[start].epsilon.push_back(end);
+            }
+            if (op != '?') {
+                nfa_[atom->end].epsilon.push_back(atom->start);
+            }
+            nfa_[atom->end].epsilon.push_back(end);
+            atom = Fragment{start, end};
+        }
+        return atom;
+    }
+
+    std::optional<Fragment> parseAtom_() {
+        const char c = pattern_[pos_];
+        if (c == '(') {
+            ++pos_;
+            auto inner = parseAlternation_();
+            if (!inner.has_value() || atEnd_() || pattern_[pos_] != ')') {
+                return std::nullopt;
+            }
+            ++pos_;
+            return inner;
+        }
+        if (c == '[') {
+            auto set = parseBracket_();
+            if (!set.has_value()) {
+                return std::nullopt;
+            }
+            return symbolFragment_(*set);
+        }
+        if (c == '.') {
+            ++pos_;
+            return symbolFragment_(RuleSymbolSet().set());
+        }
+        if (c == '*' || c == '+' || c == '?' || c == ')') {
+            return std::nullopt;
+        }
+        auto set = parseSingle_();
+        if (!set.has_value()) {
+            return std::nullopt;
+        }
+        return symbolFragment_(*set);
+    }
+
+    // One literal, escape or named class.
+    std::optional<RuleSymbolSet> parseSingle_() {
+        const unsigned char c = static_cast<unsigned char>(pattern_[pos_++]);
+        if (c >= 0x80) {
+            return std::nullopt;
+        }
+        if (c != '\\') {
+            return RuleSymbolSet().set(c);
+        }
+        if (atEnd_()) {
+            return std::nullopt;
+        }
+        const char e = pattern_[pos_++];
+        switch (e) {
+            case 't': return asciiSet("\t");
+            case 'n': return asciiSet("\n");
+            case 'r': return asciiSet("\r");
+            case 'f': return asciiSet("\f");
+            case 'v': return asciiSet("\v");
+            case 'd': return asciiSet("0123456789");
+            case 's': return asciiSet(" \t\n\r\f\v") | categorySymbols(unicode::CharClass::Space);
+            case 'w': return *namedClass("L") | *namedClass("M") | *namedClass("N") | asciiSet("_");
+            case 'x': {
+                if (pos_ + 2 > pattern_.size()) {
+                    return std::nullopt;
+                }
+                unsigned value = 0;
+                for (int k = 0; k < 2; ++k) {
+                    const char h = pattern_[pos_++];
+                    value <<= 4;
+                    if (h >= '0' && h <= '9') value |= static_cast<unsigned>(h - '0');
+                    else if (h >= 'a' && h <= 'f') value |= static_cast<unsigned>(h - 'a' + 10);
+                    else if (h >= 'A' && h <= 'F') value |= static_cast<unsigned>(h - 'A' + 10);
+                    else return std::nullopt;
+                }
+                if (value >= kRuleAsciiSymbols) {
+                    return std::nullopt;
+                }
+                return RuleSymbolSet().set(value);
+            }
+            case 'p': {
+                if (atEnd_() || pattern_[pos_] != '{') {
+                    return std::nullopt;
+                }
+                size_t close = pattern_.find('}', pos_);
+                if (close == std::string_view::npos) {
+                    return std::nullopt;
+                }
+                auto set = namedClass(pattern_.substr(pos_ + 1, close - pos_ - 1));
+                pos_ = close + 1;
+                return set;
+            }
+            default:
+                if (static_cast<unsigned char>(e) >= 0x80 || std::isalnum(static_cast<unsigned char>(e))) {
+                    return std::nullopt;
+                }
+                return RuleSymbolSet().set(static_cast<unsigned char>(e));
+        }
+    }
+
+    std::optional<RuleSymbolSet> parseBracket_() {
+        ++pos_;
+        bool negate = false;
+        if (!atEnd_() && pattern_[pos_] == '^') {
+            negate = true;
+            ++pos_;
+        }
+        RuleSymbolSet set;
+        bool first = true;
+        while (!atEnd_() && (pattern_[pos_] != ']' || first)) {
+            first = false;
+            const bool literal = pattern_[pos_] != '\\';
+            const char low = pattern_[pos_];
+            auto item = parseSingle_();
+            if (!item.has_value()) {
+                return std::nullopt;
+            }
+            if (literal && pos_ + 1 < pattern_.size() && pattern_[pos_] == '-' && pattern_[pos_ + 1] != ']') {
+                ++pos_;
+                const unsigned char high = static_cast<unsigned char>(pattern_[pos_++]);
+                if (high == '\\' || high >= 0x80 || high < static_cast<unsigned char>(low)) {
+                    return std::nullopt;
+                }
+                for (unsigned c = static_cast<unsigned char>(low); c <= high; ++c) {
+                    set.set(c);
+                }
+                continue;
+            }
+            set |= *item;
+        }
+        if (atEnd_()) {
+            return std::nullopt;
+        }
+        ++pos_;
+        return negate ? ~set : set;
+    }
+};
+
+void epsilonClosure(const std::vector<NfaState>& nfa, std::vector<uint32_t>& states) {
+    std::vector<uint32_t> stack(states.begin(), states.end());
+    std::vector<bool> seen(nfa.size(), false);
+    for (uint32_t s : states) {
+        seen[s] = true;
+    }
+    while (!stack.empty()) {
+        uint32_t s = stack.back();
+        stack.pop_back();
+        for (uint32_t t : nfa[s].epsilon) {
+            if (!seen[t]) {
+                seen[t] = true;
+                states.push_back(t);
+                stack.push_back(t);
+            }
+        }
+    }
+    std::sort(states.begin(), states.end());
+}
+
+}
+
+std::optional<RuleDfa> RuleDfa::compile(const std::vector<PreTokenRule>& rules) {
+    if (rules.empty()) {
+        return std::nullopt;
+    }
+
+    std::vector<NfaState> nfa;
+    nfa.emplace_back();
+    std::vector<uint32_t> starts;
+    for (uint32_t r = 0; r < rules.size(); ++r) {
+        PatternParser parser(rules[r].pattern, nfa);
+        auto fragment = parser.parse();
+        if (!fragment.has_value()) {
+            return std::nullopt;
+        }
+        nfa[fragment->end].acceptRule = r;
+        starts.push_back(fragment->start);
+    }
+    nfa[0].epsilon = starts;
+
+    // Subset construction. DFA state 0 is the dead state.
+    RuleDfa dfa;
+    std::map<std::vector<uint32_t>, uint32_t> ids;
+    std::vector<std::vector<uint32_t>> pending;
+
+    auto intern = [&](std::vector<uint32_t> states) -> uint32_t {
+        auto it = ids.find(states);
+        if (it != ids.end()) {
+            return it->second;
+        }
+        const uint32_t id = static_cast<uint32_t>(dfa.acceptRule_.size());
+        uint32_t accept = kNoRule;
+        for (uint32_t s : states) {
+            accept = std::min(accept, nfa[s].acceptRule);
+        }
+        dfa.acceptRule_.push_back(accept);
+        dfa.transitions_.resize(dfa.acceptRule_.size() * kRuleAlphabetSize, static_cast<uint16_t>(kDeadState));
+        ids.emplace(states, id);
+        pending.push_back(std::move(states));
+        return id;
+    };
+
+    dfa.acceptRule_.push_back(kNoRule);
+    dfa.transitions_.resize(kRuleAlphabetSize, static_cast<uint16_t>(kDeadState));
+    std::vector<uint32_t> start{0};
+    epsilonClosure(nfa, start);
+    intern(start);
+
+    for (size_t index = 0; index < pending.size(); ++index) {
+        const std::vector<uint32_t> states = pending[index];
+        const uint32_t from = ids.at(states);
+        for (size_t symbol = 0; symbol < kRuleAlphabetSize; ++symbol) {
+            std::vector<uint32_t> next;
+            for (uint32_t s : states) {
+                if (nfa[s].next != kNone && nfa[s].symbols.test(symbol)) {
+                    next.push_back(nfa[s].next);
+                }
+            }
+            if (next.empty()) {
+                continue;
+            }
+            epsilonClosure(nfa, next);
+            next.erase(std::unique(next.begin(), next.end()), next.end());
+            const uint32_t to = intern(std::move(next));
+            if (dfa.acceptRule_.size() > kMaxDfaStates) {
+                return std::nullopt;
+            }
+            dfa.transitions_[from * kRuleAlphabetSize + symbol] = static_cast<uint16_t>(to);
+        }
+    }
+
+    return dfa;
+}
+
+}
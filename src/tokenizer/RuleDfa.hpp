@@ -0,0 +1,102 @@
+#pragma once
+
+#include "Unicode.hpp"
+#include <algorithm>
+#include <bitset>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+namespace forkenizer {
+
+// Input alphabet of the rule DFA: each ASCII byte is its own symbol, non-ASCII code
+// points collapse to their coarse general-category class, and malformed UTF-8 bytes
+// share one symbol. Tables therefore stay small while classes like \p{L} cover all
+// of Unicode.
+constexpr size_t kRuleAsciiSymbols = 128;
+constexpr size_t kRuleClassSymbols = 8;
+constexpr size_t kRuleInvalidSymbol = kRuleAsciiSymbols + kRuleClassSymbols;
+constexpr size_t kRuleAlphabetSize = kRuleInvalidSymbol + 1;
+
+using RuleSymbolSet = std::bitset<kRuleAlphabetSize>;
+
+struct PreTokenRule {
+    std::string name;
+    std::string pattern;
+};
+
+// Ordered pretokenization rules compiled into one DFA. At each position the first
+// rule (in order) that matches wins and takes its longest match.
+//
+// Pattern syntax: literals, '.', [...] and [^...] classes with ASCII ranges,
+// \p{L} \p{M} \p{N} \p{Nd} \p{Z} \p{P} \p{S} \p{C}, \s \d \w, escapes \t \n \r \f
+// \v \xHH, grouping, '|', and the '*' '+' '?' quantifiers. Literals are ASCII only.
+class RuleDfa {
+public:
+    static std::optional<RuleDfa> compile(const std::vector<PreTokenRule>& rules);
+
+    // End of the winning match starting at pos, or pos if no rule matches.
+    size_t match(std::string_view text, size_t pos) const {
+        size_t examined;
+        return match_<false>(text, pos, examined);
+    }
+    // Also sets examined to one past the last byte the scan read, or text.size() + 1
+    // when it ran into the end of text.
+    size_t match(std::string_view text, size_t pos, size_t& examined) const {
+        return match_<true>(text, pos, examined);
+    }
+
+    size_t stateCount() const { return acceptRule_.size(); }
+
+private:
+    static constexpr uint32_t kDeadState = 0;
+    static constexpr uint32_t kStartState = 1;
+    static constexpr uint32_t kNoRule = UINT32_MAX;
+
+    template <bool TrackExamined>
+    size_t match_(std::string_view text, size_t pos, size_t& examined) const {
+        uint32_t state = kStartState;
+        uint32_t bestRule = kNoRule;
+        size_t bestEnd = pos;
+        size_t p = pos;
+        const size_t size = text.size();
+        if constexpr (TrackExamined) {
+            examined = size + 1;
+        }
+        while (p < size) {
+            const unsigned char c = static_cast<unsigned char>(text[p]);
+            size_t symbol = c;
+            size_t length = 1;
+            if (c >= 0x80) {
+                uint32_t cp = decodeUtf8(text, p, length);
+                symbol = cp == kInvalidCodePoint
+                    ? kRuleInvalidSymbol
+                    : kRuleAsciiSymbols + static_cast<size_t>(unicode::charClass(cp));
+            }
+            state = transitions_[state * kRuleAlphabetSize + symbol];
+            if (state == kDeadState) {
+                if constexpr (TrackExamined) {
+                    // Decoding may look at a whole sequence's worth of bytes.
+                    examined = c >= 0x80 ? std::min(p + 4, size + 1) : p + 1;
+                }
+                break;
+            }
+            p += length;
+            const uint32_t rule = acceptRule_[state];
+            if (rule != kNoRule && rule <= bestRule) {
+                bestRule = rule;
+                bestEnd = p;
+            }
+        }
+        return bestEnd;
+    }
+
+    std::vector<uint16_t> transitions_;
+    // Highest-priority rule accepting in each state, or kNoRule.
+    std::vector<uint32_t> acceptRule_;
+};
+
+}
@@ -0,0 +1,80 @@
+#include "SpecialTokens.hpp"
+#include <algorithm>
+#include <cstring>
+
+namespace forkenizer {
+
+void SpecialTokenMatcher::clear() {
+    patterns_.clear();
+    firstBytes_.fill(0);
+    distinctFirstBytes_ = 0;
+    maxLength_ = 0;
+}
+
+void SpecialTokenMatcher::add(std::string_view token, uint32_t tokenId) {
+    if (token.empty()) {
+        return;
+    }
+    for (auto& pattern : patterns_) {
+        if (pattern.text == token) {
+            pattern.tokenId = tokenId;
+            return;
+        }
+    }
+
+    unsigned char first = static_cast<unsigned char>(token[0]);
+    if (!firstBytes_[first]) {
+        firstBytes_[first] = 1;
+        ++distinctFirstBytes_;
+    }
+    maxLength_ = std::max(maxLength_, token.size());
+    patterns_.push_back(Pattern{std::string(token), tokenId});
+    std::stable_sort(patterns_.begin(), patterns_.end(), [](const Pattern& a, const Pattern& b) {
+        return a.text.size() > b.text.size();
+    });
+}
+
+bool SpecialTokenMatcher::matchAt(std::string_view text, size_t pos, SpecialTokenMatch& match) const {
+    const size_t remaining = text.size() - pos;
+    for (const auto& pattern : patterns_) {
+        if (pattern.text.size() <= remaining &&
+            pattern.text[0] == text[pos] &&
+            std::memcmp(pattern.text.data(), text.data() + pos, pattern.text.size()) == 0) {
+            match = SpecialTokenMatch{pos, pattern.text.size(), pattern.tokenId};
+            return true;
+        }
+    }
+    return false;
+}
+
+SpecialTokenMatch SpecialTokenMatcher::find(std::string_view text, size_t from) const {
+    SpecialTokenMatch match;
+    if (patterns_.empty()) {
+        return match;
+    }
+
+    if (distinctFirstBytes_ == 1) {
+        const char first = patterns_[0].text[0];
+        while (from < text.size()) {
+            const void* hit = std::memchr(text.data() + from, first, text.size() - from);
+            if (hit == nullptr) {
+                break;
+            }
+            size_t pos = static_cast<size_t>(static_cast<const char*>(hit) - text.data());
+            if (matchAt(text, pos, match)) {
+                return match;
+            }
+            from = pos + 1;
+        }
+        return SpecialTokenMatch{};
+    }
+
+    for (size_t pos = from; pos < text.size(); ++pos) {
+        if (firstBytes_[static_cast<unsigned char>(text[pos])] && matchAt(text, pos, match)) {
+            return match;
+        }
+    }
+    return SpecialTokenMatch{};
+}
+
+}
@@ -0,0 +1,44 @@
+#pragma once
+
+#include <array>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+namespace forkenizer {
+
+struct SpecialTokenMatch {
+    size_t pos = std::string_view::npos;
+    size_t length = 0;
+    uint32_t tokenId = 0;
+};
+
+// Finds special tokens in raw text before pretokenization. Candidate positions come
+// from a first-byte filter: memchr (vectorized in libc) when every pattern starts with
+// the same byte, as the reserved <...> tokens do, otherwise a 256-entry byte table.
+// Patterns sharing a first byte are tried longest first.
+class SpecialTokenMatcher {
+public:
+    void clear();
+    void add(std::string_view token, uint32_t tokenId);
+    bool empty() const { return patterns_.empty(); }
+    size_t maxLength() const { return maxLength_; }
+
+    SpecialTokenMatch find(std::string_view text, size_t from) const;
+    bool matchAt(std::string_view text, size_t pos, SpecialTokenMatch& match) const;
+
+private:
+    struct Pattern {
+        std::string text;
+        uint32_t tokenId;
+    };
+
+    std::vector<Pattern> patterns_;
+    std::array<uint8_t, 256> firstBytes_{};
+    size_t distinctFirstBytes_ = 0;
+    size_t maxLength_ = 0;
+};
+
+}
@@ -1,12 +1,45 @@
 #include "forkenizer/Tokenizer.hpp"
+#include "forkenizer/EmbeddedModel.hpp"
 #include "forkenizer/PreTokenizer.hpp"
 #include "forkenizer/ModelIO.hpp"
+#include "SpecialTokens.hpp"
+#include "FlatTrie.hpp"
+#include "Normalizer.hpp"
+#include "Unicode.hpp"
+#include "../util/Parallel.hpp"
 #include <algorithm>
-#include <sstream>
+#include <cstdint>
+#include <cstring>
 
 namespace forkenizer {
 
-Tokenizer::Tokenizer() : preTokenizer_(std::make_unique<PreTokenizer>()) {}
+static constexpr const char* kReservedSpecialTokens[] = {"<pad>", "<unk>", "<bos>", "<eos>"};
+
+Tokenizer::Tokenizer()
+    : trie_(std::make_unique<FlatTrie>()),
+      preTokenizer_(std::make_unique<PreTokenizer>()),
+      specialTokens_(std::make_unique<SpecialTokenMatcher>()),
+      normalizer_(std::make_unique<Normalizer>(NormalizationOptions{NormalizationForm::None, false, false})) {}
+
+Tokenizer::Tokenizer(const EmbeddedModel& model) : Tokenizer() {
+    if (model.preTokenizerRules != nullptr && model.preTokenizerRules[0] != '\0') {
+        auto rules = PreTokenizer::fromSpec(model.preTokenizerRules);
+        if (!rules.has_value()) {
+            return;
+        }
+        *preTokenizer_ = std::move(*rules);
+    }
+
+    PerfectHash perfect;
+    perfect.bind(model.hashSeed, model.hashPilots, model.hashPilotCount, model.hashSlots, model.hashSlotCount);
+    vocab_.bind(std::string_view(model.arena, model.arenaBytes), model.spans, model.idCount, std::move(perfect));
+    trie_->bind(model);
+    embedded_ = &model;
+
+    buildLookupTables_();
+    loaded_ = true;
+}
+
 Tokenizer::~Tokenizer() = default;
 
 bool Tokenizer::load(const std::string& modelDir) {
@@ -15,11 +48,23 @@ bool Tokenizer::load(const std::string& modelDir) {
         return false;
     }
 
-    tokenToId_ = std::move(data.tokenToId);
-    idToToken_ = std::move(data.idToToken);
+    PreTokenizer preTokenizer;
+    if (!data.preTokenizerRules.empty()) {
+        auto rules = PreTokenizer::fromSpec(data.preTokenizerRules);
+        if (!rules.has_value()) {
+            return false;
+        }
+        preTokenizer = std::move(*rules);
+    }
+    *preTokenizer_ = std::move(preTokenizer);
+
+    vocab_ = std::move(data.vocab);
     merges_ = std::move(data.merges);
+    trieProfile_ = std::move(data.trieProfile);
+    embedded_ = nullptr;
 
     buildTrie_();
+    buildLookupTables_();
     loaded_ = true;
     return true;
 }
@@ -30,78 +75,740 @@ bool Tokenizer::save(const std::string& modelDir) const {
     }
 
     ModelData data;
-    data.tokenToId = tokenToId_;
-    data.idToToken = idToToken_;
+    data.vocab = vocab_;
     data.merges = merges_;
+    data.preTokenizerRules = preTokenizer_->spec();
+    data.trieProfile = trieProfile_;
+    if (embedded_ != nullptr) {
+        for (size_t rank = 0; rank < embedded_->mergeCount; ++rank) {
+            data.merges.emplace_back(vocab_.token(embedded_->mergeIds[2 * rank]),
+                                     vocab_.token(embedded_->mergeIds[2 * rank + 1]));
+        }
+        if (trieProfile_.empty()) {
+            data.trieProfile.assign(embedded_->trieProfile, embedded_->trieProfile + embedded_->trieProfileSize);
+        }
+    }
 
     return saveModel(modelDir, data);
 }
 
 void Tokenizer::buildTrie_() {
-    trieRoot_ = std::make_unique<Tokenizer::TrieNode>();
+    // A profile recorded against another vocab only misplaces nodes; drop it.
+    if (!trie_->build(vocab_, trieProfile_)) {
+        trieProfile_.clear();
+    }
+}
 
-    for (const auto& pair : tokenToId_) {
-        TrieNode* node = trieRoot_.get();
-        for (unsigned char byte : pair.first) {
-            if (node->children.find(byte) == node->children.end()) {
-                node->children[byte] = std::make_unique<TrieNode>();
+void Tokenizer::buildLookupTables_() {
+    uint32_t unknownId = vocab_.find("<unk>").value_or(0);
+    for (int byte = 0; byte < 256; ++byte) {
+        char c = static_cast<char>(byte);
+        byteToId_[byte] = vocab_.find(std::string_view(&c, 1)).value_or(unknownId);
+    }
+
+    specialTokens_->clear();
+    specialIds_.clear();
+    for (const char* token : kReservedSpecialTokens) {
+        addSpecialToken(token);
+    }
+}
+
+bool Tokenizer::addSpecialToken(std::string_view token) {
+    auto id = vocab_.find(token);
+    if (!id.has_value()) {
+        return false;
+    }
+    specialTokens_->add(token, *id);
+    if (*id >= specialIds_.size()) {
+        specialIds_.resize(*id + 1, 0);
+    }
+    specialIds_[*id] = 1;
+    return true;
+}
+
+void Tokenizer::setPreTokenizer(const PreTokenizer& preTokenizer) {
+    *preTokenizer_ = preTokenizer;
+}
+
+void Tokenizer::setSpecialTokens(bool enabled) {
+    specialTokensEnabled_ = enabled;
+}
+
+void Tokenizer::setEncodeMode(EncodeMode mode) {
+    encodeMode_ = mode;
+}
+
+void Tokenizer::setTokenCosts(std::vector<float> costs) {
+    tokenCosts_ = std::move(costs);
+}
+
+// Per-call scratch shared by every segment of one encode.
+struct Tokenizer::EncodeState {
+    // Cheapest way to encode piece[i..] for MinTokens: its cost and first token.
+    struct Step {
+        float cost;
+        uint32_t tokenId;
+        uint32_t length;
+    };
+
+    std::vector<PreTokenSpan> spans;
+    std::string normalized;
+    std::vector<Step> path;
+    bool previousWasSpace = false;
+};
+
+namespace {
+
+// Output sinks for the shared encode core. push() receives every token with its
+// source byte range; remaining() lets the core stop pretokenizing and matching once
+// the sink cannot take more tokens.
+struct IdSink {
+    std::vector<uint32_t>& ids;
+    void push(uint32_t id, size_t, size_t) { ids.push_back(id); }
+    size_t remaining() const { return SIZE_MAX; }
+};
+
+struct OffsetSink {
+    Encoding& out;
+    void push(uint32_t id, size_t begin, size_t end) {
+        out.ids.push_back(id);
+        out.begins.push_back(static_cast<uint32_t>(begin));
+        out.ends.push_back(static_cast<uint32_t>(end));
+    }
+    size_t remaining() const { return SIZE_MAX; }
+};
+
+// Writes the first `capacity` tokens into a caller buffer and counts the rest.
+struct BufferSink {
+    uint32_t* data;
+    size_t capacity;
+    size_t count = 0;
+    void push(uint32_t id, size_t, size_t) {
+        if (count < capacity) data[count] = id;
+        ++count;
+    }
+    size_t remaining() const { return SIZE_MAX; }
+};
+
+// Keeps the first `capacity` tokens, written straight into a caller buffer.
+struct HeadSink {
+    uint32_t* data;
+    size_t capacity;
+    size_t count = 0;
+    void push(uint32_t id, size_t, size_t) {
+        if (count < capacity) data[count++] = id;
+    }
+    size_t remaining() const { return capacity - count; }
+};
+
+// Keeps the last `capacity` tokens in a ring over a caller buffer; finish() rotates
+// them into order and returns how many were kept.
+struct TailSink {
+    uint32_t* data;
+    size_t capacity;
+    size_t total = 0;
+    void push(uint32_t id, size_t, size_t) {
+        if (capacity > 0) data[total % capacity] = id;
+        ++total;
+    }
+    size_t remaining() const { return SIZE_MAX; }
+    size_t finish() {
+        if (total <= capacity || capacity == 0) return std::min(total, capacity);
+        std::rotate(data, data + total % capacity, data + capacity);
+        return capacity;
+    }
+};
+
+// Takes pieces instead of tokens: encodePiece_ hands each one over before matching
+// so the sink can count the trie nodes matching would visit.
+struct ProfileSink {
+    const FlatTrie& trie;
+    std::vector<uint32_t>& counts;
+    void profilePiece(std::string_view piece) { trie.countVisits(piece, counts); }
+    void push(uint32_t, size_t, size_t) {}
+    size_t remaining() const { return SIZE_MAX; }
+};
+
+// Records pieces as well as tokens. For applyEdit it also watches for the first piece
+// at or past the edit that starts where an old piece did (shifted by the edit) in the
+// same whitespace state: from there on the old encoding is still right, so it stops.
+struct EditSink {
+    EditableEncoding& out;
+    size_t firstToken = 0;
+    const EditableEncoding* old = nullptr;
+    size_t resyncFrom = SIZE_MAX;
+    size_t shift = 0;  // new position - old position past the edit, mod 2^64
+    size_t resumePiece = SIZE_MAX;
+
+    void beginPiece(size_t begin, bool afterSpace) {
+        if (resumePiece != SIZE_MAX) return;
+        if (begin >= resyncFrom) {
+            const auto& begins = old->pieceBegins;
+            const auto it = std::lower_bound(begins.begin(), begins.end(), static_cast<uint32_t>(begin - shift));
+            if (it != begins.end() && *it == begin - shift &&
+                old->pieceAfterSpace[it - begins.begin()] == static_cast<uint8_t>(afterSpace)) {
+                resumePiece = static_cast<size_t>(it - begins.begin());
+                return;
             }
-            node = node->children[byte].get();
         }
-        node->tokenId = pair.second;
+        out.pieceBegins.push_back(static_cast<uint32_t>(begin));
+        out.pieceFirstTokens.push_back(static_cast<uint32_t>(firstToken + out.tokens.ids.size()));
+        out.pieceAfterSpace.push_back(afterSpace);
+    }
+    void push(uint32_t id, size_t begin, size_t end) {
+        out.tokens.ids.push_back(id);
+        out.tokens.begins.push_back(static_cast<uint32_t>(begin));
+        out.tokens.ends.push_back(static_cast<uint32_t>(end));
+    }
+    size_t remaining() const { return resumePiece == SIZE_MAX ? SIZE_MAX : 0; }
+};
+
+// Overwrites values[begin, end) with replacement, growing or shrinking the vector.
+template <typename T>
+void spliceRange(std::vector<T>& values, size_t begin, size_t end, const std::vector<T>& replacement) {
+    const size_t removed = end - begin;
+    if (replacement.size() > removed) {
+        values.insert(values.begin() + static_cast<std::ptrdiff_t>(end), replacement.size() - removed, T{});
+    } else {
+        values.erase(values.begin() + static_cast<std::ptrdiff_t>(begin + replacement.size()),
+                     values.begin() + static_cast<std::ptrdiff_t>(end));
     }
+    std::copy(replacement.begin(), replacement.end(), values.begin() + static_cast<std::ptrdiff_t>(begin));
+}
+
 }
 
-std::optional<std::vector<uint32_t>> Tokenizer::encode(const std::string& text) const {
+std::optional<std::vector<uint32_t>> Tokenizer::encode(std::string_view text) const {
     if (!loaded_) {
         return std::nullopt;
     }
 
     std::vector<uint32_t> tokenIds;
-    std::vector<std::string> preTokens = preTokenizer_->preTokenize(text);
-
-    for (const auto& preToken : preTokens) {
-        size_t pos = 0;
-        while (pos < preToken.length()) {
-            size_t bestMatchLen = 0;
-            uint32_t bestTokenId = 0;
-            bool found = false;
-
-            for (size_t len = std::min(preToken.length() - pos, size_t(256)); len > 0; --len) {
-                std::string candidate = preToken.substr(pos, len);
-                auto it = tokenToId_.find(candidate);
-                if (it != tokenToId_.end()) {
-                    bestMatchLen = len;
-                    bestTokenId = it->second;
-                    found = true;
-                    break;
-                }
+    IdSink sink{tokenIds};
+    encodeText_(text, sink);
+    return tokenIds;
+}
+
+bool Tokenizer::encodeInto(std::string_view text, std::vector<uint32_t>& out, EncodeScratch& scratch) const {
+    out.clear();
+    if (!loaded_) {
+        return false;
+    }
+
+    IdSink sink{out};
+    encodeText_(text, *scratch.state_, sink);
+    return true;
+}
+
+EncodeScratch::EncodeScratch() : state_(std::make_unique<Tokenizer::EncodeState>()) {}
+EncodeScratch::~EncodeScratch() = default;
+EncodeScratch::EncodeScratch(EncodeScratch&&) noexcept = default;
+EncodeScratch& EncodeScratch::operator=(EncodeScratch&&) noexcept = default;
+
+// A suspended generator keeps its scratch across resumes and several can be live on
+// one thread, so each borrows its own EncodeState from a per-thread free list rather
+// than sharing encodeText_'s.
+class Tokenizer::LazyScratch {
+public:
+    LazyScratch() {
+        auto& pool = freeList_();
+        if (pool.empty()) {
+            state_ = std::make_unique<EncodeState>();
+            ids_ = std::make_unique<std::vector<uint32_t>>();
+        } else {
+            state_ = std::move(pool.back().first);
+            ids_ = std::move(pool.back().second);
+            pool.pop_back();
+        }
+        state_->previousWasSpace = false;
+    }
+    ~LazyScratch() { freeList_().emplace_back(std::move(state_), std::move(ids_)); }
+    LazyScratch(const LazyScratch&) = delete;
+    LazyScratch& operator=(const LazyScratch&) = delete;
+
+    EncodeState& state() { return *state_; }
+    std::vector<uint32_t>& ids() { return *ids_; }
+
+private:
+    using Entry = std::pair<std::unique_ptr<EncodeState>, std::unique_ptr<std::vector<uint32_t>>>;
+    static std::vector<Entry>& freeList_() {
+        thread_local std::vector<Entry> pool;
+        return pool;
+    }
+
+    std::unique_ptr<EncodeState> state_;
+    std::unique_ptr<std::vector<uint32_t>> ids_;
+};
+
+// Pretokens handed to the matcher per resume: small enough that an early stop skips
+// nearly all remaining work, large enough to amortize the pretokenizer call.
+static constexpr size_t kLazySpans = 16;
+
+// Bytes searched for the next special token before the first pretoken chunk; doubled
+// whenever a chunk could read past what the search settled.
+static constexpr size_t kSpecialSearchWindow = 1024;
+
+namespace {
+
+// Special token search for callers that may stop early. It only looks as far ahead as
+// the pretoken chunks read, so consuming a prefix costs about the prefix's length.
+class SpecialTokenWindow {
+public:
+    SpecialTokenWindow(const SpecialTokenMatcher* matcher, std::string_view text)
+        : matcher_(matcher),
+          text_(text),
+          maxSpecial_(matcher != nullptr ? matcher->maxLength() : 0),
+          window_(std::max(kSpecialSearchWindow, 2 * maxSpecial_)) {}
+
+    // Finds the next special token at or after pos. It ends the segment when found;
+    // otherwise no special token starts before settledBefore_, and pieces must be
+    // settled by bytes before it.
+    void search(size_t pos) {
+        searchedFrom_ = pos;
+        special_ = {};
+        segmentEnd_ = text_.size();
+        settledBefore_ = SIZE_MAX;
+        if (matcher_ == nullptr) {
+            return;
+        }
+        const size_t windowEnd = std::min(text_.size(), pos + window_);
+        const SpecialTokenMatch match = matcher_->find(text_.substr(0, windowEnd), pos);
+        const bool found = match.pos != std::string_view::npos;
+        if (found && (windowEnd == text_.size() || match.pos + maxSpecial_ <= windowEnd)) {
+            special_ = match;
+            segmentEnd_ = match.pos;
+        } else if (windowEnd < text_.size()) {
+            // A longer or earlier token could still straddle the window's end, and a piece
+            // reaching the window's end may have been cut by it.
+            segmentEnd_ = windowEnd;
+            settledBefore_ = std::min(match.pos, windowEnd - std::max<size_t>(maxSpecial_, 2) + 1);
+        }
+    }
+
+    // True when a chunk ending at chunkEnd that read lookahead bytes past a piece end is
+    // settled. Otherwise the window is doubled and searched again from the same place.
+    bool settles(size_t chunkEnd, size_t lookahead) {
+        if (settledBefore_ == SIZE_MAX || chunkEnd + lookahead <= settledBefore_) {
+            return true;
+        }
+        window_ *= 2;
+        search(searchedFrom_);
+        return false;
+    }
+
+    const SpecialTokenMatch& special() const { return special_; }
+    size_t segmentEnd() const { return segmentEnd_; }
+
+private:
+    const SpecialTokenMatcher* matcher_;
+    std::string_view text_;
+    size_t maxSpecial_;
+    size_t window_;
+    size_t searchedFrom_ = 0;
+    SpecialTokenMatch special_;
+    size_t segmentEnd_ = 0;
+    size_t settledBefore_ = 0;
+};
+
+}
+
+Generator<uint32_t> Tokenizer::encodeLazy(std::string_view text) const {
+    if (!loaded_) {
+        co_return;
+    }
+
+    LazyScratch scratch;
+    EncodeState& state = scratch.state();
+    std::vector<uint32_t>& ids = scratch.ids();
+    const bool splitSpecials = specialTokensEnabled_ && !specialTokens_->empty();
+    SpecialTokenWindow specials(splitSpecials ? specialTokens_.get() : nullptr, text);
+    size_t pos = 0;
+    bool searched = false;
+    while (pos < text.size()) {
+        if (!searched) {
+            specials.search(pos);
+            searched = true;
+        }
+        if (specials.special().pos == pos) {
+            state.previousWasSpace = false;
+            pos += specials.special().length;
+            searched = false;
+            co_yield specials.special().tokenId;
+            continue;
+        }
+
+        const std::string_view segment = text.substr(pos, specials.segmentEnd() - pos);
+        size_t lookahead = 0;
+        preTokenizer_->preTokenizeSpans(segment, state.spans, kLazySpans, lookahead);
+        const size_t chunkEnd = state.spans.back().end;
+        if (!specials.settles(pos + chunkEnd, lookahead)) {
+            continue;
+        }
+        ids.clear();
+        IdSink sink{ids};
+        encodeSpans_(segment.substr(0, chunkEnd), pos, state, sink);
+        pos += chunkEnd;
+        for (uint32_t id : ids) {
+            co_yield id;
+        }
+    }
+}
+
+size_t Tokenizer::countTokens(std::string_view text, size_t limit) const {
+    size_t count = 0;
+    if (limit == 0) {
+        return 0;
+    }
+    for (uint32_t id : encodeLazy(text)) {
+        (void)id;
+        if (++count == limit) {
+            break;
+        }
+    }
+    return count;
+}
+
+// Encodes text from pos, a piece boundary entered in the given whitespace state, until
+// the sink stops or the text ends. Like encodeLazy it works a chunk of pretokens at a
+// time behind a SpecialTokenWindow, so a region that resyncs early costs about its own
+// length. lookahead is raised to the furthest any piece read past its end.
+template <typename Sink>
+void Tokenizer::encodeFrom_(std::string_view text, size_t pos, bool afterSpace, Sink& sink,
+                            size_t& lookahead) const {
+    thread_local EncodeState state;
+    state.previousWasSpace = afterSpace;
+    const bool splitSpecials = specialTokensEnabled_ && !specialTokens_->empty();
+    SpecialTokenWindow specials(splitSpecials ? specialTokens_.get() : nullptr, text);
+    bool searched = false;
+    while (pos < text.size() && sink.remaining() > 0) {
+        if (!searched) {
+            specials.search(pos);
+            searched = true;
+        }
+        const SpecialTokenMatch& special = specials.special();
+        if (special.pos == pos) {
+            sink.beginPiece(pos, state.previousWasSpace);
+            if (sink.remaining() == 0) {
+                break;
+            }
+            sink.push(special.tokenId, pos, pos + special.length);
+            state.previousWasSpace = false;
+            pos += special.length;
+            searched = false;
+            continue;
+        }
+
+        const std::string_view segment = text.substr(pos, specials.segmentEnd() - pos);
+        size_t chunkLookahead = 0;
+        preTokenizer_->preTokenizeSpans(segment, state.spans, kLazySpans, chunkLookahead);
+        const size_t chunkEnd = state.spans.back().end;
+        if (!specials.settles(pos + chunkEnd, chunkLookahead)) {
+            continue;
+        }
+        lookahead = std::max(lookahead, chunkLookahead);
+        encodeSpans_(segment.substr(0, chunkEnd), pos, state, sink);
+        pos += chunkEnd;
+    }
+}
+
+std::optional<EditableEncoding> Tokenizer::encodeEditable(std::string_view text) const {
+    if (!loaded_ || text.size() > UINT32_MAX) {
+        return std::nullopt;
+    }
+
+    EditableEncoding encoding;
+    EditSink sink{encoding};
+    size_t lookahead = 0;
+    encodeFrom_(text, 0, false, sink, lookahead);
+    encoding.textBytes = static_cast<uint32_t>(text.size());
+    encoding.lookahead = static_cast<uint32_t>(std::min<size_t>(lookahead, UINT32_MAX));
+    return encoding;
+}
+
+bool Tokenizer::applyEdit(std::string_view text, const TextEdit& edit, EditableEncoding& encoding) const {
+    const size_t oldBytes = encoding.textBytes;
+    if (!loaded_ || text.size() > UINT32_MAX || edit.offset > oldBytes || edit.removed > oldBytes - edit.offset ||
+        text.size() != oldBytes - edit.removed + edit.inserted) {
+        return false;
+    }
+
+    // A piece ending at `end` read bytes before end + lookahead, and whether a special
+    // token starts at any of those depends on maxLength - 1 more. Pieces that cannot
+    // reach the edit stay; re-encoding starts at the first one that can.
+    const bool splitSpecials = specialTokensEnabled_ && !specialTokens_->empty();
+    const size_t reach = encoding.lookahead + (splitSpecials ? specialTokens_->maxLength() - 1 : 0);
+    auto& begins = encoding.pieceBegins;
+    const size_t pieces = begins.size();
+    size_t first = 0;
+    if (edit.offset > reach) {
+        const size_t settled = edit.offset - reach;
+        first = static_cast<size_t>(std::upper_bound(begins.begin(), begins.end(), settled) - begins.begin());
+        first = first == 0 ? 0 : first - 1;
+        if (first + 1 == pieces && oldBytes <= settled) {
+            first = pieces;
+        }
+    }
+    const size_t start = first < pieces ? begins[first] : oldBytes;
+    const bool afterSpace = first < pieces ? encoding.pieceAfterSpace[first] != 0 : false;
+    const size_t firstToken = first < pieces ? encoding.pieceFirstTokens[first] : encoding.tokens.ids.size();
+
+    EditableEncoding region;
+    EditSink sink{region, firstToken, &encoding, edit.offset + edit.inserted, edit.inserted - edit.removed};
+    size_t lookahead = encoding.lookahead;
+    encodeFrom_(text, start, afterSpace, sink, lookahead);
+
+    // Old pieces from resumePiece on are kept, shifted by the edit.
+    const size_t resume = std::min(sink.resumePiece, pieces);
+    const size_t resumeToken = resume < pieces ? encoding.pieceFirstTokens[resume] : encoding.tokens.ids.size();
+    const uint32_t byteShift = static_cast<uint32_t>(edit.inserted - edit.removed);
+    const uint32_t tokenShift = static_cast<uint32_t>(region.tokens.ids.size() - (resumeToken - firstToken));
+    for (size_t i = resume; i < pieces; ++i) {
+        begins[i] += byteShift;
+        encoding.pieceFirstTokens[i] += tokenShift;
+    }
+    for (size_t t = resumeToken; t < encoding.tokens.ids.size(); ++t) {
+        encoding.tokens.begins[t] += byteShift;
+        encoding.tokens.ends[t] += byteShift;
+    }
+    spliceRange(begins, first, resume, region.pieceBegins);
+    spliceRange(encoding.pieceFirstTokens, first, resume, region.pieceFirstTokens);
+    spliceRange(encoding.pieceAfterSpace, first, resume, region.pieceAfterSpace);
+    spliceRange(encoding.tokens.ids, firstToken, resumeToken, region.tokens.ids);
+    spliceRange(encoding.tokens.begins, firstToken, resumeToken, region.tokens.begins);
+    spliceRange(encoding.tokens.ends, firstToken, resumeToken, region.tokens.ends);
+    encoding.textBytes = static_cast<uint32_t>(text.size());
+    encoding.lookahead = static_cast<uint32_t>(std::min<size_t>(lookahead, UINT32_MAX));
+    return true;
+}
+
+std::optional<Encoding> Tokenizer::encodeWithOffsets(std::string_view text) const {
+    if (!loaded_) {
+        return std::nullopt;
+    }
+
+    Encoding encoding;
+    OffsetSink sink{encoding};
+    encodeText_(text, sink);
+    return encoding;
+}
+
+size_t Tokenizer::encodeToBuffer(std::string_view text, uint32_t* ids, size_t capacity) const {
+    if (!loaded_) {
+        return 0;
+    }
+
+    BufferSink sink{ids, capacity};
+    encodeText_(text, sink);
+    return sink.count;
+}
+
+bool Tokenizer::encodeBatchPadded(const std::vector<std::string_view>& texts, const BatchEncodeOptions& options,
+                                  uint32_t* ids, uint8_t* attentionMask, uint32_t* lengths) const {
+    if (!loaded_ || ids == nullptr) {
+        return false;
+    }
+
+    const uint32_t padId = vocab_.find("<pad>").value_or(0);
+    auto bosId = vocab_.find("<bos>");
+    auto eosId = vocab_.find("<eos>");
+    if ((options.addBos && !bosId.has_value()) || (options.addEos && !eosId.has_value())) {
+        return false;
+    }
+
+    const size_t maxLength = options.maxLength;
+    const size_t bosCount = options.addBos && maxLength > 0 ? 1 : 0;
+    const size_t eosCount = options.addEos && maxLength > bosCount ? 1 : 0;
+    const size_t contentCapacity = maxLength - bosCount - eosCount;
+
+    parallelFor(texts.size(), options.numThreads, 16, [&](unsigned, size_t begin, size_t end) {
+        for (size_t row = begin; row < end; ++row) {
+            uint32_t* rowIds = ids + row * maxLength;
+            uint32_t* content = rowIds + bosCount;
+
+            size_t contentLength = 0;
+            if (options.truncationSide == TruncationSide::Right) {
+                HeadSink sink{content, contentCapacity};
+                encodeText_(texts[row], sink);
+                contentLength = sink.count;
+            } else {
+                TailSink sink{content, contentCapacity};
+                encodeText_(texts[row], sink);
+                contentLength = sink.finish();
             }
 
-            if (found) {
-                tokenIds.push_back(bestTokenId);
-                pos += bestMatchLen;
+            if (bosCount) rowIds[0] = *bosId;
+            if (eosCount) rowIds[bosCount + contentLength] = *eosId;
+            const size_t length = bosCount + contentLength + eosCount;
+
+            if (options.paddingSide == PaddingSide::Left && length < maxLength) {
+                std::copy_backward(rowIds, rowIds + length, rowIds + maxLength);
+                std::fill(rowIds, rowIds + (maxLength - length), padId);
             } else {
-                for (size_t i = pos; i < preToken.length(); ++i) {
-                    unsigned char byte = static_cast<unsigned char>(preToken[i]);
-                    std::string byteStr(1, static_cast<char>(byte));
-                    auto it = tokenToId_.find(byteStr);
-                    if (it != tokenToId_.end()) {
-                        tokenIds.push_back(it->second);
-                    } else {
-                        uint32_t fallbackId = 1;
-                        if (!idToToken_.empty()) {
-                            fallbackId = 0;
-                        }
-                        tokenIds.push_back(fallbackId);
-                    }
+                std::fill(rowIds + length, rowIds + maxLength, padId);
+            }
+
+            if (attentionMask != nullptr) {
+                uint8_t* rowMask = attentionMask + row * maxLength;
+                const size_t padCount = maxLength - length;
+                if (options.paddingSide == PaddingSide::Left) {
+                    std::fill(rowMask, rowMask + padCount, uint8_t(0));
+                    std::fill(rowMask + padCount, rowMask + maxLength, uint8_t(1));
+                } else {
+                    std::fill(rowMask, rowMask + length, uint8_t(1));
+                    std::fill(rowMask + length, rowMask + maxLength, uint8_t(0));
                 }
+            }
+            if (lengths != nullptr) {
+                lengths[row] = static_cast<uint32_t>(length);
+            }
+        }
+    });
+
+    return true;
+}
+
+template <typename Sink>
+void Tokenizer::encodeText_(std::string_view text, Sink& sink) const {
+    // Per-thread scratch keeps the span and normalization buffers warm across calls.
+    thread_local EncodeState state;
+    encodeText_(text, state, sink);
+}
+
+template <typename Sink>
+void Tokenizer::encodeText_(std::string_view text, EncodeState& state, Sink& sink) const {
+    state.previousWasSpace = false;
+    if (!specialTokensEnabled_ || specialTokens_->empty()) {
+        encodeSegment_(text, 0, state, sink);
+        return;
+    }
+
+    // Special tokens are cut out of the raw text first so the pretokenizer never splits them.
+    size_t pos = 0;
+    while (pos < text.size() && sink.remaining() > 0) {
+        SpecialTokenMatch match = specialTokens_->find(text, pos);
+        if (match.pos == std::string_view::npos) {
+            encodeSegment_(text.substr(pos), pos, state, sink);
+            break;
+        }
+        if (match.pos > pos) {
+            encodeSegment_(text.substr(pos, match.pos - pos), pos, state, sink);
+            if (sink.remaining() == 0) {
                 break;
             }
         }
+        sink.push(match.tokenId, match.pos, match.pos + match.length);
+        state.previousWasSpace = false;
+        pos = match.pos + match.length;
     }
+}
 
-    return tokenIds;
+template <typename Sink>
+void Tokenizer::encodeSegment_(std::string_view text, size_t baseOffset, EncodeState& state, Sink& sink) const {
+    // Every kept pretoken yields at least one token, so a bounded sink bounds the pretokens
+    // too, unless collapsed whitespace pieces may be dropped.
+    preTokenizer_->preTokenizeSpans(text, state.spans, normalizer_->dropsPieces() ? SIZE_MAX : sink.remaining());
+    encodeSpans_(text, baseOffset, state, sink);
+}
+
+// Encodes the pretokens in state.spans, which index into text.
+template <typename Sink>
+void Tokenizer::encodeSpans_(std::string_view text, size_t baseOffset, EncodeState& state, Sink& sink) const {
+    if (!normalizer_->active()) {
+        for (const auto& span : state.spans) {
+            if constexpr (requires { sink.beginPiece(span.begin, false); }) {
+                sink.beginPiece(baseOffset + span.begin, state.previousWasSpace);
+            }
+            if (sink.remaining() == 0) {
+                break;
+            }
+            encodePiece_(text.substr(span.begin, span.end - span.begin), baseOffset + span.begin,
+                         baseOffset + span.end, true, state, sink);
+        }
+        return;
+    }
+
+    // Normalization is fused per piece: a forward SIMD scan finds the next non-ASCII
+    // byte, and pieces ending before it skip the Unicode tables entirely.
+    size_t nextNonAscii = findNonAscii(text, 0);
+    for (const auto& span : state.spans) {
+        if constexpr (requires { sink.beginPiece(span.begin, false); }) {
+            sink.beginPiece(baseOffset + span.begin, state.previousWasSpace);
+        }
+        if (sink.remaining() == 0) {
+            break;
+        }
+        if (nextNonAscii < span.begin) {
+            nextNonAscii = findNonAscii(text, span.begin);
+        }
+        std::string_view piece = text.substr(span.begin, span.end - span.begin);
+        const bool asciiOnly = span.end <= nextNonAscii;
+        switch (normalizer_->normalizePiece(piece, asciiOnly, state.previousWasSpace, state.normalized)) {
+            case PieceNormalization::Dropped:
+                break;
+            case PieceNormalization::Unchanged:
+                encodePiece_(piece, baseOffset + span.begin, baseOffset + span.end, true, state, sink);
+                break;
+            case PieceNormalization::Changed:
+                encodePiece_(state.normalized, baseOffset + span.begin, baseOffset + span.end,
+                             state.normalized.size() == piece.size(), state, sink);
+                break;
+        }
+    }
+}
+
+template <typename Sink>
+void Tokenizer::encodePiece_(std::string_view piece, size_t sourceBegin, size_t sourceEnd, bool exactOffsets,
+                             EncodeState& state, Sink& sink) const {
+    auto push = [&](uint32_t id, size_t begin, size_t end) {
+        if (exactOffsets) {
+            sink.push(id, sourceBegin + begin, sourceBegin + end);
+        } else {
+            sink.push(id, sourceBegin, sourceEnd);
+        }
+    };
+
+    if constexpr (requires { sink.profilePiece(piece); }) {
+        sink.profilePiece(piece);
+        return;
+    }
+
+    if (encodeMode_ == EncodeMode::MinTokens) {
+        // Backward pass: path[i] is the cheapest split of piece[i..], over every token
+        // that matches at i plus the byte fallback. Matches come shortest first and
+        // ties go to the later one, so equal-cost splits prefer longer tokens.
+        auto cost = [&](uint32_t id) { return id < tokenCosts_.size() ? tokenCosts_[id] : 1.0f; };
+        auto& path = state.path;
+        const size_t n = piece.size();
+        path.resize(n + 1);
+        path[n] = {0.0f, 0, 0};
+        for (size_t i = n; i-- > 0;) {
+            const uint32_t byteId = byteToId_[static_cast<unsigned char>(piece[i])];
+            path[i] = {cost(byteId) + path[i + 1].cost, byteId, 1};
+            trie_->forEachMatch(piece, i, [&](uint32_t id, size_t length) {
+                const float total = cost(id) + path[i + length].cost;
+                if (total <= path[i].cost) path[i] = {total, id, static_cast<uint32_t>(length)};
+            });
+        }
+        for (size_t pos = 0; pos < n; pos += path[pos].length) {
+            push(path[pos].tokenId, pos, pos + path[pos].length);
+        }
+        return;
+    }
+
+    size_t pos = 0;
+    while (pos < piece.length()) {
+        size_t matchLength = 0;
+        const uint32_t tokenId = trie_->longestMatch(piece, pos, matchLength);
+        if (tokenId != FlatTrie::kNoToken) {
+            push(tokenId, pos, pos + matchLength);
+            pos += matchLength;
+        } else {
+            for (size_t i = pos; i < piece.length(); ++i) {
+                push(byteToId_[static_cast<unsigned char>(piece[i])], i, i + 1);
+            }
+            break;
+        }
+    }
 }
 
 std::optional<std::string> Tokenizer::decode(const std::vector<uint32_t>& tokens) const {
@@ -109,18 +816,202 @@ std::optional<std::string> Tokenizer::decode(const std::vector<uint32_t>& tokens
         return std::nullopt;
     }
 
-    std::stringstream ss;
+    size_t totalBytes = 0;
+    for (uint32_t tokenId : tokens) {
+        totalBytes += vocab_.token(tokenId).size();
+    }
+
+    std::string text;
+    text.reserve(totalBytes);
     for (uint32_t tokenId : tokens) {
-        if (tokenId < idToToken_.size()) {
-            ss << idToToken_[tokenId];
+        text += vocab_.token(tokenId);
+    }
+
+    return text;
+}
+
+size_t Tokenizer::decodeToBuffer(const uint32_t* tokens, size_t count, char* out, size_t capacity) const {
+    if (!loaded_) {
+        return 0;
+    }
+
+    size_t written = 0;
+    for (size_t i = 0; i < count; ++i) {
+        std::string_view piece = vocab_.token(tokens[i]);
+        if (written < capacity) {
+            std::memcpy(out + written, piece.data(), std::min(piece.size(), capacity - written));
+        }
+        written += piece.size();
+    }
+    return written;
+}
+
+bool Tokenizer::decodeBatch(const std::vector<std::vector<uint32_t>>& sequences, const BatchDecodeOptions& options,
+                            DecodedBatch& out) const {
+    auto sequence = [&](size_t i) {
+        return std::pair<const uint32_t*, size_t>(sequences[i].data(), sequences[i].size());
+    };
+    return decodeBatch_(sequences.size(), sequence, options, out);
+}
+
+bool Tokenizer::decodeBatch(const uint32_t* ids, const size_t* idOffsets, size_t count,
+                            const BatchDecodeOptions& options, DecodedBatch& out) const {
+    if (count > 0 && (ids == nullptr || idOffsets == nullptr)) {
+        return false;
+    }
+    auto sequence = [&](size_t i) {
+        return std::pair<const uint32_t*, size_t>(ids + idOffsets[i], idOffsets[i + 1] - idOffsets[i]);
+    };
+    return decodeBatch_(count, sequence, options, out);
+}
+
+// Two passes: size every sequence, prefix-sum the offsets, then write each sequence
+// into its slot. Both passes split sequences across threads.
+template <typename Sequence>
+bool Tokenizer::decodeBatch_(size_t count, const Sequence& sequence, const BatchDecodeOptions& options,
+                             DecodedBatch& out) const {
+    if (!loaded_) {
+        return false;
+    }
+
+    auto skipped = [&](uint32_t id) {
+        return options.skipSpecialTokens && id < specialIds_.size() && specialIds_[id];
+    };
+    // Raw bytes of one sequence; only needed when invalid UTF-8 has to be replaced.
+    auto gather = [&](const uint32_t* ids, size_t n, std::string& raw) {
+        raw.clear();
+        for (size_t k = 0; k < n; ++k) {
+            if (!skipped(ids[k])) raw += vocab_.token(ids[k]);
+        }
+    };
+
+    out.offsets.assign(count + 1, 0);
+    parallelFor(count, options.numThreads, 64, [&](unsigned, size_t begin, size_t end) {
+        thread_local std::string raw;
+        for (size_t i = begin; i < end; ++i) {
+            auto [ids, n] = sequence(i);
+            size_t length = 0;
+            if (options.replaceInvalidUtf8) {
+                gather(ids, n, raw);
+                length = copyReplacingInvalidUtf8(raw, nullptr);
+            } else {
+                for (size_t k = 0; k < n; ++k) {
+                    if (!skipped(ids[k])) length += vocab_.token(ids[k]).size();
+                }
+            }
+            out.offsets[i + 1] = length;
+        }
+    });
+    for (size_t i = 0; i < count; ++i) {
+        out.offsets[i + 1] += out.offsets[i];
+    }
+
+    out.text.resize(out.offsets[count]);
+    parallelFor(count, options.numThreads, 64, [&](unsigned, size_t begin, size_t end) {
+        thread_local std::string raw;
+        for (size_t i = begin; i < end; ++i) {
+            auto [ids, n] = sequence(i);
+            char* dest = out.text.data() + out.offsets[i];
+            if (options.replaceInvalidUtf8) {
+                gather(ids, n, raw);
+                copyReplacingInvalidUtf8(raw, dest);
+                continue;
+            }
+            for (size_t k = 0; k < n; ++k) {
+                if (skipped(ids[k])) continue;
+                std::string_view piece = vocab_.token(ids[k]);
+                std::memcpy(dest, piece.data(), piece.size());
+                dest += piece.size();
+            }
+        }
+    });
+    return true;
+}
+
+size_t Tokenizer::vocabSize() const {
+    return vocab_.size();
+}
+
+uint32_t Tokenizer::idCount() const {
+    return vocab_.idCount();
+}
+
+uint64_t Tokenizer::fingerprint() const {
+    uint64_t hash = 1469598103934665603ull;
+    auto mixBytes = [&](std::string_view bytes) {
+        for (unsigned char c : bytes) {
+            hash = (hash ^ c) * 1099511628211ull;
         }
+    };
+    auto mix = [&](uint64_t value) {
+        mixBytes({reinterpret_cast<const char*>(&value), sizeof(value)});
+    };
+    vocab_.forEach([&](uint32_t id, std::string_view token) {
+        mix(id);
+        mix(token.size());
+        mixBytes(token);
+    });
+    mix(preTokenizer_->spec().size());
+    mixBytes(preTokenizer_->spec());
+    mix(specialTokensEnabled_);
+    for (uint32_t id = 0; id < specialIds_.size(); ++id) {
+        if (specialIds_[id]) mix(id);
+    }
+    const NormalizationOptions& normalization = normalizer_->options();
+    mix(static_cast<uint64_t>(normalization.form));
+    mix(normalization.lowercase);
+    mix(normalization.collapseWhitespace);
+    mix(static_cast<uint64_t>(encodeMode_));
+    if (encodeMode_ == EncodeMode::MinTokens) {
+        mixBytes({reinterpret_cast<const char*>(tokenCosts_.data()), tokenCosts_.size() * sizeof(float)});
     }
+    return hash;
+}
+
+std::optional<uint32_t> Tokenizer::tokenId(std::string_view token) const {
+    return vocab_.find(token);
+}
+
+bool Tokenizer::optimizeTrieLayout(const std::vector<std::string_view>& samples, TrieLayoutStats* stats) {
+    if (!loaded_) {
+        return false;
+    }
+
+    std::vector<uint32_t> counts(trie_->nodeCount(), 0);
+    ProfileSink sink{*trie_, counts};
+    for (std::string_view sample : samples) {
+        encodeText_(sample, sink);
+    }
+    trieProfile_ = std::move(counts);
+    buildTrie_();
 
-    return ss.str();
+    if (stats != nullptr) {
+        std::vector<uint32_t> hot(trieProfile_);
+        std::sort(hot.begin(), hot.end(), std::greater<>());
+        *stats = TrieLayoutStats{};
+        stats->nodes = trie_->nodeCount();
+        stats->bytes = trie_->memoryBytes();
+        for (uint32_t visits : hot) {
+            stats->visits += visits;
+        }
+        uint64_t covered = 0;
+        while (stats->hotNodes < hot.size() && covered * 10 < stats->visits * 9) {
+            covered += hot[stats->hotNodes++];
+        }
+        // Layout puts the hottest nodes first, so they span a proportional prefix.
+        stats->hotBytes = stats->nodes == 0 ? 0 : stats->bytes * stats->hotNodes / stats->nodes;
+    }
+    return true;
 }
 
 void Tokenizer::setNormalization(bool enabled) {
-    normalizationEnabled_ = enabled;
+    NormalizationOptions options;
+    options.form = enabled ? NormalizationForm::NFC : NormalizationForm::None;
+    setNormalization(options);
+}
+
+void Tokenizer::setNormalization(const NormalizationOptions& options) {
+    normalizer_ = std::make_unique<Normalizer>(options);
 }
 
 bool Tokenizer::isLoaded() const {
@@ -0,0 +1,95 @@
+#include "forkenizer/TokenizerHandle.hpp"
+#include "../util/Epoch.hpp"
+#include <algorithm>
+
+namespace forkenizer {
+
+TokenizerHandle::TokenizerHandle() = default;
+
+TokenizerHandle::~TokenizerHandle() {
+    delete current_.load(std::memory_order_acquire);
+    for (const Retired& retired : retired_) {
+        delete retired.snapshot;
+    }
+}
+
+bool TokenizerHandle::load(const std::string& modelDir) {
+    auto tokenizer = std::make_shared<Tokenizer>();
+    if (!tokenizer->load(modelDir)) {
+        return false;
+    }
+    publish(std::move(tokenizer));
+    return true;
+}
+
+std::future<bool> TokenizerHandle::loadAsync(const std::string& modelDir) {
+    return std::async(std::launch::async, [this, modelDir] { return load(modelDir); });
+}
+
+void TokenizerHandle::publish(std::shared_ptr<const Tokenizer> tokenizer) {
+    std::lock_guard<std::mutex> lock(publishMutex_);
+    auto* next = new Snapshot{std::move(tokenizer), nextVersion_++};
+    Snapshot* previous = current_.exchange(next, std::memory_order_seq_cst);
+    const uint64_t epoch = EpochDomain::advance();
+    if (previous != nullptr) {
+        retired_.push_back(Retired{previous, epoch});
+    }
+    reclaimLocked_();
+}
+
+size_t TokenizerHandle::reclaim() {
+    std::lock_guard<std::mutex> lock(publishMutex_);
+    reclaimLocked_();
+    return retired_.size();
+}
+
+void TokenizerHandle::reclaimLocked_() {
+    auto firstKept = std::stable_partition(retired_.begin(), retired_.end(), [](const Retired& retired) {
+        return EpochDomain::quiescent(retired.epoch);
+    });
+    for (auto it = retired_.begin(); it != firstKept; ++it) {
+        delete it->snapshot;
+    }
+    retired_.erase(retired_.begin(), firstKept);
+}
+
+std::shared_ptr<const Tokenizer> TokenizerHandle::snapshot() const {
+    EpochDomain::Guard guard;
+    const Snapshot* current = current_.load(std::memory_order_seq_cst);
+    return current != nullptr ? current->tokenizer : nullptr;
+}
+
+uint64_t TokenizerHandle::version() const {
+    EpochDomain::Guard guard;
+    const Snapshot* current = current_.load(std::memory_order_seq_cst);
+    return current != nullptr ? current->version : 0;
+}
+
+std::optional<std::vector<uint32_t>> TokenizerHandle::encode(std::string_view text) const {
+    EpochDomain::Guard guard;
+    const Snapshot* current = current_.load(std::memory_order_seq_cst);
+    if (current == nullptr) {
+        return std::nullopt;
+    }
+    return current->tokenizer->encode(text);
+}
+
+std::optional<Encoding> TokenizerHandle::encodeWithOffsets(std::string_view text) const {
+    EpochDomain::Guard guard;
+    const Snapshot* current = current_.load(std::memory_order_seq_cst);
+    if (current == nullptr) {
+        return std::nullopt;
+    }
+    return current->tokenizer->encodeWithOffsets(text);
+}
+
+std::optional<std::string> TokenizerHandle::decode(const std::vector<uint32_t>& tokens) const {
+    EpochDomain::Guard guard;
+    const Snapshot* current = current_.load(std::memory_order_seq_cst);
+    if (current == nullptr) {
+        return std::nullopt;
+    }
+    return current->tokenizer->decode(tokens);
+}
+
+}
@@ -0,0 +1,123 @@
+#include "Unicode.hpp"
+#include "UnicodeTables.hpp"
+#include <algorithm>
+
+namespace forkenizer::unicode {
+
+namespace {
+
+namespace tables = unicode_tables;
+
+constexpr uint32_t kMaxCodePoint = 0x10FFFF;
+constexpr uint32_t kBlockMask = (1u << tables::kBlockShift) - 1;
+
+constexpr uint32_t kHangulSBase = 0xAC00;
+constexpr uint32_t kHangulLBase = 0x1100;
+constexpr uint32_t kHangulVBase = 0x1161;
+constexpr uint32_t kHangulTBase = 0x11A7;
+constexpr uint32_t kHangulLCount = 19;
+constexpr uint32_t kHangulVCount = 21;
+constexpr uint32_t kHangulTCount = 28;
+constexpr uint32_t kHangulNCount = kHangulVCount * kHangulTCount;
+constexpr uint32_t kHangulSCount = kHangulLCount * kHangulNCount;
+
+template <typename Stage1, typename Stage2>
+auto lookup(const Stage1& stage1, const Stage2& stage2, uint32_t cp) {
+    const uint32_t block = stage1[cp >> tables::kBlockShift];
+    return stage2[(block << tables::kBlockShift) | (cp & kBlockMask)];
+}
+
+}
+
+static_assert(kNfcMaybe == tables::kFlagNfcMaybe && kNfkcMaybe == tables::kFlagNfkcMaybe &&
+              kCombinesBackward == tables::kFlagCombinesBackward && kHasLower == tables::kFlagHasLower);
+
+uint8_t flags(uint32_t cp) {
+    if (cp > kMaxCodePoint) {
+        return 0;
+    }
+    return lookup(tables::kFlagsStage1, tables::kFlagsStage2, cp);
+}
+
+CharClass charClass(uint32_t cp) {
+    if (cp > kMaxCodePoint) {
+        return CharClass::Other;
+    }
+    return static_cast<CharClass>(lookup(tables::kCharClassStage1, tables::kCharClassStage2, cp));
+}
+
+uint8_t combiningClass(uint32_t cp) {
+    if (cp > kMaxCodePoint) {
+        return 0;
+    }
+    return lookup(tables::kCombiningClassStage1, tables::kCombiningClassStage2, cp);
+}
+
+uint32_t toLower(uint32_t cp) {
+    if (!(flags(cp) & kHasLower)) {
+        return cp;
+    }
+    auto it = std::lower_bound(std::begin(tables::kLowercase), std::end(tables::kLowercase), cp,
+                               [](const tables::CaseMapping& m, uint32_t value) { return m.codePoint < value; });
+    if (it != std::end(tables::kLowercase) && it->codePoint == cp) {
+        return it->lower;
+    }
+    return cp;
+}
+
+void decompose(uint32_t cp, bool compat, std::u32string& out) {
+    if (cp >= kHangulSBase && cp < kHangulSBase + kHangulSCount) {
+        const uint32_t index = cp - kHangulSBase;
+        out += static_cast<char32_t>(kHangulLBase + index / kHangulNCount);
+        out += static_cast<char32_t>(kHangulVBase + (index % kHangulNCount) / kHangulTCount);
+        if (index % kHangulTCount != 0) {
+            out += static_cast<char32_t>(kHangulTBase + index % kHangulTCount);
+        }
+        return;
+    }
+
+    const uint16_t entryIndex = cp > kMaxCodePoint ? 0 :
+        lookup(tables::kDecompositionIndexStage1, tables::kDecompositionIndexStage2, cp);
+    if (entryIndex == 0) {
+        out += static_cast<char32_t>(cp);
+        return;
+    }
+    const tables::DecompositionEntry& entry = tables::kDecompositionEntries[entryIndex];
+    const uint32_t offset = compat ? entry.compatOffset : entry.canonicalOffset;
+    const uint32_t length = compat ? entry.compatLength : entry.canonicalLength;
+    if (length == 0) {
+        out += static_cast<char32_t>(cp);
+        return;
+    }
+    for (uint32_t k = 0; k < length; ++k) {
+        out += static_cast<char32_t>(tables::kDecompositionData[offset + k]);
+    }
+}
+
+uint32_t compose(uint32_t first, uint32_t second) {
+    if (first >= kHangulLBase && first < kHangulLBase + kHangulLCount &&
+        second >= kHangulVBase && second < kHangulVBase + kHangulVCount) {
+        return kHangulSBase + ((first - kHangulLBase) * kHangulVCount + (second - kHangulVBase)) * kHangulTCount;
+    }
+    if (first >= kHangulSBase && first < kHangulSBase + kHangulSCount && (first - kHangulSBase) % kHangulTCount == 0 &&
+        second > kHangulTBase && second < kHangulTBase + kHangulTCount) {
+        return first + (second - kHangulTBase);
+    }
+
+    if (first > kMaxCodePoint || second > kMaxCodePoint) {
+        return kInvalidCodePoint;
+    }
+    const uint64_t key = (static_cast<uint64_t>(first) << 21) | second;
+    auto it = std::lower_bound(std::begin(tables::kCompositions), std::end(tables::kCompositions), key,
+                               [](const tables::CompositionPair& p, uint64_t value) { return p.key < value; });
+    if (it != std::end(tables::kCompositions) && it->key == key) {
+        return it->composite;
+    }
+    return kInvalidCodePoint;
+}
+
+const char* version() {
+    return tables::kUnicodeVersion;
+}
+
+}
@@ -0,0 +1,181 @@
+#pragma once
+
+#include <string>
+#include <string_view>
+#include <cstdint>
+#include <cstddef>
+#include <cstring>
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+namespace forkenizer {
+
+constexpr uint32_t kInvalidCodePoint = 0xFFFFFFFFu;
+
+// Continuation count and allowed second-byte range for a UTF-8 lead byte; false when
+// the byte cannot start a multi-byte sequence.
+inline bool utf8Lead(unsigned char lead, size_t& needed, unsigned char& low, unsigned char& high) {
+    low = 0x80;
+    high = 0xBF;
+    if (lead >= 0xC2 && lead <= 0xDF) {
+        needed = 1;
+    } else if (lead >= 0xE0 && lead <= 0xEF) {
+        needed = 2;
+        if (lead == 0xE0) low = 0xA0;
+        if (lead == 0xED) high = 0x9F;
+    } else if (lead >= 0xF0 && lead <= 0xF4) {
+        needed = 3;
+        if (lead == 0xF0) low = 0x90;
+        if (lead == 0xF4) high = 0x8F;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+// Decodes the UTF-8 sequence starting at text[pos]. Malformed, overlong and surrogate
+// sequences decode to kInvalidCodePoint with length 1 so callers can pass the byte through.
+inline uint32_t decodeUtf8(std::string_view text, size_t pos, size_t& length) {
+    const auto byteAt = [&](size_t i) { return static_cast<unsigned char>(text[i]); };
+    const unsigned char lead = byteAt(pos);
+    length = 1;
+    if (lead < 0x80) {
+        return lead;
+    }
+
+    size_t needed;
+    unsigned char low;
+    unsigned char high;
+    if (!utf8Lead(lead, needed, low, high) || pos + needed >= text.size()) {
+        return kInvalidCodePoint;
+    }
+    uint32_t cp = lead & (0x3F >> needed);
+    for (size_t k = 1; k <= needed; ++k) {
+        unsigned char c = byteAt(pos + k);
+        if (c < (k == 1 ? low : 0x80) || c > (k == 1 ? high : 0xBF)) {
+            return kInvalidCodePoint;
+        }
+        cp = (cp << 6) | (c & 0x3F);
+    }
+    length = needed + 1;
+    return cp;
+}
+
+// Length of the maximal subpart of the ill-formed sequence at text[pos]: the lead byte
+// plus the continuation bytes that were still valid when it broke off. Replacing each
+// subpart with one U+FFFD is the Unicode recommended practice.
+inline size_t invalidUtf8Length(std::string_view text, size_t pos) {
+    size_t needed;
+    unsigned char low;
+    unsigned char high;
+    if (!utf8Lead(static_cast<unsigned char>(text[pos]), needed, low, high)) {
+        return 1;
+    }
+    size_t length = 1;
+    while (length <= needed && pos + length < text.size()) {
+        const unsigned char c = static_cast<unsigned char>(text[pos + length]);
+        if (c < (length == 1 ? low : 0x80) || c > (length == 1 ? high : 0xBF)) {
+            break;
+        }
+        ++length;
+    }
+    return length;
+}
+
+inline void appendUtf8(uint32_t cp, std::string& out) {
+    if (cp < 0x80) {
+        out += static_cast<char>(cp);
+    } else if (cp < 0x800) {
+        out += static_cast<char>(0xC0 | (cp >> 6));
+        out += static_cast<char>(0x80 | (cp & 0x3F));
+    } else if (cp < 0x10000) {
+        out += static_cast<char>(0xE0 | (cp >> 12));
+        out += static_cast<char>(0x80 | ((cp >> 6) & 0x3F));
+        out += static_cast<char>(0x80 | (cp & 0x3F));
+    } else {
+        out += static_cast<char>(0xF0 | (cp >> 18));
+        out += static_cast<char>(0x80 | ((cp >> 12) & 0x3F));
+        out += static_cast<char>(0x80 | ((cp >> 6) & 0x3F));
+        out += static_cast<char>(0x80 | (cp & 0x3F));
+    }
+}
+
+// Position of the first byte >= 0x80 at or after `from`, or text.size().
+inline size_t findNonAscii(std::string_view text, size_t from) {
+    const char* data = text.data();
+    const size_t size = text.size();
+    size_t i = from;
+#if defined(__SSE2__)
+    for (; i + 16 <= size; i += 16) {
+        __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + i));
+        int mask = _mm_movemask_epi8(chunk);
+        if (mask != 0) {
+            return i + static_cast<size_t>(__builtin_ctz(static_cast<unsigned>(mask)));
+        }
+    }
+#else
+    for (; i + 8 <= size; i += 8) {
+        uint64_t word;
+        std::memcpy(&word, data + i, 8);
+        if (word & 0x8080808080808080ULL) {
+            break;
+        }
+    }
+#endif
+    for (; i < size; ++i) {
+        if (static_cast<unsigned char>(data[i]) >= 0x80) {
+            return i;
+        }
+    }
+    return size;
+}
+
+// Copies text to out with each ill-formed subsequence replaced by U+FFFD and returns
+// the output length. A null out only measures.
+inline size_t copyReplacingInvalidUtf8(std::string_view text, char* out) {
+    static constexpr char kReplacement[] = "\xEF\xBF\xBD";
+    size_t written = 0;
+    size_t pos = 0;
+    while (pos < text.size()) {
+        const size_t next = findNonAscii(text, pos);
+        if (out) std::memcpy(out + written, text.data() + pos, next - pos);
+        written += next - pos;
+        pos = next;
+        if (pos == text.size()) break;
+        size_t length;
+        if (decodeUtf8(text, pos, length) != kInvalidCodePoint) {
+            if (out) std::memcpy(out + written, text.data() + pos, length);
+            written += length;
+        } else {
+            length = invalidUtf8Length(text, pos);
+            if (out) std::memcpy(out + written, kReplacement, 3);
+            written += 3;
+        }
+        pos += length;
+    }
+    return written;
+}
+
+namespace unicode {
+
+constexpr uint8_t kNfcMaybe = 1 << 0;
+constexpr uint8_t kNfkcMaybe = 1 << 1;
+constexpr uint8_t kCombinesBackward = 1 << 2;
+constexpr uint8_t kHasLower = 1 << 3;
+
+enum class CharClass : uint8_t { Other, Letter, Mark, Digit, Number, Space, Punct, Symbol };
+
+uint8_t flags(uint32_t cp);
+CharClass charClass(uint32_t cp);
+uint8_t combiningClass(uint32_t cp);
+uint32_t toLower(uint32_t cp);
+// Appends the full canonical (or compatibility) decomposition of cp, or cp itself.
+void decompose(uint32_t cp, bool compat, std::u32string& out);
+// Primary composite of a starter and a following code point, or kInvalidCodePoint.
+uint32_t compose(uint32_t first, uint32_t second);
+const char* version();
+
+}
+
+}
@@ -0,0 +1,137 @@
+#include "forkenizer/Vocab.hpp"
+#include <algorithm>
+
+namespace forkenizer {
+
+Vocab::Vocab(const Vocab& other)
+    : arena_(other.arena_), spans_(other.spans_), perfect_(other.perfect_), sealed_(other.sealed_) {
+    index_.reserve(other.index_.size());
+    for (const auto& [key, id] : other.index_) {
+        index_.emplace(std::string_view(arena_.data() + (key.data() - other.arena_.data()), key.size()), id);
+    }
+}
+
+Vocab& Vocab::operator=(const Vocab& other) {
+    if (this != &other) {
+        Vocab copy(other);
+        *this = std::move(copy);
+    }
+    return *this;
+}
+
+void Vocab::reserve(size_t tokenCount, size_t byteCount) {
+    spans_.edit([&](std::vector<Span>& spans) { spans.reserve(tokenCount); });
+    index_.reserve(tokenCount);
+    if (byteCount > arena_.capacity()) {
+        growArena_(byteCount);
+    }
+}
+
+void Vocab::growArena_(size_t needed) {
+    std::vector<std::pair<Span, uint32_t>> entries;
+    entries.reserve(index_.size());
+    for (const auto& [key, id] : index_) {
+        entries.push_back({Span{static_cast<uint32_t>(key.data() - arena_.data()),
+                                static_cast<uint32_t>(key.size())}, id});
+    }
+
+    arena_.edit([&](std::vector<char>& arena) { arena.reserve(std::max(needed, arena.capacity() * 2)); });
+
+    index_.clear();
+    for (const auto& [span, id] : entries) {
+        index_.emplace(view_(span), id);
+    }
+}
+
+void Vocab::set(std::string_view token, uint32_t id) {
+    if (sealed_) {
+        unseal_();
+    }
+
+    auto it = index_.find(token);
+    Span span;
+    if (it != index_.end()) {
+        span = Span{static_cast<uint32_t>(it->first.data() - arena_.data()), static_cast<uint32_t>(token.size())};
+        it->second = id;
+    } else {
+        if (arena_.size() + token.size() > arena_.capacity()) {
+            growArena_(arena_.size() + token.size());
+        }
+        span = Span{static_cast<uint32_t>(arena_.size()), static_cast<uint32_t>(token.size())};
+        arena_.edit([&](std::vector<char>& arena) { arena.insert(arena.end(), token.begin(), token.end()); });
+        index_.emplace(view_(span), id);
+    }
+
+    spans_.edit([&](std::vector<Span>& spans) {
+        if (id >= spans.size()) {
+            spans.resize(static_cast<size_t>(id) + 1);
+        }
+        spans[id] = span;
+    });
+}
+
+void Vocab::clear() {
+    arena_ = Table<char>();
+    spans_ = Table<Span>();
+    index_.clear();
+    perfect_.clear();
+    sealed_ = false;
+}
+
+bool Vocab::seal() {
+    if (sealed_) {
+        return true;
+    }
+
+    std::vector<std::string_view> keys;
+    std::vector<uint32_t> values;
+    keys.reserve(index_.size());
+    values.reserve(index_.size());
+    for (const auto& [key, id] : index_) {
+        keys.push_back(key);
+        values.push_back(id);
+    }
+    if (!perfect_.build(keys, values)) {
+        return false;
+    }
+
+    decltype(index_)().swap(index_);
+    sealed_ = true;
+    return true;
+}
+
+void Vocab::bind(std::string_view arena, const Span* spans, uint32_t idCount, PerfectHash perfect) {
+    clear();
+    arena_ = Table<char>::borrow(arena.data(), arena.size());
+    spans_ = Table<Span>::borrow(spans, idCount);
+    perfect_ = std::move(perfect);
+    sealed_ = true;
+}
+
+void Vocab::unseal_() {
+    // The index points into the arena, which must be owned before it can grow.
+    arena_.edit([](std::vector<char>&) {});
+    spans_.edit([](std::vector<Span>&) {});
+    index_.reserve(perfect_.size());
+    perfect_.forEachValue([&](uint32_t id) {
+        index_.emplace(view_(spans_[id]), id);
+    });
+    perfect_.clear();
+    sealed_ = false;
+}
+
+size_t Vocab::memoryBytes() const {
+    // Node-based map cost: next pointer, key, value and cached hash per node plus a bucket pointer.
+    const size_t indexBytes = index_.size() * (sizeof(void*) * 2 + sizeof(std::string_view) + sizeof(uint64_t)) +
+                              index_.bucket_count() * sizeof(void*);
+    return arena_.capacityBytes() + spans_.capacityBytes() + indexBytes + perfect_.memoryBytes();
+}
+
+std::string_view Vocab::token(uint32_t id) const {
+    if (!hasId(id)) {
+        return {};
+    }
+    return view_(spans_[id]);
+}
+
+}
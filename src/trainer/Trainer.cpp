@@ -1,35 +1,356 @@
 #include "Trainer.hpp"
 #include "forkenizer/PreTokenizer.hpp"
 #include "forkenizer/ModelIO.hpp"
+#include "../util/Parallel.hpp"
 #include <fstream>
 #include <sstream>
 #include <algorithm>
 #include <map>
+#include <unordered_map>
+#include <unordered_set>
+#include <tuple>
 
 namespace forkenizer {
 
 static void initializeByteVocab(ModelData& data) {
-    data.tokenToId["<pad>"] = 0;
-    data.tokenToId["<unk>"] = 1;
-    data.tokenToId["<bos>"] = 2;
-    data.tokenToId["<eos>"] = 3;
+    data.vocab.set("<pad>", 0);
+    data.vocab.set("<unk>", 1);
+    data.vocab.set("<bos>", 2);
+    data.vocab.set("<eos>", 3);
 
     uint32_t nextId = 4;
     for (int i = 0; i < 256; ++i) {
         std::string byteToken(1, static_cast<char>(i));
-        if (data.tokenToId.find(byteToken) == data.tokenToId.end()) {
-            data.tokenToId[byteToken] = nextId++;
+        if (!data.vocab.contains(byteToken)) {
+            data.vocab.set(byteToken, nextId++);
         }
     }
 }
 
-static std::vector<std::string> tokenizeToBytes(const std::string& text) {
-    std::vector<std::string> tokens;
-    tokens.reserve(text.length());
-    for (unsigned char byte : text) {
-        tokens.emplace_back(1, static_cast<char>(byte));
+namespace {
+
+constexpr uint32_t kNone = UINT32_MAX;
+
+uint64_t pairKey(uint32_t left, uint32_t right) {
+    return (static_cast<uint64_t>(left) << 32) | right;
+}
+
+// Byte-pair merge state over the distinct pretokens ("words") of a corpus. The
+// symbols of all words sit in flat arrays linked per word, so merging a pair rewrites
+// two slots in place. Each pair records the positions where it was formed, so a merge
+// visits only those; positions that later merges invalidated are skipped when checked.
+class MergeState {
+public:
+    explicit MergeState(const std::map<std::string, uint64_t>& words) {
+        for (int byte = 0; byte < 256; ++byte) {
+            intern(std::string(1, static_cast<char>(byte)));
+        }
+        for (const auto& [word, count] : words) {
+            const uint32_t wordIndex = static_cast<uint32_t>(wordCounts_.size());
+            wordCounts_.push_back(count);
+            const uint32_t first = static_cast<uint32_t>(symbols_.size());
+            for (size_t i = 0; i < word.size(); ++i) {
+                const uint32_t pos = first + static_cast<uint32_t>(i);
+                symbols_.push_back(static_cast<unsigned char>(word[i]));
+                prev_.push_back(i == 0 ? kNone : pos - 1);
+                next_.push_back(i + 1 == word.size() ? kNone : pos + 1);
+                wordOf_.push_back(wordIndex);
+            }
+        }
+        for (uint32_t pos = 0; pos < symbols_.size(); ++pos) {
+            if (next_[pos] != kNone) {
+                addPair(pos, static_cast<int64_t>(wordCounts_[wordOf_[pos]]));
+            }
+        }
+        pushRaised();
+    }
+
+    uint32_t intern(const std::string& text) {
+        auto [it, inserted] = symbolIds_.emplace(text, static_cast<uint32_t>(texts_.size()));
+        if (inserted) {
+            texts_.push_back(text);
+        }
+        return it->second;
+    }
+
+    const std::string& text(uint32_t symbol) const { return texts_[symbol]; }
+
+    // Most frequent pair, ties going to the lexicographically smallest (left, right).
+    bool bestPair(uint32_t& left, uint32_t& right, uint64_t& count) {
+        while (!heap_.empty()) {
+            std::pop_heap(heap_.begin(), heap_.end(), heapLess());
+            const HeapEntry entry = heap_.back();
+            heap_.pop_back();
+            auto it = pairs_.find(entry.key);
+            if (it == pairs_.end() || it->second.count == 0) {
+                continue;
+            }
+            // Increments push a fresh entry; an entry left behind by a decrement is
+            // requeued with the current count.
+            if (it->second.count != entry.count) {
+                pushHeap(entry.key, it->second.count);
+                continue;
+            }
+            left = static_cast<uint32_t>(entry.key >> 32);
+            right = static_cast<uint32_t>(entry.key);
+            count = entry.count;
+            return true;
+        }
+        return false;
+    }
+
+    // Applies left + right -> merged at every occurrence, left to right within each
+    // word, so overlapping runs like "aaa" merge as (aa)a.
+    void merge(uint32_t left, uint32_t right, uint32_t merged) {
+        const uint64_t key = pairKey(left, right);
+        auto it = pairs_.find(key);
+        if (it == pairs_.end()) {
+            return;
+        }
+        std::vector<uint32_t> positions = std::move(it->second.positions);
+        std::sort(positions.begin(), positions.end());
+        positions.erase(std::unique(positions.begin(), positions.end()), positions.end());
+
+        for (uint32_t pos : positions) {
+            const uint32_t second = next_[pos];
+            if (symbols_[pos] != left || second == kNone || symbols_[second] != right) {
+                continue;
+            }
+            const int64_t weight = static_cast<int64_t>(wordCounts_[wordOf_[pos]]);
+            const uint32_t before = prev_[pos];
+            const uint32_t after = next_[second];
+
+            if (before != kNone) addPair(before, -weight);
+            addPair(pos, -weight);
+            if (after != kNone) addPair(second, -weight);
+
+            symbols_[pos] = merged;
+            symbols_[second] = kNone;
+            next_[pos] = after;
+            if (after != kNone) prev_[after] = pos;
+
+            if (before != kNone) addPair(before, weight);
+            if (after != kNone) addPair(pos, weight);
+        }
+        pairs_.erase(key);
+        pushRaised();
+    }
+
+    struct BatchMerge {
+        uint32_t left;
+        uint32_t right;
+        uint32_t merged;
+    };
+
+    // Pops up to `limit` of the best pairs (count >= 2) such that no two share a
+    // symbol; pairs passed over for a conflict go back on the heap. A merge whose
+    // result is already a symbol counts as using it too, since applying it creates new
+    // occurrences of every pair that symbol is part of.
+    std::vector<BatchMerge> selectBatch(size_t limit) {
+        std::vector<BatchMerge> batch;
+        std::vector<HeapEntry> deferred;
+        std::unordered_set<uint32_t> used;
+        uint32_t left, right;
+        uint64_t count;
+        while (batch.size() < limit && deferred.size() < limit && bestPair(left, right, count)) {
+            if (count < 2) break;
+            auto existing = symbolIds_.find(texts_[left] + texts_[right]);
+            if (used.count(left) || used.count(right) ||
+                (existing != symbolIds_.end() && used.count(existing->second))) {
+                deferred.push_back(HeapEntry{count, pairKey(left, right)});
+                continue;
+            }
+            used.insert(left);
+            used.insert(right);
+            if (existing != symbolIds_.end()) used.insert(existing->second);
+            batch.push_back(BatchMerge{left, right, kNone});
+        }
+        for (const auto& entry : deferred) {
+            pushHeap(entry.key, entry.count);
+        }
+        return batch;
     }
-    return tokens;
+
+    // Applies a batch from selectBatch in one parallel pass over the affected words.
+    // Batch pairs share no symbol, so within a word they can be applied one after the
+    // other exactly as merge() would; each word belongs to one worker and the count
+    // changes are folded in afterwards.
+    void mergeBatch(const std::vector<BatchMerge>& batch, unsigned threads) {
+        struct Site {
+            uint32_t word;
+            uint32_t rank;
+            uint32_t pos;
+            bool operator<(const Site& other) const {
+                return std::tie(word, rank, pos) < std::tie(other.word, other.rank, other.pos);
+            }
+            bool operator==(const Site& other) const { return pos == other.pos && rank == other.rank; }
+        };
+        std::vector<Site> sites;
+        for (uint32_t rank = 0; rank < batch.size(); ++rank) {
+            auto it = pairs_.find(pairKey(batch[rank].left, batch[rank].right));
+            if (it == pairs_.end()) continue;
+            for (uint32_t pos : it->second.positions) {
+                sites.push_back(Site{wordOf_[pos], rank, pos});
+            }
+            it->second.positions.clear();
+        }
+        std::sort(sites.begin(), sites.end());
+        sites.erase(std::unique(sites.begin(), sites.end()), sites.end());
+        std::vector<size_t> groups;
+        for (size_t i = 0; i < sites.size(); ++i) {
+            if (i == 0 || sites[i].word != sites[i - 1].word) groups.push_back(i);
+        }
+        groups.push_back(sites.size());
+
+        struct Local {
+            std::unordered_map<uint64_t, int64_t> delta;
+            std::vector<std::pair<uint64_t, uint32_t>> formed;
+        };
+        std::vector<Local> locals(resolveThreadCount(threads));
+        parallelFor(groups.size() - 1, threads, 64, [&](unsigned worker, size_t begin, size_t end) {
+            Local& local = locals[worker];
+            auto add = [&](uint32_t pos, int64_t delta) {
+                const uint64_t key = pairKey(symbols_[pos], symbols_[next_[pos]]);
+                local.delta[key] += delta;
+                if (delta > 0) local.formed.emplace_back(key, pos);
+            };
+            for (size_t i = groups[begin]; i < groups[end]; ++i) {
+                const BatchMerge& merge = batch[sites[i].rank];
+                const uint32_t pos = sites[i].pos;
+                const uint32_t second = next_[pos];
+                if (symbols_[pos] != merge.left || second == kNone || symbols_[second] != merge.right) {
+                    continue;
+                }
+                const int64_t weight = static_cast<int64_t>(wordCounts_[sites[i].word]);
+                const uint32_t before = prev_[pos];
+                const uint32_t after = next_[second];
+
+                if (before != kNone) add(before, -weight);
+                add(pos, -weight);
+                if (after != kNone) add(second, -weight);
+
+                symbols_[pos] = merge.merged;
+                symbols_[second] = kNone;
+                next_[pos] = after;
+                if (after != kNone) prev_[after] = pos;
+
+                if (before != kNone) add(before, weight);
+                if (after != kNone) add(pos, weight);
+            }
+        });
+
+        for (auto& local : locals) {
+            for (const auto& [key, delta] : local.delta) {
+                if (delta == 0) continue;
+                PairInfo& info = pairs_[key];
+                info.count = static_cast<uint64_t>(static_cast<int64_t>(info.count) + delta);
+                if (delta > 0) raised_.push_back(key);
+            }
+            for (const auto& [key, pos] : local.formed) {
+                pairs_[key].positions.push_back(pos);
+            }
+        }
+        for (const auto& merge : batch) {
+            pairs_.erase(pairKey(merge.left, merge.right));
+        }
+        pushRaised();
+    }
+
+private:
+    struct PairInfo {
+        uint64_t count = 0;
+        std::vector<uint32_t> positions;
+    };
+
+    struct HeapEntry {
+        uint64_t count;
+        uint64_t key;
+    };
+
+    struct HeapLess {
+        const std::vector<std::string>& texts;
+        bool operator()(const HeapEntry& a, const HeapEntry& b) const {
+            if (a.count != b.count) return a.count < b.count;
+            const std::string& aLeft = texts[static_cast<uint32_t>(a.key >> 32)];
+            const std::string& bLeft = texts[static_cast<uint32_t>(b.key >> 32)];
+            if (aLeft != bLeft) return aLeft > bLeft;
+            return texts[static_cast<uint32_t>(a.key)] > texts[static_cast<uint32_t>(b.key)];
+        }
+    };
+
+    HeapLess heapLess() const { return HeapLess{texts_}; }
+
+    void pushHeap(uint64_t key, uint64_t count) {
+        heap_.push_back(HeapEntry{count, key});
+        std::push_heap(heap_.begin(), heap_.end(), heapLess());
+    }
+
+    // Adjusts the count of the pair starting at pos; increments also record pos.
+    void addPair(uint32_t pos, int64_t delta) {
+        const uint64_t key = pairKey(symbols_[pos], symbols_[next_[pos]]);
+        PairInfo& info = pairs_[key];
+        info.count = static_cast<uint64_t>(static_cast<int64_t>(info.count) + delta);
+        if (delta > 0) {
+            info.positions.push_back(pos);
+            raised_.push_back(key);
+        }
+    }
+
+    // Queues one entry per pair whose count went up, rather than one per increment;
+    // a frequent pair can gain thousands of occurrences in a single merge.
+    void pushRaised() {
+        std::sort(raised_.begin(), raised_.end());
+        raised_.erase(std::unique(raised_.begin(), raised_.end()), raised_.end());
+        for (uint64_t key : raised_) {
+            auto it = pairs_.find(key);
+            if (it != pairs_.end() && it->second.count > 0) {
+                pushHeap(key, it->second.count);
+            }
+        }
+        raised_.clear();
+    }
+
+    std::vector<std::string> texts_;
+    std::unordered_map<std::string, uint32_t> symbolIds_;
+    std::vector<uint64_t> wordCounts_;
+    std::vector<uint32_t> symbols_;
+    std::vector<uint32_t> prev_;
+    std::vector<uint32_t> next_;
+    std::vector<uint32_t> wordOf_;
+    std::unordered_map<uint64_t, PairInfo> pairs_;
+    std::vector<HeapEntry> heap_;
+    std::vector<uint64_t> raised_;
+};
+
+}
+
+MergeDivergence compareMerges(const std::vector<std::pair<std::string, std::string>>& exact,
+                              const std::vector<std::pair<std::string, std::string>>& approximate) {
+    MergeDivergence divergence;
+    divergence.exactMerges = exact.size();
+    divergence.approximateMerges = approximate.size();
+    while (divergence.commonPrefix < std::min(exact.size(), approximate.size()) &&
+           exact[divergence.commonPrefix] == approximate[divergence.commonPrefix]) {
+        divergence.commonPrefix++;
+    }
+
+    // Compared by the token each merge produces, since one token can come from
+    // different splits.
+    std::unordered_map<std::string, size_t> exactRank;
+    for (size_t i = 0; i < exact.size(); ++i) {
+        exactRank.emplace(exact[i].first + exact[i].second, i);
+    }
+    std::unordered_set<std::string> seen;
+    double shift = 0;
+    for (size_t i = 0; i < approximate.size(); ++i) {
+        const std::string token = approximate[i].first + approximate[i].second;
+        auto it = exactRank.find(token);
+        if (it == exactRank.end() || !seen.insert(token).second) continue;
+        divergence.sharedTokens++;
+        shift += it->second > i ? static_cast<double>(it->second - i) : static_cast<double>(i - it->second);
+    }
+    divergence.meanRankShift = divergence.sharedTokens == 0 ? 0.0 : shift / divergence.sharedTokens;
+    return divergence;
 }
 
 bool Trainer::train(const std::vector<std::string>& corpusFiles, const std::string& outputDir,
@@ -37,8 +358,10 @@ bool Trainer::train(const std::vector<std::string>& corpusFiles, const std::stri
     ModelData data;
     initializeByteVocab(data);
 
-    PreTokenizer preTokenizer;
-    std::vector<std::vector<std::string>> allTokens;
+    data.preTokenizerRules = preTokenizer_.spec();
+    // Merges never cross pretoken boundaries (encode matches within one pretoken), so
+    // each distinct pretoken is counted once and weighted by its frequency.
+    std::map<std::string, uint64_t> words;
 
     for (const auto& corpusFile : corpusFiles) {
         std::ifstream file(corpusFile);
@@ -46,76 +369,59 @@ bool Trainer::train(const std::vector<std::string>& corpusFiles, const std::stri
 
         std::string line;
         while (std::getline(file, line)) {
-            std::vector<std::string> preTokens = preTokenizer.preTokenize(line);
-            std::vector<std::string> byteTokens;
-            for (const auto& preToken : preTokens) {
-                std::vector<std::string> bytes = tokenizeToBytes(preToken);
-                byteTokens.insert(byteTokens.end(), bytes.begin(), bytes.end());
-            }
-            if (!byteTokens.empty()) {
-                allTokens.push_back(byteTokens);
+            for (const auto& preToken : preTokenizer_.preTokenize(line)) {
+                if (!preToken.empty()) {
+                    ++words[preToken];
+                }
             }
         }
         file.close();
     }
 
-    if (allTokens.empty()) {
+    if (words.empty()) {
         return false;
     }
 
-    std::map<std::pair<std::string, std::string>, uint64_t> pairCounts;
-    for (const auto& tokens : allTokens) {
-        for (size_t i = 0; i + 1 < tokens.size(); ++i) {
-            pairCounts[{tokens[i], tokens[i + 1]}]++;
-        }
-    }
-
-    uint32_t currentVocabSize = static_cast<uint32_t>(data.tokenToId.size());
+    MergeState state(words);
+    uint32_t currentVocabSize = static_cast<uint32_t>(data.vocab.size());
     uint32_t mergesPerformed = 0;
+    stats_ = TrainingStats{};
 
-    while (currentVocabSize < vocabSize && mergesPerformed < numMerges && !pairCounts.empty()) {
-        auto bestPair = std::max_element(pairCounts.begin(), pairCounts.end(),
-            [](const auto& a, const auto& b) { return a.second < b.second; });
-
-        if (bestPair == pairCounts.end() || bestPair->second < 2) break;
-
-        std::string merged = bestPair->first.first + bestPair->first.second;
-        data.tokenToId[merged] = currentVocabSize++;
-        data.merges.emplace_back(bestPair->first.first, bestPair->first.second);
-
-        for (auto& tokens : allTokens) {
-            for (size_t i = 0; i + 1 < tokens.size(); ++i) {
-                if (tokens[i] == bestPair->first.first && tokens[i + 1] == bestPair->first.second) {
-                    tokens[i] = merged;
-                    tokens.erase(tokens.begin() + i + 1);
-                    if (i > 0) {
-                        pairCounts[{tokens[i - 1], tokens[i]}]++;
-                    }
-                    if (i + 1 < tokens.size()) {
-                        pairCounts[{tokens[i], tokens[i + 1]}]++;
-                    }
-                    break;
-                }
-            }
+    auto record = [&](uint32_t left, uint32_t right) {
+        const std::string merged = state.text(left) + state.text(right);
+        if (!data.vocab.contains(merged)) {
+            data.vocab.set(merged, currentVocabSize++);
         }
-
-        pairCounts.erase(bestPair);
+        data.merges.emplace_back(state.text(left), state.text(right));
         mergesPerformed++;
-    }
+        return state.intern(merged);
+    };
 
-    uint32_t maxId = 0;
-    for (const auto& pair : data.tokenToId) {
-        if (pair.second > maxId) maxId = pair.second;
-    }
-    data.idToToken.resize(maxId + 1);
-    for (const auto& pair : data.tokenToId) {
-        if (pair.second < data.idToToken.size()) {
-            data.idToToken[pair.second] = pair.first;
+    if (mergeBatch_ <= 1) {
+        uint32_t left, right;
+        uint64_t count;
+        while (currentVocabSize < vocabSize && mergesPerformed < numMerges && state.bestPair(left, right, count)) {
+            if (count < 2) break;
+            state.merge(left, right, record(left, right));
+            stats_.rounds++;
+        }
+    } else {
+
+        while (currentVocabSize < vocabSize && mergesPerformed < numMerges) {
+            const size_t limit = std::min<size_t>({mergeBatch_, numMerges - mergesPerformed,
+                                                   vocabSize - currentVocabSize});
+            auto batch = state.selectBatch(limit);
+            if (batch.empty()) break;
+            for (auto& merge : batch) {
+                merge.merged = record(merge.left, merge.right);
+            }
+            state.mergeBatch(batch, numThreads_);
+            stats_.rounds++;
         }
     }
+    stats_.merges = mergesPerformed;
 
     return saveModel(outputDir, data);
 }
 
 }
-
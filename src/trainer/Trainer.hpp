@@ -1,5 +1,6 @@
 #pragma once
 
+#include "forkenizer/PreTokenizer.hpp"
 #include <string>
 #include <vector>
 #include <unordered_map>
@@ -9,10 +10,40 @@ namespace forkenizer {
 
 struct ModelData;
 
+struct TrainingStats {
+    uint32_t merges = 0;
+    uint32_t rounds = 0;
+};
+
+// How far an approximate merge list strays from an exact one.
+struct MergeDivergence {
+    size_t exactMerges = 0;
+    size_t approximateMerges = 0;
+    size_t commonPrefix = 0;   // leading merges identical in both
+    size_t sharedTokens = 0;   // merged tokens both lists produce
+    double meanRankShift = 0;  // mean |rank difference| over the shared tokens
+};
+
+MergeDivergence compareMerges(const std::vector<std::pair<std::string, std::string>>& exact,
+                              const std::vector<std::pair<std::string, std::string>>& approximate);
+
 class Trainer {
 public:
     bool train(const std::vector<std::string>& corpusFiles, const std::string& outputDir,
                uint32_t vocabSize, uint32_t numMerges);
+    void setPreTokenizer(const PreTokenizer& preTokenizer) { preTokenizer_ = preTokenizer; }
+    // Above 1, each round takes up to this many of the best pairs that share no symbol
+    // and applies them together, split across threads. Later pairs in a round are chosen
+    // on counts the earlier ones would have changed, so the result is approximate.
+    void setMergeBatch(uint32_t pairsPerRound) { mergeBatch_ = pairsPerRound; }
+    void setNumThreads(unsigned threads) { numThreads_ = threads; }
+    const TrainingStats& stats() const { return stats_; }
+
+private:
+    PreTokenizer preTokenizer_;
+    uint32_t mergeBatch_ = 1;
+    unsigned numThreads_ = 0;
+    TrainingStats stats_;
 };
 
 }
@@ -0,0 +1,115 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+namespace forkenizer {
+
+namespace epoch_detail {
+
+constexpr size_t kSlotsPerBlock = 64;
+
+struct alignas(64) ReaderSlot {
+    std::atomic<uint64_t> epoch{0};
+    std::atomic<bool> owned{false};
+};
+
+// Slots live in a list of blocks that only grows, so claiming one never waits and a
+// slot pointer stays valid for the life of the process.
+struct SlotBlock {
+    ReaderSlot slots[kSlotsPerBlock];
+    std::atomic<SlotBlock*> next{nullptr};
+};
+
+inline std::atomic<uint64_t> globalEpoch{1};
+inline SlotBlock firstSlotBlock;
+
+// A thread claims a slot on its first read and gives it back when it exits. With
+// every slot taken, it appends a new block and takes that block's first slot.
+struct SlotOwner {
+    ReaderSlot* slot = nullptr;
+    unsigned depth = 0;
+
+    SlotOwner() {
+        for (SlotBlock* block = &firstSlotBlock;;) {
+            for (ReaderSlot& candidate : block->slots) {
+                bool expected = false;
+                if (!candidate.owned.load(std::memory_order_relaxed) &&
+                    candidate.owned.compare_exchange_strong(expected, true, std::memory_order_acquire)) {
+                    slot = &candidate;
+                    return;
+                }
+            }
+            SlotBlock* next = block->next.load(std::memory_order_acquire);
+            if (next == nullptr) {
+                auto* grown = new SlotBlock;
+                grown->slots[0].owned.store(true, std::memory_order_relaxed);
+                if (block->next.compare_exchange_strong(next, grown, std::memory_order_seq_cst)) {
+                    slot = &grown->slots[0];
+                    return;
+                }
+                delete grown;
+            }
+            block = next;
+        }
+    }
+    ~SlotOwner() {
+        slot->epoch.store(0, std::memory_order_release);
+        slot->owned.store(false, std::memory_order_release);
+    }
+};
+
+inline SlotOwner& threadSlotOwner() {
+    thread_local SlotOwner owner;
+    return owner;
+}
+
+}
+
+// Process-wide epoch-based reclamation. Readers announce the global epoch in a
+// per-thread slot for the duration of a read; a writer that unlinks an object retires
+// it at the current epoch and frees it once no slot holds an epoch at or below that.
+// Readers only do plain atomic stores and loads; nothing on the read side waits.
+class EpochDomain {
+public:
+    // Returns the epoch the caller's retired objects belong to and opens a new one.
+    static uint64_t advance() { return epoch_detail::globalEpoch.fetch_add(1, std::memory_order_seq_cst); }
+
+    // True when no reader that might still see objects retired at retireEpoch is active.
+    static bool quiescent(uint64_t retireEpoch) {
+        for (const epoch_detail::SlotBlock* block = &epoch_detail::firstSlotBlock; block != nullptr;
+             block = block->next.load(std::memory_order_seq_cst)) {
+            for (const auto& slot : block->slots) {
+                const uint64_t announced = slot.epoch.load(std::memory_order_seq_cst);
+                if (announced != 0 && announced <= retireEpoch) {
+                    return false;
+                }
+            }
+        }
+        return true;
+    }
+
+    // Pins the current epoch for the calling thread. Guards nest.
+    class Guard {
+    public:
+        Guard() : owner_(epoch_detail::threadSlotOwner()) {
+            if (owner_.depth++ == 0) {
+                owner_.slot->epoch.store(epoch_detail::globalEpoch.load(std::memory_order_seq_cst),
+                                         std::memory_order_seq_cst);
+            }
+        }
+        ~Guard() {
+            if (--owner_.depth == 0) {
+                owner_.slot->epoch.store(0, std::memory_order_release);
+            }
+        }
+        Guard(const Guard&) = delete;
+        Guard& operator=(const Guard&) = delete;
+
+    private:
+        epoch_detail::SlotOwner& owner_;
+    };
+};
+
+}
@@ -0,0 +1,57 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <thread>
+#include <vector>
+
+namespace forkenizer {
+
+inline unsigned resolveThreadCount(unsigned requested) {
+    if (requested != 0) {
+        return requested;
+    }
+    unsigned hardware = std::thread::hardware_concurrency();
+    return hardware == 0 ? 1 : hardware;
+}
+
+// Runs fn(worker, begin, end) over [0, count) in chunks pulled from a shared counter,
+// so uneven items (short and long documents) still balance across workers.
+template <typename F>
+void parallelFor(size_t count, unsigned requestedThreads, size_t chunkSize, F&& fn) {
+    if (count == 0) {
+        return;
+    }
+    chunkSize = std::max<size_t>(chunkSize, 1);
+    const size_t chunks = (count + chunkSize - 1) / chunkSize;
+    const unsigned threads = static_cast<unsigned>(std::min<size_t>(resolveThreadCount(requestedThreads), chunks));
+
+    std::atomic<size_t> next{0};
+    auto worker = [&](unsigned workerIndex) {
+        while (true) {
+            size_t begin = next.fetch_add(chunkSize, std::memory_order_relaxed);
+            if (begin >= count) {
+                break;
+            }
+            fn(workerIndex, begin, std::min(begin + chunkSize, count));
+        }
+    };
+
+    if (threads <= 1) {
+        worker(0);
+        return;
+    }
+
+    std::vector<std::thread> pool;
+    pool.reserve(threads - 1);
+    for (unsigned t = 1; t < threads; ++t) {
+        pool.emplace_back(worker, t);
+    }
+    worker(0);
+    for (auto& thread : pool) {
+        thread.join();
+    }
+}
+
+}
@@ -0,0 +1,70 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace forkenizer {
+
+// Bounded single-producer single-consumer ring. tryPush/tryPop never block; push/pop
+// spin briefly and then yield, which matters when workers outnumber cores.
+template <typename T>
+class SpscQueue {
+public:
+    explicit SpscQueue(size_t capacity) {
+        size_t size = 2;
+        while (size < capacity) size <<= 1;
+        slots_.resize(size);
+        mask_ = size - 1;
+    }
+
+    bool tryPush(T& value) {
+        const size_t tail = tail_.load(std::memory_order_relaxed);
+        if (tail - head_.load(std::memory_order_acquire) > mask_) {
+            return false;
+        }
+        slots_[tail & mask_] = std::move(value);
+        tail_.store(tail + 1, std::memory_order_release);
+        return true;
+    }
+
+    bool tryPop(T& value) {
+        const size_t head = head_.load(std::memory_order_relaxed);
+        if (head == tail_.load(std::memory_order_acquire)) {
+            return false;
+        }
+        value = std::move(slots_[head & mask_]);
+        head_.store(head + 1, std::memory_order_release);
+        return true;
+    }
+
+    void push(T value) {
+        for (unsigned spins = 0; !tryPush(value); ++spins) {
+            backoff_(spins);
+        }
+    }
+
+    T pop() {
+        T value;
+        for (unsigned spins = 0; !tryPop(value); ++spins) {
+            backoff_(spins);
+        }
+        return value;
+    }
+
+private:
+    std::vector<T> slots_;
+    size_t mask_ = 0;
+    alignas(64) std::atomic<size_t> head_{0};
+    alignas(64) std::atomic<size_t> tail_{0};
+
+    static void backoff_(unsigned spins) {
+        if (spins >= 64) {
+            std::this_thread::yield();
+        }
+    }
+};
+
+}
@@ -6,10 +6,14 @@
 
 // Minimal test framework placeholder - replace with actual Catch2
 #include <cassert>
+#include <cstdlib>
 #include <iostream>
 #include <string>
 
-#define TEST_CASE(name, tags) static void test_##name(); namespace { struct test_##name##_reg { test_##name##_reg() { test_##name(); } } test_##name##_instance; } static void test_##name()
+#define CATCH_INTERNAL_CAT2(a, b) a##b
+#define CATCH_INTERNAL_CAT(a, b) CATCH_INTERNAL_CAT2(a, b)
+#define CATCH_INTERNAL_TEST_CASE(fn, reg) static void fn(); namespace { struct reg { reg() { fn(); } } CATCH_INTERNAL_CAT(reg, _instance); } static void fn()
+#define TEST_CASE(name, tags) CATCH_INTERNAL_TEST_CASE(CATCH_INTERNAL_CAT(test_case_, __LINE__), CATCH_INTERNAL_CAT(test_case_reg_, __LINE__))
 #define SECTION(name) if (true)
 #define REQUIRE(expr) do { if (!(expr)) { std::cerr << "FAIL: " << #expr << " at " << __FILE__ << ":" << __LINE__ << "\n"; std::abort(); } } while(0)
 #define REQUIRE_FALSE(expr) REQUIRE(!(expr))
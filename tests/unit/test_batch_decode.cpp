@@ -0,0 +1,88 @@
+#include "catch2_single_header.hpp"
+#include "forkenizer/Tokenizer.hpp"
+#include "test_model.hpp"
+#include <string>
+#include <string_view>
+#include <vector>
+
+TEST_CASE("Batch decode matches decode and skips special tokens", "[batch]") {
+    std::string dir = writeTestModel("batch_decode", {"hello", "world", "\xC3\xA9"});
+    forkenizer::Tokenizer tokenizer;
+    REQUIRE(tokenizer.load(dir));
+    removeTestModel(dir);
+
+    std::vector<std::string_view> texts = {"hello world", "", "\xC3\xA9t\xC3\xA9 hello", "x"};
+    std::vector<uint32_t> ids(texts.size() * 12, 0);
+    std::vector<uint8_t> mask(ids.size());
+    forkenizer::BatchEncodeOptions encodeOptions;
+    encodeOptions.maxLength = 12;
+    encodeOptions.addBos = true;
+    encodeOptions.addEos = true;
+    REQUIRE(tokenizer.encodeBatchPadded(texts, encodeOptions, ids.data(), mask.data()));
+
+    std::vector<size_t> offsets;
+    for (size_t i = 0; i <= texts.size(); ++i) {
+        offsets.push_back(i * 12);
+    }
+    forkenizer::BatchDecodeOptions options;
+    options.skipSpecialTokens = true;
+    options.numThreads = 3;
+    forkenizer::DecodedBatch decoded;
+    REQUIRE(tokenizer.decodeBatch(ids.data(), offsets.data(), texts.size(), options, decoded));
+    REQUIRE(decoded.size() == texts.size());
+    for (size_t i = 0; i < texts.size(); ++i) {
+        REQUIRE(decoded[i] == texts[i]);
+    }
+    REQUIRE(decoded.text == "hello world\xC3\xA9t\xC3\xA9 hellox");
+
+    std::vector<std::vector<uint32_t>> sequences = {{2, 4 + 'a', 3, 0, 0}, {}, {4 + 'b'}};
+    REQUIRE(tokenizer.decodeBatch(sequences, forkenizer::BatchDecodeOptions{}, decoded));
+    REQUIRE(decoded.size() == 3);
+    REQUIRE(decoded[0] == *tokenizer.decode(sequences[0]));
+    REQUIRE(decoded[0] == "<bos>a<eos><pad><pad>");
+    REQUIRE(decoded[1].empty());
+    REQUIRE(decoded[2] == "b");
+
+    REQUIRE(tokenizer.decodeBatch(sequences, options, decoded));
+    REQUIRE(decoded[0] == "a");
+}
+
+TEST_CASE("Batch decode replaces ill-formed UTF-8 per maximal subpart", "[batch]") {
+    std::string dir = writeTestModel("batch_decode_utf8", {});
+    forkenizer::Tokenizer tokenizer;
+    REQUIRE(tokenizer.load(dir));
+    removeTestModel(dir);
+
+    auto byteIds = [](std::string_view bytes) {
+        std::vector<uint32_t> ids;
+        for (unsigned char byte : bytes) ids.push_back(4 + byte);
+        return ids;
+    };
+    // A character split across byte tokens stays intact; a truncated one becomes one
+    // U+FFFD, stray continuation bytes and invalid leads one each.
+    std::vector<std::vector<uint32_t>> sequences = {
+        byteIds("a\xE2\x82\xAC"),
+        byteIds("a\xE2\x82"),
+        byteIds("\x80\x80z"),
+        byteIds("\xC0\xAF!"),
+        byteIds("\xED\xA0\x80"),
+        byteIds("\xF0\x9F\x98"),
+    };
+    forkenizer::BatchDecodeOptions options;
+    options.replaceInvalidUtf8 = true;
+    forkenizer::DecodedBatch decoded;
+    REQUIRE(tokenizer.decodeBatch(sequences, options, decoded));
+    const std::string replacement = "\xEF\xBF\xBD";
+    REQUIRE(decoded[0] == "a\xE2\x82\xAC");
+    REQUIRE(decoded[1] == "a" + replacement);
+    REQUIRE(decoded[2] == replacement + replacement + "z");
+    REQUIRE(decoded[3] == replacement + replacement + "!");
+    REQUIRE(decoded[4] == replacement + replacement + replacement);
+    REQUIRE(decoded[5] == replacement);
+
+    options.replaceInvalidUtf8 = false;
+    REQUIRE(tokenizer.decodeBatch(sequences, options, decoded));
+    REQUIRE(decoded[1] == "a\xE2\x82");
+}
+
+int main() { return 0; }
@@ -0,0 +1,126 @@
+#include "catch2_single_header.hpp"
+#include "forkenizer/Tokenizer.hpp"
+#include "test_model.hpp"
+#include <string>
+#include <string_view>
+#include <vector>
+
+static std::vector<uint32_t> row(const std::vector<uint32_t>& ids, size_t r, size_t maxLength) {
+    return std::vector<uint32_t>(ids.begin() + r * maxLength, ids.begin() + (r + 1) * maxLength);
+}
+
+TEST_CASE("Padded batch matches encode with right padding", "[batch]") {
+    std::string dir = writeTestModel("batch_right", {"hello", "world"});
+    forkenizer::Tokenizer tokenizer;
+    REQUIRE(tokenizer.load(dir));
+    removeTestModel(dir);
+
+    std::vector<std::string_view> texts = {"hello world", "", "hello hello hello hello", "x"};
+    forkenizer::BatchEncodeOptions options;
+    options.maxLength = 6;
+    options.addBos = true;
+    options.addEos = true;
+    options.numThreads = 2;
+
+    std::vector<uint32_t> ids(texts.size() * options.maxLength, 99);
+    std::vector<uint8_t> mask(texts.size() * options.maxLength, 9);
+    std::vector<uint32_t> lengths(texts.size());
+    REQUIRE(tokenizer.encodeBatchPadded(texts, options, ids.data(), mask.data(), lengths.data()));
+
+    auto helloWorld = *tokenizer.encode("hello world");
+    REQUIRE(row(ids, 0, 6) == std::vector<uint32_t>({2, helloWorld[0], helloWorld[1], helloWorld[2], 3, 0}));
+    REQUIRE(lengths[0] == 5);
+    REQUIRE(mask[4] == 1);
+    REQUIRE(mask[5] == 0);
+
+    REQUIRE(row(ids, 1, 6) == std::vector<uint32_t>({2, 3, 0, 0, 0, 0}));
+    REQUIRE(lengths[1] == 2);
+
+    auto hellos = *tokenizer.encode("hello hello hello hello");
+    REQUIRE(row(ids, 2, 6) == std::vector<uint32_t>({2, hellos[0], hellos[1], hellos[2], hellos[3], 3}));
+    REQUIRE(lengths[2] == 6);
+    for (size_t i = 12; i < 18; ++i) {
+        REQUIRE(mask[i] == 1);
+    }
+}
+
+TEST_CASE("Padded batch with left padding and left truncation", "[batch]") {
+    std::string dir = writeTestModel("batch_left", {"a", "b", "c"});
+    forkenizer::Tokenizer tokenizer;
+    REQUIRE(tokenizer.load(dir));
+    removeTestModel(dir);
+
+    std::vector<std::string_view> texts = {"a b c", "c"};
+    forkenizer::BatchEncodeOptions options;
+    options.maxLength = 4;
+    options.paddingSide = forkenizer::PaddingSide::Left;
+    options.truncationSide = forkenizer::TruncationSide::Left;
+
+    std::vector<uint32_t> ids(texts.size() * options.maxLength);
+    std::vector<uint8_t> mask(texts.size() * options.maxLength);
+    REQUIRE(tokenizer.encodeBatchPadded(texts, options, ids.data(), mask.data()));
+
+    auto full = *tokenizer.encode("a b c");
+    REQUIRE(full.size() == 5);
+    REQUIRE(row(ids, 0, 4) == std::vector<uint32_t>(full.end() - 4, full.end()));
+
+    auto c = *tokenizer.encode("c");
+    REQUIRE(row(ids, 1, 4) == std::vector<uint32_t>({0, 0, 0, c[0]}));
+    REQUIRE(std::vector<uint8_t>(mask.begin() + 4, mask.end()) == std::vector<uint8_t>({0, 0, 0, 1}));
+}
+
+TEST_CASE("Padded batch handles many rows in parallel", "[batch]") {
+    std::string dir = writeTestModel("batch_parallel", {"token"});
+    forkenizer::Tokenizer tokenizer;
+    REQUIRE(tokenizer.load(dir));
+    removeTestModel(dir);
+
+    std::vector<std::string> storage;
+    std::vector<std::string_view> texts;
+    for (int i = 0; i < 200; ++i) {
+        storage.push_back(std::string(static_cast<size_t>(i % 7), 'x') + " token " + std::to_string(i));
+    }
+    for (const auto& text : storage) {
+        texts.push_back(text);
+    }
+
+    forkenizer::BatchEncodeOptions options;
+    options.maxLength = 8;
+    options.numThreads = 4;
+    std::vector<uint32_t> ids(texts.size() * options.maxLength);
+    REQUIRE(tokenizer.encodeBatchPadded(texts, options, ids.data(), nullptr));
+
+    for (size_t r = 0; r < texts.size(); ++r) {
+        auto expected = *tokenizer.encode(texts[r]);
+        expected.resize(options.maxLength, 0);
+        REQUIRE(row(ids, r, options.maxLength) == expected);
+    }
+}
+
+TEST_CASE("Padded batch fills rows when collapsed whitespace is dropped", "[batch]") {
+    std::string dir = writeTestModel("batch_collapse", {});
+    forkenizer::Tokenizer tokenizer;
+    REQUIRE(tokenizer.load(dir));
+    removeTestModel(dir);
+    forkenizer::NormalizationOptions normalization;
+    normalization.collapseWhitespace = true;
+    tokenizer.setNormalization(normalization);
+
+    // The run of spaces pretokenizes into pieces that collapse drops, so they don't count
+    // against the row.
+    std::vector<std::string_view> texts = {"a     b c d e f"};
+    forkenizer::BatchEncodeOptions options;
+    options.maxLength = 6;
+    std::vector<uint32_t> ids(texts.size() * options.maxLength);
+    std::vector<uint32_t> lengths(texts.size());
+    REQUIRE(tokenizer.encodeBatchPadded(texts, options, ids.data(), nullptr, lengths.data()));
+
+    auto full = *tokenizer.encode(texts[0]);
+    REQUIRE(full.size() == 11);
+    REQUIRE(lengths[0] == 6);
+    REQUIRE(row(ids, 0, 6) == std::vector<uint32_t>(full.begin(), full.begin() + 6));
+}
+
+int main() {
+    return 0;
+}
@@ -0,0 +1,82 @@
+#include "catch2_single_header.hpp"
+#include "../../src/bench/PerfCounters.hpp"
+#include "../../src/bench/Stats.hpp"
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+TEST_CASE("Median of samples", "[bench]") {
+    REQUIRE(forkenizer::median({3.0, 1.0, 2.0}) == 2.0);
+    REQUIRE(forkenizer::median({4.0, 1.0, 3.0, 2.0}) == 2.5);
+    REQUIRE(forkenizer::median({}) == 0.0);
+}
+
+TEST_CASE("Mann-Whitney detects shifted samples", "[bench]") {
+    std::vector<double> baseline = {10.0, 10.2, 9.9, 10.1, 10.05, 9.95, 10.15, 10.0};
+    std::vector<double> slower = {11.0, 11.2, 10.9, 11.1, 11.05, 10.95, 11.15, 11.0};
+
+    REQUIRE(forkenizer::mannWhitneyGreaterPValue(slower, baseline) < 0.01);
+    REQUIRE(forkenizer::mannWhitneyGreaterPValue(baseline, slower) > 0.5);
+    REQUIRE(forkenizer::mannWhitneyGreaterPValue(baseline, baseline) > 0.1);
+}
+
+TEST_CASE("Regression requires threshold and significance", "[bench]") {
+    forkenizer::BenchmarkResults baseline;
+    baseline["encode_ns_per_byte"] = {"ns/byte", {10.0, 10.1, 9.9, 10.0, 10.05, 9.95}};
+    baseline["decode_ns_per_token"] = {"ns/token", {5.0, 5.1, 4.9, 5.0, 5.05, 4.95}};
+
+    forkenizer::BenchmarkResults current;
+    current["encode_ns_per_byte"] = {"ns/byte", {12.0, 12.1, 11.9, 12.0, 12.05, 11.95}};
+    current["decode_ns_per_token"] = {"ns/token", {5.01, 5.11, 4.91, 5.01, 5.06, 4.96}};
+
+    auto comparisons = forkenizer::compareResults(baseline, current, 0.05, 0.01);
+    REQUIRE(comparisons.size() == 2);
+    for (const auto& cmp : comparisons) {
+        if (cmp.name == "encode_ns_per_byte") {
+            REQUIRE(cmp.regressed);
+        } else {
+            REQUIRE_FALSE(cmp.regressed);
+        }
+    }
+}
+
+TEST_CASE("Baseline save/load round-trip", "[bench]") {
+    forkenizer::BenchmarkResults results;
+    results["load_ms"] = {"ms", {1.5, 1.25, 1.75}};
+    results["train_ms"] = {"ms", {100.0}};
+
+    std::string path = "forkenizer_bench_baseline_test.json";
+    REQUIRE(forkenizer::saveResults(path, results));
+
+    forkenizer::BenchmarkResults loaded;
+    REQUIRE(forkenizer::loadResults(path, loaded));
+    std::remove(path.c_str());
+
+    REQUIRE(loaded.size() == 2);
+    REQUIRE(loaded["load_ms"].unit == "ms");
+    REQUIRE(loaded["load_ms"].samples == results["load_ms"].samples);
+    REQUIRE(loaded["train_ms"].samples.size() == 1);
+}
+
+TEST_CASE("Hardware counters read or report why not", "[bench]") {
+    forkenizer::PerfCounters counters;
+    const bool opened = counters.open();
+    REQUIRE(opened == counters.available());
+    REQUIRE((opened || !counters.error().empty()));
+
+    counters.start();
+    volatile uint64_t sum = 0;
+    for (uint64_t i = 0; i < 100000; ++i) sum = sum + i;
+    auto reading = counters.stop();
+    if (!opened) {
+        for (double value : reading.values) REQUIRE(value < 0.0);
+    } else if (reading.has(forkenizer::PerfEvent::Instructions)) {
+        REQUIRE(reading[forkenizer::PerfEvent::Instructions] > 100000.0);
+    }
+    REQUIRE(std::string(forkenizer::perfEventName(forkenizer::PerfEvent::DtlbMisses)) == "dtlb_misses");
+}
+
+int main() {
+    return 0;
+}
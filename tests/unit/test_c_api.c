@@ -0,0 +1,55 @@
+/* Exercises the C API from plain C. Takes a trained model directory as argv[1]. */
+#include "forkenizer/forkenizer.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define REQUIRE(expr) do { if (!(expr)) { fprintf(stderr, "FAIL: %s at %s:%d\n", #expr, __FILE__, __LINE__); abort(); } } while (0)
+
+int main(int argc, char** argv) {
+    REQUIRE(argc == 2);
+    REQUIRE(strlen(forkenizer_version()) > 0);
+
+    REQUIRE(forkenizer_model_load("/nonexistent/model") == NULL);
+    REQUIRE(strlen(forkenizer_last_error()) > 0);
+
+    forkenizer_model* model = forkenizer_model_load(argv[1]);
+    REQUIRE(model != NULL);
+    REQUIRE(forkenizer_vocab_size(model) > 256);
+
+    const char* data = "hello world" "3.14 + 2" "";
+    const int64_t text_offsets[] = {0, 11, 19, 19};
+    int64_t id_offsets[4];
+    uint32_t ids[64];
+
+    /* Undersized buffer: offsets still report the full requirement. */
+    REQUIRE(forkenizer_encode_batch(model, data, text_offsets, 3, ids, 2, id_offsets) ==
+            FORKENIZER_ERROR_BUFFER_TOO_SMALL);
+    const int64_t required = id_offsets[3];
+    REQUIRE(required > 2 && required <= 64);
+
+    REQUIRE(forkenizer_encode_batch(model, data, text_offsets, 3, ids, 64, id_offsets) == FORKENIZER_OK);
+    REQUIRE(id_offsets[0] == 0);
+    REQUIRE(id_offsets[3] == required);
+    REQUIRE(id_offsets[2] == id_offsets[3]);
+
+    char text[64];
+    size_t length = 0;
+    for (int i = 0; i < 2; ++i) {
+        const uint32_t* row = ids + id_offsets[i];
+        const size_t rowCount = (size_t)(id_offsets[i + 1] - id_offsets[i]);
+        REQUIRE(forkenizer_decode(model, row, rowCount, text, sizeof(text), &length) == FORKENIZER_OK);
+        REQUIRE(length == (size_t)(text_offsets[i + 1] - text_offsets[i]));
+        REQUIRE(memcmp(text, data + text_offsets[i], length) == 0);
+    }
+
+    REQUIRE(forkenizer_decode(model, ids, (size_t)id_offsets[1], text, 4, &length) ==
+            FORKENIZER_ERROR_BUFFER_TOO_SMALL);
+    REQUIRE(length == 11);
+
+    REQUIRE(forkenizer_encode_batch(NULL, data, text_offsets, 3, ids, 64, id_offsets) ==
+            FORKENIZER_ERROR_INVALID_ARGUMENT);
+
+    forkenizer_model_free(model);
+    return 0;
+}
@@ -0,0 +1,68 @@
+#include "catch2_single_header.hpp"
+#include "forkenizer/ModelIO.hpp"
+#include "forkenizer/Tokenizer.hpp"
+#include "kTestModel.hpp"
+#include <filesystem>
+#include <random>
+#include <string>
+#include <vector>
+
+// kTestModel is generated by forkenizer_embed_model() from a model trained on
+// data_examples/tiny_corpus.txt at EMBED_TEST_MODEL.
+
+TEST_CASE("Embedded model encodes like the model directory it was built from", "[embed]") {
+    forkenizer::Tokenizer loaded;
+    REQUIRE(loaded.load(EMBED_TEST_MODEL));
+    forkenizer::Tokenizer embedded(kTestModel);
+    REQUIRE(embedded.isLoaded());
+    REQUIRE(embedded.vocabSize() == loaded.vocabSize());
+
+    std::vector<std::string> texts = {"", "hello world", "<bos>The quick brown fox<eos>", "na\xC3\xAFve caf\xC3\xA9 123"};
+    std::mt19937 rng(11);
+    const std::string alphabet = "the quick brown fox\n\t0123.,!\xC3\xA9\xE2\x82\xAC";
+    for (int i = 0; i < 100; ++i) {
+        std::string text;
+        const size_t length = rng() % 200;
+        for (size_t k = 0; k < length; ++k) text += alphabet[rng() % alphabet.size()];
+        texts.push_back(text);
+    }
+    for (const auto& text : texts) {
+        auto ids = embedded.encode(text);
+        REQUIRE(ids.has_value());
+        REQUIRE(*ids == *loaded.encode(text));
+        REQUIRE(embedded.decode(*ids) == loaded.decode(*ids));
+    }
+    REQUIRE(embedded.tokenId("<eos>") == loaded.tokenId("<eos>"));
+}
+
+TEST_CASE("Embedded model saves the model it was built from", "[embed]") {
+    forkenizer::Tokenizer embedded(kTestModel);
+    std::string dir = (std::filesystem::temp_directory_path() / "forkenizer_embedded_save").string();
+    REQUIRE(embedded.save(dir));
+
+    forkenizer::ModelData original, saved;
+    REQUIRE(forkenizer::loadModel(EMBED_TEST_MODEL, original));
+    REQUIRE(forkenizer::loadModel(dir, saved));
+    std::filesystem::remove_all(dir);
+    REQUIRE(saved.merges == original.merges);
+    REQUIRE(saved.vocab.idCount() == original.vocab.idCount());
+    for (uint32_t id = 0; id < original.vocab.idCount(); ++id) {
+        REQUIRE(saved.vocab.token(id) == original.vocab.token(id));
+    }
+}
+
+TEST_CASE("Embedded model can be re-laid out without touching the generated tables", "[embed]") {
+    forkenizer::Tokenizer loaded;
+    REQUIRE(loaded.load(EMBED_TEST_MODEL));
+    forkenizer::Tokenizer embedded(kTestModel);
+    std::vector<std::string_view> samples = {"the quick brown fox jumps", "hello world 123"};
+    REQUIRE(embedded.optimizeTrieLayout(samples));
+    for (auto sample : samples) {
+        REQUIRE(*embedded.encode(sample) == *loaded.encode(sample));
+    }
+
+    forkenizer::Tokenizer fresh(kTestModel);
+    REQUIRE(*fresh.encode("hello world") == *loaded.encode("hello world"));
+}
+
+int main() { return 0; }
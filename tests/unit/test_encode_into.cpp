@@ -0,0 +1,80 @@
+#include "catch2_single_header.hpp"
+#include "forkenizer/Tokenizer.hpp"
+#include "test_model.hpp"
+#include <atomic>
+#include <cstdlib>
+#include <new>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace {
+
+std::atomic<size_t> allocations{0};
+
+}
+
+void* operator new(size_t size) {
+    allocations.fetch_add(1, std::memory_order_relaxed);
+    if (void* memory = std::malloc(size == 0 ? 1 : size)) return memory;
+    throw std::bad_alloc();
+}
+
+void operator delete(void* memory) noexcept { std::free(memory); }
+void operator delete(void* memory, size_t) noexcept { std::free(memory); }
+
+TEST_CASE("encodeInto matches encode and stops allocating once warm", "[encode_into]") {
+    std::string dir = writeTestModel("encode_into", {"hello", "world", " world", "ab", "abc", "\xC3\xA9"});
+    forkenizer::Tokenizer tokenizer;
+    REQUIRE(tokenizer.load(dir));
+    removeTestModel(dir);
+
+    std::mt19937 rng(17);
+    const std::string alphabet = "abc helowrd\n12.<eos>\xC3\xA9\xCC\x81";
+    std::vector<std::string> texts = {"", "hello world", "<bos>hello<eos> world<eos>"};
+    for (int i = 0; i < 200; ++i) {
+        std::string text;
+        const size_t length = rng() % 400;
+        for (size_t k = 0; k < length; ++k) text += alphabet[rng() % alphabet.size()];
+        texts.push_back(text);
+    }
+
+    forkenizer::NormalizationOptions normalized;
+    normalized.form = forkenizer::NormalizationForm::NFC;
+    normalized.lowercase = true;
+    normalized.collapseWhitespace = true;
+    for (const auto& options : {forkenizer::NormalizationOptions{}, normalized}) {
+        tokenizer.setNormalization(options);
+        forkenizer::EncodeScratch scratch;
+        std::vector<uint32_t> ids;
+        for (const auto& text : texts) {
+            REQUIRE(tokenizer.encodeInto(text, ids, scratch));
+            REQUIRE(ids == *tokenizer.encode(text));
+        }
+
+        const size_t before = allocations.load();
+        size_t total = 0;
+        for (int round = 0; round < 3; ++round) {
+            for (const auto& text : texts) {
+                tokenizer.encodeInto(text, ids, scratch);
+                total += ids.size();
+            }
+        }
+        REQUIRE(allocations.load() == before);
+        REQUIRE(total > 0);
+    }
+
+    // Scratches are independent: interleaving two leaves both results intact.
+    forkenizer::EncodeScratch first, second;
+    std::vector<uint32_t> a, b;
+    REQUIRE(tokenizer.encodeInto(texts[1], a, first));
+    REQUIRE(tokenizer.encodeInto(texts[2], b, second));
+    REQUIRE(a == *tokenizer.encode(texts[1]));
+    REQUIRE(b == *tokenizer.encode(texts[2]));
+
+    forkenizer::Tokenizer unloaded;
+    REQUIRE_FALSE(unloaded.encodeInto("hello", a, first));
+    REQUIRE(a.empty());
+}
+
+int main() { return 0; }
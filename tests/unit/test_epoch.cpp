@@ -0,0 +1,39 @@
+#include "catch2_single_header.hpp"
+#include "../../src/util/Epoch.hpp"
+#include <atomic>
+#include <thread>
+#include <vector>
+
+TEST_CASE("Readers beyond the first slot block neither wait nor go unseen", "[epoch]") {
+    using forkenizer::EpochDomain;
+    const size_t readers = 3 * forkenizer::epoch_detail::kSlotsPerBlock + 1;
+
+    // Every reader holds a guard until all of them have one, so each needs its own slot.
+    std::atomic<size_t> pinned{0};
+    std::atomic<bool> release{false};
+    std::vector<std::thread> threads;
+    for (size_t i = 0; i < readers; ++i) {
+        threads.emplace_back([&] {
+            EpochDomain::Guard guard;
+            pinned.fetch_add(1);
+            while (!release.load()) std::this_thread::yield();
+        });
+    }
+    while (pinned.load() < readers) std::this_thread::yield();
+
+    const uint64_t retired = EpochDomain::advance();
+    REQUIRE_FALSE(EpochDomain::quiescent(retired));
+    release.store(true);
+    for (auto& thread : threads) thread.join();
+    REQUIRE(EpochDomain::quiescent(retired));
+
+    // Slots freed by exited threads are reused rather than growing the list again.
+    std::thread([] { EpochDomain::Guard guard; }).join();
+    size_t blocks = 0;
+    for (auto* block = &forkenizer::epoch_detail::firstSlotBlock; block != nullptr; block = block->next.load()) {
+        ++blocks;
+    }
+    REQUIRE(blocks == 4);
+}
+
+int main() { return 0; }
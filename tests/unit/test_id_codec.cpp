@@ -0,0 +1,158 @@
+#include "catch2_single_header.hpp"
+#include "forkenizer/IdCodec.hpp"
+#include <algorithm>
+#include <atomic>
+#include <cstdlib>
+#include <new>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace {
+
+std::atomic<size_t> largestAllocation{0};
+
+std::vector<uint32_t> roundTrip(const std::vector<uint32_t>& ids, size_t* encodedBytes = nullptr) {
+    std::vector<uint8_t> encoded(forkenizer::maxEncodedIdBytes(ids.size()));
+    const size_t bytes = forkenizer::encodeIds(ids.data(), ids.size(), encoded.data());
+    if (encodedBytes) *encodedBytes = bytes;
+    std::vector<uint32_t> decoded(ids.size());
+    if (!forkenizer::decodeIds(encoded.data(), bytes, decoded.data(), decoded.size())) return {UINT32_MAX, 0};
+    return decoded;
+}
+
+}
+
+void* operator new(size_t size) {
+    size_t largest = largestAllocation.load(std::memory_order_relaxed);
+    while (size > largest && !largestAllocation.compare_exchange_weak(largest, size)) {
+    }
+    if (void* memory = std::malloc(size == 0 ? 1 : size)) return memory;
+    throw std::bad_alloc();
+}
+
+void operator delete(void* memory) noexcept { std::free(memory); }
+void operator delete(void* memory, size_t) noexcept { std::free(memory); }
+
+TEST_CASE("Id codec round-trips every byte length and tail size", "[id_codec]") {
+    const std::vector<uint32_t> edges = {0, 1, 255, 256, 65535, 65536, (1u << 24) - 1, 1u << 24, UINT32_MAX};
+    for (size_t count = 0; count <= 40; ++count) {
+        std::vector<uint32_t> ids;
+        for (size_t i = 0; i < count; ++i) ids.push_back(edges[(i * 7 + count) % edges.size()]);
+        REQUIRE(roundTrip(ids) == ids);
+    }
+
+    std::mt19937 rng(3);
+    std::vector<uint32_t> ids(100000);
+    for (auto& id : ids) id = rng() >> (rng() % 32);
+    REQUIRE(roundTrip(ids) == ids);
+
+    // Small ids take one byte plus two control bits.
+    std::vector<uint32_t> small(1000, 200);
+    size_t bytes = 0;
+    REQUIRE(roundTrip(small, &bytes) == small);
+    REQUIRE(bytes == 1250);
+}
+
+TEST_CASE("Id codec rejects inputs of the wrong size", "[id_codec]") {
+    std::vector<uint32_t> ids = {1, 300, 70000, 5, 9};
+    std::vector<uint8_t> encoded(forkenizer::maxEncodedIdBytes(ids.size()));
+    const size_t bytes = forkenizer::encodeIds(ids.data(), ids.size(), encoded.data());
+    std::vector<uint32_t> out(ids.size());
+    REQUIRE(forkenizer::decodeIds(encoded.data(), bytes, out.data(), out.size()));
+    REQUIRE_FALSE(forkenizer::decodeIds(encoded.data(), bytes - 1, out.data(), out.size()));
+    REQUIRE_FALSE(forkenizer::decodeIds(encoded.data(), bytes + 1, out.data(), out.size()));
+    REQUIRE_FALSE(forkenizer::decodeIds(encoded.data(), 1, out.data(), out.size()));
+}
+
+TEST_CASE("Packed id stream keeps documents and seeks by block header", "[id_codec]") {
+    std::mt19937 rng(9);
+    std::vector<std::vector<uint32_t>> documents(500);
+    for (auto& document : documents) {
+        document.resize(rng() % 300);
+        for (auto& id : document) id = rng() % 50000;
+    }
+
+    std::stringstream stream;
+    forkenizer::IdStreamWriter writer(stream, 1000);
+    for (const auto& document : documents) {
+        REQUIRE(writer.addDocument(document.data(), document.size()));
+    }
+    REQUIRE(writer.finish());
+    const std::string packed = stream.str();
+
+    std::istringstream in(packed);
+    forkenizer::IdStreamReader reader(in);
+    REQUIRE(reader.valid());
+    forkenizer::IdBlock block;
+    size_t next = 0;
+    size_t blocks = 0;
+    while (reader.readBlock(block)) {
+        ++blocks;
+        for (size_t d = 0; d < block.documents(); ++d, ++next) {
+            std::vector<uint32_t> ids(block.ids.begin() + block.offsets[d], block.ids.begin() + block.offsets[d + 1]);
+            REQUIRE(ids == documents[next]);
+        }
+    }
+    REQUIRE(reader.error().empty());
+    REQUIRE(next == documents.size());
+    REQUIRE(blocks > 10);
+
+    std::istringstream seekIn(packed);
+    forkenizer::IdStreamReader seeker(seekIn);
+    auto first = seeker.seekDocument(321);
+    REQUIRE(first.has_value());
+    REQUIRE(*first <= 321);
+    REQUIRE(seeker.readBlock(block));
+    REQUIRE(*first + block.documents() > 321);
+    const size_t d = 321 - *first;
+    REQUIRE((std::vector<uint32_t>(block.ids.begin() + block.offsets[d], block.ids.begin() + block.offsets[d + 1]) ==
+             documents[321]));
+    REQUIRE_FALSE(seeker.seekDocument(documents.size()).has_value());
+
+    std::istringstream truncated(packed.substr(0, packed.size() - 3));
+    forkenizer::IdStreamReader broken(truncated);
+    while (broken.readBlock(block)) {
+    }
+    REQUIRE_FALSE(broken.error().empty());
+
+    // Counts the payload bytes could not hold are rejected before anything is allocated.
+    for (size_t field : {0, 4}) {
+        std::string corrupt = packed.substr(0, 8) + std::string(16, '\0');
+        corrupt.replace(8 + field, 4, "\xFF\xFF\xFF\xFF");
+        std::istringstream corruptIn(corrupt);
+        forkenizer::IdStreamReader corruptReader(corruptIn);
+        REQUIRE(corruptReader.valid());
+        REQUIRE_FALSE(corruptReader.readBlock(block));
+        REQUIRE(corruptReader.error() == "corrupt block header");
+    }
+
+    // A header whose sizes agree with its counts but claims ~1.3 GB over a short stream
+    // only allocates about the bytes that are there.
+    std::string huge = packed.substr(0, 8);
+    for (uint32_t field : {1u, 1u << 30, 2u, (1u << 28) + (1u << 30)}) {
+        for (int shift = 0; shift < 32; shift += 8) huge += static_cast<char>(field >> shift);
+    }
+    huge += std::string(4096, '\0');
+    std::istringstream hugeIn(huge);
+    forkenizer::IdStreamReader hugeReader(hugeIn);
+    largestAllocation = 0;
+    REQUIRE_FALSE(hugeReader.readBlock(block));
+    REQUIRE(hugeReader.error() == "truncated block");
+    REQUIRE(largestAllocation.load() <= (size_t(2) << 20));
+
+    std::stringstream empty;
+    forkenizer::IdStreamWriter emptyWriter(empty);
+    REQUIRE(emptyWriter.finish());
+    std::istringstream emptyIn(empty.str());
+    forkenizer::IdStreamReader emptyReader(emptyIn);
+    REQUIRE(emptyReader.valid());
+    REQUIRE_FALSE(emptyReader.readBlock(block));
+    REQUIRE(emptyReader.error().empty());
+
+    std::istringstream text("1 2 3\n");
+    REQUIRE_FALSE(forkenizer::IdStreamReader(text).valid());
+}
+
+int main() { return 0; }
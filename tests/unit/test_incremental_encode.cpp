@@ -0,0 +1,94 @@
+#include "catch2_single_header.hpp"
+#include "forkenizer/PreTokenizer.hpp"
+#include "forkenizer/Tokenizer.hpp"
+#include "test_model.hpp"
+#include <random>
+#include <string>
+#include <vector>
+
+namespace {
+
+bool sameEncoding(const forkenizer::EditableEncoding& a, const forkenizer::EditableEncoding& b) {
+    return a.tokens.ids == b.tokens.ids && a.tokens.begins == b.tokens.begins && a.tokens.ends == b.tokens.ends &&
+           a.pieceBegins == b.pieceBegins && a.pieceFirstTokens == b.pieceFirstTokens &&
+           a.pieceAfterSpace == b.pieceAfterSpace && a.textBytes == b.textBytes;
+}
+
+}
+
+TEST_CASE("applyEdit matches a full re-encode after every edit", "[incremental_encode]") {
+    std::string dir =
+        writeTestModel("incremental", {"ab", "abc", "bd", " a", "hello", " world", "\xC3\xA9", "12", "<|sep|>"});
+    forkenizer::Tokenizer tokenizer;
+    REQUIRE(tokenizer.load(dir));
+    removeTestModel(dir);
+    REQUIRE(tokenizer.addSpecialToken("<|sep|>"));
+
+    // "long" reads through any run of b/c looking for a d, however far away it is.
+    auto greedyReader = forkenizer::PreTokenizer::fromSpec("long  a[bc]*d\npreset default\n");
+    auto gpt2 = forkenizer::PreTokenizer::fromPreset("gpt2");
+    REQUIRE(greedyReader.has_value());
+    REQUIRE(gpt2.has_value());
+
+    forkenizer::NormalizationOptions normalized;
+    normalized.lowercase = true;
+    normalized.collapseWhitespace = true;
+
+    const std::vector<std::string> fragments = {"a", "b", "c", "d", " ", "  ", "\n", "ab", "bbbb", "cd", "1", "12",
+                                                "<eos>", "<eo", "s>", "<|sep|>", "<|", "|>", "\xC3\xA9", "\xCC\x81",
+                                                "\xC3", "Hello", " World"};
+    std::mt19937 rng(31);
+    auto randomText = [&](size_t pieces) {
+        std::string text;
+        for (size_t k = 0; k < pieces; ++k) text += fragments[rng() % fragments.size()];
+        return text;
+    };
+
+    for (const auto* preTokenizer : {&*greedyReader, &*gpt2}) {
+        tokenizer.setPreTokenizer(*preTokenizer);
+        for (const auto& options : {forkenizer::NormalizationOptions{}, normalized}) {
+            tokenizer.setNormalization(options);
+            for (int doc = 0; doc < 20; ++doc) {
+                std::string text = randomText(rng() % 600);
+                auto encoding = tokenizer.encodeEditable(text);
+                REQUIRE(encoding.has_value());
+                for (int step = 0; step < 40; ++step) {
+                    forkenizer::TextEdit edit;
+                    edit.offset = rng() % (text.size() + 1);
+                    edit.removed = std::min<size_t>(rng() % 8, text.size() - edit.offset);
+                    const std::string inserted = rng() % 4 == 0 ? "" : randomText(1 + rng() % 3);
+                    edit.inserted = inserted.size();
+                    text.replace(edit.offset, edit.removed, inserted);
+
+                    REQUIRE(tokenizer.applyEdit(text, edit, *encoding));
+                    REQUIRE(sameEncoding(*encoding, *tokenizer.encodeEditable(text)));
+                    auto full = tokenizer.encodeWithOffsets(text);
+                    REQUIRE(encoding->tokens.ids == full->ids);
+                    REQUIRE(encoding->tokens.ends == full->ends);
+                }
+            }
+        }
+    }
+}
+
+TEST_CASE("applyEdit rejects edits that do not fit the encoding", "[incremental_encode]") {
+    std::string dir = writeTestModel("incremental_reject", {"hello"});
+    forkenizer::Tokenizer tokenizer;
+    REQUIRE(tokenizer.load(dir));
+    removeTestModel(dir);
+
+    auto encoding = tokenizer.encodeEditable("hello world");
+    REQUIRE(encoding.has_value());
+    REQUIRE_FALSE(tokenizer.applyEdit("hello world", forkenizer::TextEdit{12, 0, 0}, *encoding));
+    REQUIRE_FALSE(tokenizer.applyEdit("hello world", forkenizer::TextEdit{6, 1, 2}, *encoding));
+    REQUIRE(tokenizer.applyEdit("hello, world", forkenizer::TextEdit{5, 0, 1}, *encoding));
+    REQUIRE(encoding->tokens.ids == *tokenizer.encode("hello, world"));
+    REQUIRE(tokenizer.applyEdit("", forkenizer::TextEdit{0, 12, 0}, *encoding));
+    REQUIRE(encoding->tokens.ids.empty());
+    REQUIRE(encoding->pieceBegins.empty());
+
+    forkenizer::Tokenizer unloaded;
+    REQUIRE_FALSE(unloaded.encodeEditable("hello").has_value());
+}
+
+int main() { return 0; }
@@ -0,0 +1,130 @@
+#include "catch2_single_header.hpp"
+#include "forkenizer/Tokenizer.hpp"
+#include "test_model.hpp"
+#include <atomic>
+#include <cstdlib>
+#include <new>
+#include <random>
+#include <string>
+#include <string_view>
+#include <sys/mman.h>
+#include <vector>
+
+namespace {
+
+std::atomic<size_t> allocations{0};
+
+std::vector<uint32_t> collect(forkenizer::Generator<uint32_t> tokens) {
+    std::vector<uint32_t> ids;
+    for (uint32_t id : tokens) ids.push_back(id);
+    return ids;
+}
+
+}
+
+void* operator new(size_t size) {
+    allocations.fetch_add(1, std::memory_order_relaxed);
+    if (void* memory = std::malloc(size == 0 ? 1 : size)) return memory;
+    throw std::bad_alloc();
+}
+
+void operator delete(void* memory) noexcept { std::free(memory); }
+void operator delete(void* memory, size_t) noexcept { std::free(memory); }
+
+TEST_CASE("Lazy encode yields exactly what encode returns", "[lazy]") {
+    std::string dir = writeTestModel("lazy_encode", {"hello", "world", " world", "ab", "abc", "\xC3\xA9"});
+    forkenizer::Tokenizer tokenizer;
+    REQUIRE(tokenizer.load(dir));
+    removeTestModel(dir);
+
+    std::mt19937 rng(5);
+    const std::string alphabet = "abc helowrd\n12.<eos>\xC3\xA9";
+    std::vector<std::string> texts = {"", "hello world", "<bos>hello<eos> world<eos>", "e\xCC\x81t\xC3\xA9"};
+    for (int i = 0; i < 120; ++i) {
+        // The longer texts put special tokens across the special token search window.
+        std::string text;
+        const size_t length = i < 100 ? rng() % 300 : 1000 + rng() % 8000;
+        for (size_t k = 0; k < length; ++k) text += alphabet[rng() % alphabet.size()];
+        texts.push_back(text);
+    }
+    for (const auto& text : texts) {
+        REQUIRE(collect(tokenizer.encodeLazy(text)) == *tokenizer.encode(text));
+        REQUIRE(tokenizer.countTokens(text) == tokenizer.encode(text)->size());
+    }
+
+    // Normalization state carries across the pieces handed over on each resume.
+    forkenizer::NormalizationOptions options;
+    options.lowercase = true;
+    options.collapseWhitespace = true;
+    tokenizer.setNormalization(options);
+    for (const auto& text : texts) {
+        REQUIRE(collect(tokenizer.encodeLazy(text)) == *tokenizer.encode(text));
+    }
+
+    forkenizer::Tokenizer unloaded;
+    REQUIRE(collect(unloaded.encodeLazy("hello")).empty());
+}
+
+TEST_CASE("Lazy encode stops early and counting does not allocate", "[lazy]") {
+    std::string dir = writeTestModel("lazy_count", {"hello", " world"});
+    forkenizer::Tokenizer tokenizer;
+    REQUIRE(tokenizer.load(dir));
+    removeTestModel(dir);
+
+    std::string text;
+    for (int i = 0; i < 20000; ++i) text += "hello world ";
+    const size_t total = tokenizer.encode(text)->size();
+    REQUIRE(tokenizer.countTokens(text, 10) == 10);
+    REQUIRE(tokenizer.countTokens(text, 0) == 0);
+    REQUIRE(tokenizer.countTokens(text, total + 5) == total);
+    REQUIRE(tokenizer.countTokens("", 3) == 0);
+
+    // Two generators interleaved on one thread keep separate state.
+    const auto firstIds = *tokenizer.encode("hello world");
+    const auto secondIds = *tokenizer.encode("world hello");
+    REQUIRE(firstIds != secondIds);
+    auto first = tokenizer.encodeLazy("hello world");
+    auto second = tokenizer.encodeLazy("world hello");
+    auto a = first.begin();
+    auto b = second.begin();
+    for (size_t i = 0; i < 2; ++i, ++a, ++b) {
+        REQUIRE(*a == firstIds[i]);
+        REQUIRE(*b == secondIds[i]);
+    }
+
+    // The generators above still hold their frames and scratch, so warm up once.
+    tokenizer.countTokens(text, 50);
+    const size_t before = allocations.load();
+    size_t counted = 0;
+    for (int i = 0; i < 100; ++i) counted += tokenizer.countTokens(text, 50);
+    REQUIRE(counted == 5000);
+    REQUIRE(allocations.load() == before);
+}
+
+TEST_CASE("Counting a prefix does not read the rest of the text", "[lazy]") {
+    std::string dir = writeTestModel("lazy_prefix", {"hello", " world"});
+    forkenizer::Tokenizer tokenizer;
+    REQUIRE(tokenizer.load(dir));
+    removeTestModel(dir);
+
+    // 64 MB of address space of which only the first 64 KB is readable: any scan past
+    // what the first tokens need faults, however large the text is.
+    const size_t reserved = size_t(64) << 20;
+    const size_t readable = size_t(64) << 10;
+    void* mapping = mmap(nullptr, reserved, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    REQUIRE(mapping != MAP_FAILED);
+    REQUIRE(mprotect(mapping, readable, PROT_READ | PROT_WRITE) == 0);
+    char* bytes = static_cast<char*>(mapping);
+    const std::string_view code = "if (a<b) { x = y; } ";
+    for (size_t i = 0; i < readable; ++i) bytes[i] = code[i % code.size()];
+
+    const std::string_view huge(bytes, reserved);
+    REQUIRE(tokenizer.countTokens(huge, 10) == 10);
+    const auto prefix = *tokenizer.encode(huge.substr(0, 100));
+    auto lazy = tokenizer.encodeLazy(huge);
+    auto it = lazy.begin();
+    for (size_t i = 0; i < 10; ++i, ++it) REQUIRE(*it == prefix[i]);
+    munmap(mapping, reserved);
+}
+
+int main() { return 0; }
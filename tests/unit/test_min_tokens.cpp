@@ -0,0 +1,72 @@
+#include "catch2_single_header.hpp"
+#include "forkenizer/Tokenizer.hpp"
+#include "test_model.hpp"
+#include <functional>
+#include <random>
+#include <string>
+#include <vector>
+
+TEST_CASE("MinTokens finds the shortest split where greedy overshoots", "[min_tokens]") {
+    std::string dir = writeTestModel("min_tokens", {"ab", "abcd", "cdef"});
+    forkenizer::Tokenizer tokenizer;
+    REQUIRE(tokenizer.load(dir));
+    removeTestModel(dir);
+
+    const uint32_t ab = *tokenizer.tokenId("ab");
+    const uint32_t abcd = *tokenizer.tokenId("abcd");
+    const uint32_t cdef = *tokenizer.tokenId("cdef");
+    REQUIRE(tokenizer.encode("abcdef")->size() == 3);
+
+    tokenizer.setEncodeMode(forkenizer::EncodeMode::MinTokens);
+    REQUIRE((*tokenizer.encode("abcdef") == std::vector<uint32_t>{ab, cdef}));
+    // Ties keep the longer first token, matching greedy.
+    REQUIRE((*tokenizer.encode("abcd") == std::vector<uint32_t>{abcd}));
+
+    auto encoding = tokenizer.encodeWithOffsets("xx abcdef");
+    REQUIRE(encoding.has_value());
+    REQUIRE(encoding->ids.back() == cdef);
+    REQUIRE(encoding->begins.back() == 5);
+    REQUIRE(encoding->ends.back() == 9);
+
+    // Costs steer the split: an expensive "cdef" loses to "abcd" + two bytes.
+    std::vector<float> costs(tokenizer.vocabSize(), 1.0f);
+    costs[cdef] = 5.0f;
+    tokenizer.setTokenCosts(costs);
+    REQUIRE((*tokenizer.encode("abcdef") == std::vector<uint32_t>{abcd, *tokenizer.tokenId("e"),
+                                                                 *tokenizer.tokenId("f")}));
+}
+
+TEST_CASE("MinTokens never beats the exhaustive minimum and never loses to greedy", "[min_tokens]") {
+    const std::vector<std::string> extra = {"a", "b", "ab", "ba", "aab", "abb", "bab", "abab", "bbbb", "aabba"};
+    std::string dir = writeTestModel("min_tokens_random", extra);
+    forkenizer::Tokenizer greedy, optimal;
+    REQUIRE(greedy.load(dir));
+    REQUIRE(optimal.load(dir));
+    removeTestModel(dir);
+    optimal.setEncodeMode(forkenizer::EncodeMode::MinTokens);
+
+    // Fewest vocab tokens covering s; every single byte is in the vocab.
+    std::function<size_t(const std::string&, size_t)> exhaustive = [&](const std::string& s, size_t pos) -> size_t {
+        if (pos == s.size()) return 0;
+        size_t best = SIZE_MAX;
+        for (size_t length = 1; pos + length <= s.size(); ++length) {
+            if (greedy.tokenId(s.substr(pos, length)).has_value()) {
+                best = std::min(best, 1 + exhaustive(s, pos + length));
+            }
+        }
+        return best;
+    };
+
+    std::mt19937 rng(23);
+    for (int i = 0; i < 300; ++i) {
+        std::string text;
+        const size_t length = 1 + rng() % 12;
+        for (size_t k = 0; k < length; ++k) text += "ab"[rng() % 2];
+        auto ids = *optimal.encode(text);
+        REQUIRE(*optimal.decode(ids) == text);
+        REQUIRE(ids.size() == exhaustive(text, 0));
+        REQUIRE(ids.size() <= greedy.encode(text)->size());
+    }
+}
+
+int main() { return 0; }
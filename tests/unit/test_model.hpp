@@ -0,0 +1,37 @@
+#pragma once
+
+#include "forkenizer/ModelIO.hpp"
+#include <filesystem>
+#include <string>
+#include <vector>
+
+// Writes a small byte-level model (reserved specials, all 256 bytes, then extraTokens)
+// into a scratch directory and returns its path.
+inline std::string writeTestModel(const std::string& name, const std::vector<std::string>& extraTokens,
+                                  bool withByteTokens = true) {
+    forkenizer::ModelData data;
+    data.vocab.set("<pad>", 0);
+    data.vocab.set("<unk>", 1);
+    data.vocab.set("<bos>", 2);
+    data.vocab.set("<eos>", 3);
+
+    uint32_t nextId = 4;
+    if (withByteTokens) {
+        for (int i = 0; i < 256; ++i) {
+            data.vocab.set(std::string(1, static_cast<char>(i)), nextId++);
+        }
+    }
+    for (const auto& token : extraTokens) {
+        if (!data.vocab.contains(token)) {
+            data.vocab.set(token, nextId++);
+        }
+    }
+
+    std::string dir = (std::filesystem::temp_directory_path() / ("forkenizer_" + name)).string();
+    forkenizer::saveModel(dir, data);
+    return dir;
+}
+
+inline void removeTestModel(const std::string& dir) {
+    std::filesystem::remove_all(dir);
+}
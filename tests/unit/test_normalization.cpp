@@ -0,0 +1,98 @@
+#include "catch2_single_header.hpp"
+#include "forkenizer/Tokenizer.hpp"
+#include "test_model.hpp"
+#include <string>
+#include <vector>
+
+namespace {
+
+std::string roundTrip(const forkenizer::Tokenizer& tokenizer, const std::string& text) {
+    auto ids = tokenizer.encode(text);
+    REQUIRE(ids.has_value());
+    auto decoded = tokenizer.decode(*ids);
+    REQUIRE(decoded.has_value());
+    return *decoded;
+}
+
+}
+
+TEST_CASE("NFC composes combining marks", "[normalization]") {
+    std::string dir = writeTestModel("norm_nfc", {"caf\xC3\xA9"});
+    forkenizer::Tokenizer tokenizer;
+    REQUIRE(tokenizer.load(dir));
+    removeTestModel(dir);
+
+    std::string decomposed = "cafe\xCC\x81";
+    REQUIRE(roundTrip(tokenizer, decomposed) == decomposed);
+
+    tokenizer.setNormalization(true);
+    auto ids = tokenizer.encode(decomposed);
+    REQUIRE(ids.has_value());
+    REQUIRE(ids->size() == 1);
+    REQUIRE(roundTrip(tokenizer, decomposed) == "caf\xC3\xA9");
+    REQUIRE(roundTrip(tokenizer, "caf\xC3\xA9") == "caf\xC3\xA9");
+
+    // Hangul jamo compose algorithmically.
+    REQUIRE(roundTrip(tokenizer, "\xE1\x84\x80\xE1\x85\xA1") == "\xEA\xB0\x80");
+}
+
+TEST_CASE("NFKC folds compatibility characters", "[normalization]") {
+    std::string dir = writeTestModel("norm_nfkc", {"file"});
+    forkenizer::Tokenizer tokenizer;
+    REQUIRE(tokenizer.load(dir));
+    removeTestModel(dir);
+
+    forkenizer::NormalizationOptions options;
+    options.form = forkenizer::NormalizationForm::NFKC;
+    tokenizer.setNormalization(options);
+    REQUIRE(roundTrip(tokenizer, "\xEF\xAC\x81le") == "file");
+    REQUIRE(roundTrip(tokenizer, "\xEF\xBC\xA1") == "A");
+
+    options.form = forkenizer::NormalizationForm::NFC;
+    tokenizer.setNormalization(options);
+    REQUIRE(roundTrip(tokenizer, "\xEF\xAC\x81le") == "\xEF\xAC\x81le");
+}
+
+TEST_CASE("Lowercasing and whitespace collapse", "[normalization]") {
+    std::string dir = writeTestModel("norm_lower", {"hello"});
+    forkenizer::Tokenizer tokenizer;
+    REQUIRE(tokenizer.load(dir));
+    removeTestModel(dir);
+
+    forkenizer::NormalizationOptions options;
+    options.lowercase = true;
+    options.collapseWhitespace = true;
+    tokenizer.setNormalization(options);
+
+    REQUIRE(roundTrip(tokenizer, "HeLLo  \t\nWORLD") == "hello world");
+    REQUIRE(roundTrip(tokenizer, "\xC3\x89T\xC3\x89") == "\xC3\xA9t\xC3\xA9");
+
+    auto encoding = tokenizer.encodeWithOffsets("HELLO");
+    REQUIRE(encoding.has_value());
+    REQUIRE(encoding->ids.size() == 1);
+    REQUIRE(encoding->begins[0] == 0);
+    REQUIRE(encoding->ends[0] == 5);
+}
+
+TEST_CASE("Normalized pieces report their source range", "[normalization]") {
+    std::string dir = writeTestModel("norm_offsets", {"x"});
+    forkenizer::Tokenizer tokenizer;
+    REQUIRE(tokenizer.load(dir));
+    removeTestModel(dir);
+    tokenizer.setNormalization(true);
+
+    std::string text = "x e\xCC\x81 \xFF";
+    auto encoding = tokenizer.encodeWithOffsets(text);
+    REQUIRE(encoding.has_value());
+    REQUIRE(encoding->ids.size() == encoding->begins.size());
+
+    // The composed e-acute is two byte tokens that both span the three source bytes.
+    REQUIRE(encoding->begins[2] == 2);
+    REQUIRE(encoding->ends[2] == 5);
+    REQUIRE(encoding->begins[3] == 2);
+    REQUIRE(encoding->ends[3] == 5);
+    REQUIRE(encoding->ends.back() == text.size());
+    REQUIRE(roundTrip(tokenizer, text) == "x \xC3\xA9 \xFF");
+}
+
+int main() { return 0; }
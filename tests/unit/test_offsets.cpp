@@ -0,0 +1,49 @@
+#include "catch2_single_header.hpp"
+#include "forkenizer/Tokenizer.hpp"
+#include "test_model.hpp"
+#include <string>
+#include <vector>
+
+TEST_CASE("Offsets cover the source text of every token", "[offsets]") {
+    std::string dir = writeTestModel("offsets", {"hello", "wor", "3.14", "<="});
+    forkenizer::Tokenizer tokenizer;
+    REQUIRE(tokenizer.load(dir));
+    removeTestModel(dir);
+
+    std::string text = "<bos>hello world, x<=3.14\x01<eos>";
+    auto encoding = tokenizer.encodeWithOffsets(text);
+    REQUIRE(encoding.has_value());
+    REQUIRE(encoding->ids.size() == encoding->begins.size());
+    REQUIRE(encoding->ids.size() == encoding->ends.size());
+
+    auto plain = tokenizer.encode(text);
+    REQUIRE(plain.has_value());
+    REQUIRE(*plain == encoding->ids);
+
+    uint32_t expectedBegin = 0;
+    for (size_t i = 0; i < encoding->ids.size(); ++i) {
+        REQUIRE(encoding->begins[i] == expectedBegin);
+        REQUIRE(encoding->ends[i] > encoding->begins[i]);
+        std::string slice = text.substr(encoding->begins[i], encoding->ends[i] - encoding->begins[i]);
+        REQUIRE(tokenizer.decode({encoding->ids[i]}) == slice);
+        expectedBegin = encoding->ends[i];
+    }
+    REQUIRE(expectedBegin == text.size());
+}
+
+TEST_CASE("Offsets of an empty text", "[offsets]") {
+    std::string dir = writeTestModel("offsets_empty", {});
+    forkenizer::Tokenizer tokenizer;
+    REQUIRE_FALSE(tokenizer.encodeWithOffsets("abc").has_value());
+    REQUIRE(tokenizer.load(dir));
+    removeTestModel(dir);
+
+    auto encoding = tokenizer.encodeWithOffsets("");
+    REQUIRE(encoding.has_value());
+    REQUIRE(encoding->ids.empty());
+    REQUIRE(encoding->begins.empty());
+}
+
+int main() {
+    return 0;
+}
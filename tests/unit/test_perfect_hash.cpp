@@ -0,0 +1,77 @@
+#include "catch2_single_header.hpp"
+#include "forkenizer/PerfectHash.hpp"
+#include "forkenizer/Vocab.hpp"
+#include <string>
+#include <vector>
+
+TEST_CASE("Perfect hash maps every key to a distinct slot", "[perfect_hash]") {
+    std::vector<std::string> storage;
+    for (uint32_t i = 0; i < 20000; ++i) {
+        storage.push_back("tok" + std::to_string(i * 7919u));
+    }
+    std::vector<std::string_view> keys(storage.begin(), storage.end());
+    std::vector<uint32_t> values;
+    for (uint32_t i = 0; i < keys.size(); ++i) {
+        values.push_back(i);
+    }
+
+    forkenizer::PerfectHash hash;
+    REQUIRE(hash.build(keys, values));
+    REQUIRE(hash.size() == keys.size());
+
+    std::vector<uint8_t> seen(keys.size(), 0);
+    for (uint32_t i = 0; i < keys.size(); ++i) {
+        auto value = hash.candidate(keys[i]);
+        REQUIRE(value.has_value());
+        REQUIRE(*value == i);
+        REQUIRE(seen[i] == 0);
+        seen[i] = 1;
+    }
+    REQUIRE(hash.memoryBytes() < keys.size() * 10);
+}
+
+TEST_CASE("Perfect hash builds for tiny key sets", "[perfect_hash]") {
+    for (uint32_t n = 1; n <= 64; ++n) {
+        std::vector<std::string> storage;
+        for (uint32_t i = 0; i < n; ++i) {
+            storage.push_back(std::string(1, static_cast<char>('a' + i % 26)) + std::to_string(i));
+        }
+        std::vector<std::string_view> keys(storage.begin(), storage.end());
+        std::vector<uint32_t> values;
+        for (uint32_t i = 0; i < n; ++i) {
+            values.push_back(i);
+        }
+
+        forkenizer::PerfectHash hash;
+        REQUIRE(hash.build(keys, values));
+        for (uint32_t i = 0; i < n; ++i) {
+            REQUIRE(hash.candidate(keys[i]) == i);
+        }
+    }
+}
+
+TEST_CASE("Sealed vocab rejects non-members", "[perfect_hash]") {
+    forkenizer::Vocab vocab;
+    vocab.set("<pad>", 0);
+    vocab.set("a", 1);
+    vocab.set("ab", 2);
+    vocab.set("abc", 3);
+    REQUIRE(vocab.seal());
+    REQUIRE(vocab.sealed());
+
+    REQUIRE(vocab.find("ab") == 2u);
+    REQUIRE_FALSE(vocab.find("abcd").has_value());
+    REQUIRE_FALSE(vocab.find("").has_value());
+    REQUIRE(vocab.size() == 4);
+
+    vocab.set("abcd", 4);
+    REQUIRE_FALSE(vocab.sealed());
+    REQUIRE(vocab.find("abcd") == 4u);
+    REQUIRE(vocab.find("a") == 1u);
+    REQUIRE(vocab.seal());
+    REQUIRE(vocab.find("abcd") == 4u);
+}
+
+int main() {
+    return 0;
+}
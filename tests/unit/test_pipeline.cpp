@@ -0,0 +1,112 @@
+#include "catch2_single_header.hpp"
+#include "forkenizer/IdCodec.hpp"
+#include "forkenizer/Tokenizer.hpp"
+#include "../../src/cli/Pipeline.hpp"
+#include "test_model.hpp"
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+TEST_CASE("JSON string fields are extracted and unescaped", "[pipeline]") {
+    std::string out;
+    REQUIRE(forkenizer::extractJsonStringField(R"({"id": 7, "text": "a\"b\\né😀"})", "text", out));
+    REQUIRE(out == "a\"b\\n\xC3\xA9\xF0\x9F\x98\x80");
+
+    out.clear();
+    REQUIRE(forkenizer::extractJsonStringField(R"({"meta": {"text": "no"}, "tags": ["x", "}"], "text": "yes"})",
+                                               "text", out));
+    REQUIRE(out == "yes");
+
+    out.clear();
+    REQUIRE_FALSE(forkenizer::extractJsonStringField(R"({"title": "x"})", "text", out));
+    REQUIRE_FALSE(forkenizer::extractJsonStringField(R"({"text": 3})", "text", out));
+    REQUIRE_FALSE(forkenizer::extractJsonStringField("not json", "text", out));
+}
+
+TEST_CASE("Pipeline output matches single encodes in input order", "[pipeline]") {
+    std::string dir = writeTestModel("pipeline", {"hello", "world", "42"});
+    forkenizer::Tokenizer tokenizer;
+    REQUIRE(tokenizer.load(dir));
+    removeTestModel(dir);
+
+    const auto base = std::filesystem::temp_directory_path() / "forkenizer_pipeline";
+    std::filesystem::create_directories(base);
+    const std::string inputPath = (base / "in.jsonl").string();
+    const std::string textPath = (base / "out.txt").string();
+    const std::string binaryPath = (base / "out.bin").string();
+
+    std::vector<std::string> texts;
+    {
+        std::ofstream in(inputPath);
+        for (int i = 0; i < 1000; ++i) {
+            texts.push_back(i % 97 == 0 ? "" : "hello world " + std::to_string(i * 42));
+            if (i % 250 == 3) {
+                in << "{\"other\": 1}\n";
+                texts.back() = "";
+            } else {
+                in << "{\"id\": " << i << ", \"text\": \"" << texts.back() << "\"}\n";
+            }
+        }
+    }
+
+    forkenizer::PipelineOptions options;
+    options.inputPath = inputPath;
+    options.outputPath = textPath;
+    options.jsonl = true;
+    options.threads = 3;
+    options.batchRecords = 7;
+    forkenizer::PipelineStats stats;
+    REQUIRE(forkenizer::runEncodePipeline(tokenizer, options, stats));
+    REQUIRE(stats.records == texts.size());
+    REQUIRE(stats.skipped == 4);
+
+    std::ifstream textOut(textPath);
+    std::string line;
+    for (const auto& text : texts) {
+        REQUIRE(std::getline(textOut, line));
+        std::ostringstream expected;
+        auto ids = *tokenizer.encode(text);
+        for (size_t k = 0; k < ids.size(); ++k) {
+            expected << (k ? " " : "") << ids[k];
+        }
+        REQUIRE(line == expected.str());
+    }
+    REQUIRE_FALSE(std::getline(textOut, line));
+
+    options.outputPath = binaryPath;
+    options.format = forkenizer::IdFormat::Binary;
+    REQUIRE(forkenizer::runEncodePipeline(tokenizer, options, stats));
+    std::ifstream binaryOut(binaryPath, std::ios::binary);
+    for (const auto& text : texts) {
+        uint32_t count = 0;
+        REQUIRE(binaryOut.read(reinterpret_cast<char*>(&count), sizeof(count)));
+        std::vector<uint32_t> ids(count);
+        binaryOut.read(reinterpret_cast<char*>(ids.data()), count * sizeof(uint32_t));
+        REQUIRE(ids == *tokenizer.encode(text));
+    }
+
+    const std::string packedPath = (base / "out.fkid").string();
+    options.outputPath = packedPath;
+    options.format = forkenizer::IdFormat::Packed;
+    REQUIRE(forkenizer::runEncodePipeline(tokenizer, options, stats));
+    std::ifstream packedOut(packedPath, std::ios::binary);
+    forkenizer::IdStreamReader reader(packedOut);
+    forkenizer::IdBlock block;
+    size_t next = 0;
+    while (reader.readBlock(block)) {
+        for (size_t d = 0; d < block.documents(); ++d, ++next) {
+            REQUIRE(next < texts.size());
+            std::vector<uint32_t> ids(block.ids.begin() + block.offsets[d], block.ids.begin() + block.offsets[d + 1]);
+            REQUIRE(ids == *tokenizer.encode(texts[next]));
+        }
+    }
+    REQUIRE(reader.error().empty());
+    REQUIRE(next == texts.size());
+
+    std::filesystem::remove_all(base);
+}
+
+int main() { return 0; }
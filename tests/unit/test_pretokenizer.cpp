@@ -53,6 +53,27 @@ TEST_CASE("PreTokenizer punctuation", "[pretokenizer]") {
     REQUIRE(tokens.size() >= 4);
 }
 
+TEST_CASE("PreTokenizer groups non-ASCII words", "[pretokenizer]") {
+    forkenizer::PreTokenizer preTokenizer;
+
+    auto tokens = preTokenizer.preTokenize("\xD0\xBF\xD1\x80\xD0\xB8\xD0\xB2\xD0\xB5\xD1\x82 caf\xC3\xA9");
+    REQUIRE(tokens.size() == 3);
+    REQUIRE(tokens[0] == "\xD0\xBF\xD1\x80\xD0\xB8\xD0\xB2\xD0\xB5\xD1\x82");
+    REQUIRE(tokens[2] == "caf\xC3\xA9");
+
+    // CJK ideographs are letters; the ideographic comma is punctuation.
+    tokens = preTokenizer.preTokenize("\xE4\xB8\xAD\xE6\x96\x87\xE3\x80\x81x");
+    REQUIRE(tokens.size() == 3);
+    REQUIRE(tokens[0] == "\xE4\xB8\xAD\xE6\x96\x87");
+    REQUIRE(tokens[1] == "\xE3\x80\x81");
+
+    // Arabic-Indic digits group; invalid bytes stay single.
+    tokens = preTokenizer.preTokenize("\xD9\xA1\xD9\xA2\xFF\xFE");
+    REQUIRE(tokens.size() == 3);
+    REQUIRE(tokens[0] == "\xD9\xA1\xD9\xA2");
+    REQUIRE(tokens[1] == "\xFF");
+}
+
 int main() {
     return 0;
 }
@@ -0,0 +1,78 @@
+#include "catch2_single_header.hpp"
+#include "forkenizer/PreTokenizer.hpp"
+#include "forkenizer/Tokenizer.hpp"
+#include "test_model.hpp"
+#include <string>
+#include <vector>
+
+using Pieces = std::vector<std::string>;
+
+static Pieces split(const std::string& preset, const std::string& text) {
+    auto preTokenizer = forkenizer::PreTokenizer::fromPreset(preset);
+    REQUIRE(preTokenizer.has_value());
+    return preTokenizer->preTokenize(text);
+}
+
+TEST_CASE("Default preset matches the built-in rules", "[pretokenizer_rules]") {
+    forkenizer::PreTokenizer builtIn;
+    std::string text = "x<=-3.5e+2 foo.bar->y (1)";
+    REQUIRE(split("default", text) == builtIn.preTokenize(text));
+    REQUIRE(builtIn.preTokenize(text) ==
+            (Pieces{"x", "<=", "-3.5e+2", " ", "foo.bar", "->", "y", " ", "(", "1", ")"}));
+    REQUIRE(builtIn.spec().empty());
+}
+
+TEST_CASE("Digit presets split numbers", "[pretokenizer_rules]") {
+    REQUIRE(split("digits", "ab1234") == (Pieces{"ab", "1", "2", "3", "4"}));
+    REQUIRE(split("digits3", "1234567") == (Pieces{"123", "456", "7"}));
+}
+
+TEST_CASE("GPT-2 preset attaches leading spaces", "[pretokenizer_rules]") {
+    REQUIRE(split("gpt2", "Hello world, it's 42!") ==
+            (Pieces{"Hello", " world", ",", " it", "'s", " 42", "!"}));
+}
+
+TEST_CASE("Code preset keeps multi-character operators", "[pretokenizer_rules]") {
+    REQUIRE(split("code", "a<<=0x1F;\n  b->c") ==
+            (Pieces{"a", "<<=", "0x1F", ";", "\n", "  ", "b", "->", "c"}));
+}
+
+TEST_CASE("Rule specs compile or fail cleanly", "[pretokenizer_rules]") {
+    auto custom = forkenizer::PreTokenizer::fromSpec(
+        "# letters, then anything\n"
+        "upper  [A-Z]+\n"
+        "any    .\n");
+    REQUIRE(custom.has_value());
+    REQUIRE(custom->preTokenize("ABc") == (Pieces{"AB", "c"}));
+
+    auto extended = forkenizer::PreTokenizer::fromSpec("hex  0x[0-9a-f]+\npreset default\n");
+    REQUIRE(extended.has_value());
+    REQUIRE(extended->preTokenize("0xff 3") == (Pieces{"0xff", " ", "3"}));
+
+    REQUIRE_FALSE(forkenizer::PreTokenizer::fromPreset("nope").has_value());
+    REQUIRE_FALSE(forkenizer::PreTokenizer::fromSpec("").has_value());
+    REQUIRE_FALSE(forkenizer::PreTokenizer::fromSpec("bad  (ab\n").has_value());
+    REQUIRE_FALSE(forkenizer::PreTokenizer::fromSpec("bad  [z-a]\n").has_value());
+    REQUIRE_FALSE(forkenizer::PreTokenizer::fromSpec("bad  \\p{Q}\n").has_value());
+    REQUIRE_FALSE(forkenizer::PreTokenizer::fromSpec("noPattern\n").has_value());
+}
+
+TEST_CASE("Rules are saved with the model", "[pretokenizer_rules]") {
+    std::string dir = writeTestModel("rules", {"234"});
+    forkenizer::Tokenizer tokenizer;
+    REQUIRE(tokenizer.load(dir));
+    REQUIRE(tokenizer.encode("1234")->size() == 2);
+
+    auto digits = forkenizer::PreTokenizer::fromPreset("digits3");
+    REQUIRE(digits.has_value());
+    tokenizer.setPreTokenizer(*digits);
+    REQUIRE(tokenizer.encode("1234")->size() == 4);
+    REQUIRE(tokenizer.save(dir));
+
+    forkenizer::Tokenizer reloaded;
+    REQUIRE(reloaded.load(dir));
+    REQUIRE(reloaded.encode("1234")->size() == 4);
+    removeTestModel(dir);
+}
+
+int main() { return 0; }
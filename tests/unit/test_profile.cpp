@@ -0,0 +1,92 @@
+#include "catch2_single_header.hpp"
+#include "forkenizer/Tokenizer.hpp"
+#include "../../src/cli/Profile.hpp"
+#include "test_model.hpp"
+#include <filesystem>
+#include <fstream>
+#include <string>
+
+namespace {
+
+std::string writeCorpus(const std::string& name, const std::string& contents) {
+    std::string path = (std::filesystem::temp_directory_path() / ("forkenizer_profile_" + name)).string();
+    std::ofstream(path, std::ios::binary) << contents;
+    return path;
+}
+
+bool contains(const std::string& json, const std::string& part) {
+    return json.find(part) != std::string::npos;
+}
+
+}
+
+TEST_CASE("Corpus profile reports compression, fallback, hot tokens and cache hits", "[profile]") {
+    std::string dir = writeTestModel("profile", {"hello", "world"});
+    forkenizer::Tokenizer tokenizer;
+    REQUIRE(tokenizer.load(dir));
+    removeTestModel(dir);
+    const std::string hello = std::to_string(*tokenizer.tokenId("hello"));
+
+    // Pieces in order: hello, " ", world | hello | 12, " ", the euro sign's three bytes.
+    forkenizer::ProfileOptions options;
+    options.inputs = {writeCorpus("prose", "hello world\nhello\n\n"), writeCorpus("numbers", "12 \xE2\x82\xAC")};
+    options.topTokens = 3;
+    options.cacheSizes = {1, 64};
+    options.threads = 2;
+
+    std::string json, error;
+    REQUIRE(forkenizer::profileCorpus(tokenizer, options, json, error));
+    REQUIRE(contains(json, "\"corpus\": {\"documents\": 3, \"pieces\": 7, \"bytes\": 22, \"tokens\": 10"));
+    REQUIRE(contains(json, "\"documents\": 2, \"pieces\": 4, \"bytes\": 16, \"tokens\": 4, \"bytes_per_token\": 4}"));
+    REQUIRE(contains(json, "\"non_ascii\": {\"pieces\": 1, \"bytes\": 3, \"tokens\": 3,"));
+    REQUIRE(contains(json, "\"byte_fallback\": {\"tokens\": 0, \"token_rate\": 0, \"bytes\": 0, \"byte_rate\": 0, "
+                           "\"partial_character_tokens\": 3}"));
+    REQUIRE(contains(json, "{\"id\": " + hello + ", \"token\": \"hello\", \"count\": 2, \"share\": 0.2}"));
+    REQUIRE(contains(json, "\"unused_tokens\": {\"count\": 254,"));
+    REQUIRE(contains(json, "\"token_lengths\": {\"mean\": 2.2, \"counts\": {\"1\": 7, \"5\": 3}}"));
+    REQUIRE(contains(json, "\"trie_depths\": {\"mean\": 2.2, \"counts\": {\"1\": 7, \"5\": 3}}"));
+    REQUIRE(contains(json, "\"lookups\": 7, \"distinct_pieces\": 5"));
+    REQUIRE(contains(json, "{\"entries\": 1, \"hit_rate\": 0}"));
+    REQUIRE(contains(json, "{\"entries\": 64, \"hit_rate\": 0.285714}"));
+
+    options.inputs.push_back(options.inputs[0] + ".missing");
+    REQUIRE_FALSE(forkenizer::profileCorpus(tokenizer, options, json, error));
+    REQUIRE(contains(error, ".missing"));
+    for (size_t i = 0; i + 1 < options.inputs.size(); ++i) std::filesystem::remove(options.inputs[i]);
+
+    // Without byte tokens the trie has nothing for "x", so the rest of that piece falls
+    // back to <unk>.
+    std::string bytelessDir = writeTestModel("profile_byteless", {"hello", " "}, false);
+    forkenizer::Tokenizer byteless;
+    REQUIRE(byteless.load(bytelessDir));
+    removeTestModel(bytelessDir);
+    options.inputs = {writeCorpus("byteless", "hello xy")};
+    REQUIRE(forkenizer::profileCorpus(byteless, options, json, error));
+    std::filesystem::remove(options.inputs[0]);
+    REQUIRE(contains(json, "\"byte_fallback\": {\"tokens\": 2, \"token_rate\": 0.5, \"bytes\": 2, "
+                           "\"byte_rate\": 0.25,"));
+    REQUIRE(contains(json, "\"trie_depths\": {\"mean\": 1.5, \"counts\": {\"0\": 2, \"1\": 1, \"5\": 1}}"));
+
+    // Ids with gaps: tables are sized by the largest id, not the token count.
+    forkenizer::ModelData sparse;
+    for (int i = 0; i < 256; ++i) sparse.vocab.set(std::string(1, static_cast<char>(i)), static_cast<uint32_t>(i));
+    sparse.vocab.set("hello", 5000);
+    std::string sparseDir = (std::filesystem::temp_directory_path() / "forkenizer_profile_sparse").string();
+    REQUIRE(forkenizer::saveModel(sparseDir, sparse));
+    forkenizer::Tokenizer sparseTokenizer;
+    REQUIRE(sparseTokenizer.load(sparseDir));
+    removeTestModel(sparseDir);
+    REQUIRE(sparseTokenizer.idCount() == 5001);
+    options.inputs = {writeCorpus("sparse", "hello hello\n")};
+    REQUIRE(forkenizer::profileCorpus(sparseTokenizer, options, json, error));
+    std::filesystem::remove(options.inputs[0]);
+    REQUIRE(contains(json, "{\"id\": 5000, \"token\": \"hello\", \"count\": 2, \"share\": 0.666667}"));
+    REQUIRE(contains(json, "\"partial_character_tokens\": 0}"));
+    REQUIRE(contains(json, "\"unused_tokens\": {\"count\": 255,"));
+    REQUIRE(contains(json, "\"trie_depths\": {\"mean\": 3.66667, \"counts\": {\"1\": 1, \"5\": 2}}"));
+
+    forkenizer::Tokenizer unloaded;
+    REQUIRE_FALSE(forkenizer::profileCorpus(unloaded, options, json, error));
+}
+
+int main() { return 0; }
@@ -0,0 +1,188 @@
+#include "catch2_single_header.hpp"
+#include "forkenizer/Tokenizer.hpp"
+#include "../../src/cli/Shard.hpp"
+#include "test_model.hpp"
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace {
+
+std::string readFile(const std::filesystem::path& path) {
+    std::ifstream in(path, std::ios::binary);
+    std::stringstream buffer;
+    buffer << in.rdbuf();
+    return buffer.str();
+}
+
+template <typename T>
+std::vector<T> readArray(const std::filesystem::path& path) {
+    std::string bytes = readFile(path);
+    std::vector<T> values(bytes.size() / sizeof(T));
+    std::memcpy(values.data(), bytes.data(), values.size() * sizeof(T));
+    return values;
+}
+
+// Concatenates every shard's documents, checking each index against its shard.
+std::vector<std::vector<uint16_t>> readDocuments(const std::filesystem::path& dir, size_t shards) {
+    std::vector<std::vector<uint16_t>> documents;
+    for (size_t s = 0; s < shards; ++s) {
+        char name[32];
+        std::snprintf(name, sizeof(name), "shard_%05zu", s);
+        auto tokens = readArray<uint16_t>(dir / (std::string(name) + ".bin"));
+        auto index = readArray<uint64_t>(dir / (std::string(name) + ".idx"));
+        REQUIRE(index.size() >= 2);
+        REQUIRE(index.front() == 0);
+        REQUIRE(index.back() == tokens.size());
+        for (size_t d = 0; d + 1 < index.size(); ++d) {
+            documents.emplace_back(tokens.begin() + index[d], tokens.begin() + index[d + 1]);
+        }
+    }
+    return documents;
+}
+
+}
+
+TEST_CASE("Shards hold every document once, eos-terminated and in order", "[shard]") {
+    std::string modelDir = writeTestModel("shard", {"hello", "world"});
+    forkenizer::Tokenizer tokenizer;
+    REQUIRE(tokenizer.load(modelDir));
+    removeTestModel(modelDir);
+
+    const auto base = std::filesystem::temp_directory_path() / "forkenizer_shard";
+    std::filesystem::remove_all(base);
+    std::filesystem::create_directories(base / "corpus" / "nested");
+    const char* files[] = {"corpus/a.txt", "corpus/nested/b.txt", "corpus/c.txt"};
+    for (int f = 0; f < 3; ++f) {
+        std::ofstream out(base / files[f]);
+        for (int i = 0; i < 40; ++i) {
+            out << (i % 13 == 5 ? "" : "hello world " + std::to_string(f * 1000 + i)) << "\n";
+        }
+    }
+    // Directory walks are sorted, so a.txt, c.txt, nested/b.txt; empty lines are dropped.
+    std::vector<std::string> ordered;
+    for (const char* name : {"corpus/a.txt", "corpus/c.txt", "corpus/nested/b.txt"}) {
+        std::ifstream in(base / name);
+        std::string line;
+        while (std::getline(in, line)) {
+            if (!line.empty()) ordered.push_back(line);
+        }
+    }
+
+    forkenizer::ShardOptions options;
+    options.inputs = {(base / "corpus").string()};
+    options.documents = forkenizer::ShardDocuments::Line;
+    options.shardBytes = 64;
+    options.threads = 3;
+    options.batchBytes = 100;
+
+    SECTION("single run") {
+        options.outputDir = (base / "full").string();
+        forkenizer::ShardStats stats;
+        std::string error;
+        REQUIRE(forkenizer::runShard(tokenizer, options, stats, error));
+        REQUIRE(stats.complete);
+        REQUIRE(stats.documents == ordered.size());
+        REQUIRE(stats.shards > 3);
+
+        auto documents = readDocuments(options.outputDir, stats.shards);
+        REQUIRE(documents.size() == ordered.size());
+        uint64_t tokens = 0;
+        for (size_t d = 0; d < documents.size(); ++d) {
+            auto expected = tokenizer.encode(ordered[d]);
+            REQUIRE(expected.has_value());
+            expected->push_back(*tokenizer.tokenId("<eos>"));
+            REQUIRE(std::vector<uint32_t>(documents[d].begin(), documents[d].end()) == *expected);
+            tokens += documents[d].size();
+        }
+        REQUIRE(tokens == stats.tokens);
+        REQUIRE(std::filesystem::file_size(std::filesystem::path(options.outputDir) / "shard_00000.bin") <= 64);
+    }
+
+    SECTION("interrupted runs resume to the same bytes") {
+        options.outputDir = (base / "full").string();
+        forkenizer::ShardStats full;
+        std::string error;
+        REQUIRE(forkenizer::runShard(tokenizer, options, full, error));
+
+        options.outputDir = (base / "resumed").string();
+        options.maxShards = 2;
+        forkenizer::ShardStats partial;
+        REQUIRE(forkenizer::runShard(tokenizer, options, partial, error));
+        REQUIRE_FALSE(partial.complete);
+        REQUIRE(partial.shards == 2);
+        // A shard left behind by a crash past the manifest is discarded.
+        std::ofstream(base / "resumed" / "shard_00002.bin") << "partial";
+
+        options.maxShards = 0;
+        forkenizer::ShardStats resumed;
+        REQUIRE(forkenizer::runShard(tokenizer, options, resumed, error));
+        REQUIRE(resumed.resumed);
+        REQUIRE(resumed.complete);
+        REQUIRE(resumed.shards == full.shards);
+        REQUIRE(resumed.tokens == full.tokens);
+        REQUIRE(readFile(base / "full" / "manifest.json") == readFile(base / "resumed" / "manifest.json"));
+        for (size_t s = 0; s < full.shards; ++s) {
+            char name[32];
+            std::snprintf(name, sizeof(name), "shard_%05zu", s);
+            for (const char* extension : {".bin", ".idx"}) {
+                const std::string file = std::string(name) + extension;
+                REQUIRE(readFile(base / "full" / file) == readFile(base / "resumed" / file));
+            }
+        }
+
+        options.shardBytes = 128;
+        REQUIRE_FALSE(forkenizer::runShard(tokenizer, options, resumed, error));
+        options.shardBytes = 64;
+        REQUIRE(forkenizer::runShard(tokenizer, options, resumed, error));
+
+        // A retrained model with the same <eos> id and dtype would still mix token ids.
+        std::string otherDir = writeTestModel("shard_other", {"hello", "worl"});
+        forkenizer::Tokenizer other;
+        REQUIRE(other.load(otherDir));
+        removeTestModel(otherDir);
+        REQUIRE(other.tokenId("<eos>") == tokenizer.tokenId("<eos>"));
+        REQUIRE(other.fingerprint() != tokenizer.fingerprint());
+        REQUIRE_FALSE(forkenizer::runShard(other, options, resumed, error));
+        REQUIRE(error.find("different model") != std::string::npos);
+
+        std::ofstream(base / "corpus" / "a.txt", std::ios::app) << "hello again\n";
+        REQUIRE_FALSE(forkenizer::runShard(tokenizer, options, resumed, error));
+        REQUIRE(error.find("inputs changed") != std::string::npos);
+    }
+
+    std::filesystem::remove_all(base);
+}
+
+TEST_CASE("Whole files become single documents", "[shard]") {
+    std::string modelDir = writeTestModel("shard_files", {"hello"});
+    forkenizer::Tokenizer tokenizer;
+    REQUIRE(tokenizer.load(modelDir));
+    removeTestModel(modelDir);
+
+    const auto base = std::filesystem::temp_directory_path() / "forkenizer_shard_files";
+    std::filesystem::remove_all(base);
+    std::filesystem::create_directories(base);
+    std::ofstream(base / "one.txt") << "hello\nhello";
+    std::ofstream(base / "two.txt") << "x";
+
+    forkenizer::ShardOptions options;
+    options.inputs = {(base / "one.txt").string(), (base / "two.txt").string()};
+    options.outputDir = (base / "out").string();
+    options.appendEos = false;
+    forkenizer::ShardStats stats;
+    std::string error;
+    REQUIRE(forkenizer::runShard(tokenizer, options, stats, error));
+    REQUIRE(stats.shards == 1);
+    REQUIRE(stats.documents == 2);
+
+    auto index = readArray<uint64_t>(base / "out" / "shard_00000.idx");
+    REQUIRE((index == std::vector<uint64_t>{0, 3, 4}));
+    std::filesystem::remove_all(base);
+}
+
+int main() { return 0; }
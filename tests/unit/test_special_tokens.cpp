@@ -0,0 +1,72 @@
+#include "catch2_single_header.hpp"
+#include "forkenizer/Tokenizer.hpp"
+#include "test_model.hpp"
+#include <string>
+#include <vector>
+
+TEST_CASE("Special tokens are matched atomically", "[special_tokens]") {
+    std::string dir = writeTestModel("special_tokens", {"hello", "eos"});
+    forkenizer::Tokenizer tokenizer;
+    REQUIRE(tokenizer.load(dir));
+    removeTestModel(dir);
+
+    auto tokens = tokenizer.encode("<bos>hello<eos>");
+    REQUIRE(tokens.has_value());
+    REQUIRE(tokens->size() == 3);
+    REQUIRE((*tokens)[0] == 2);
+    REQUIRE((*tokens)[2] == 3);
+
+    auto decoded = tokenizer.decode(*tokens);
+    REQUIRE(decoded == std::string("<bos>hello<eos>"));
+
+    tokens = tokenizer.encode("<eos><eos>");
+    REQUIRE(tokens->size() == 2);
+    REQUIRE((*tokens)[0] == 3);
+    REQUIRE((*tokens)[1] == 3);
+
+    tokens = tokenizer.encode("a < b <eo");
+    for (uint32_t id : *tokens) {
+        REQUIRE(id > 3);
+    }
+}
+
+TEST_CASE("Special token matching can be disabled", "[special_tokens]") {
+    std::string dir = writeTestModel("special_tokens_off", {"hello", "eos"});
+    forkenizer::Tokenizer tokenizer;
+    REQUIRE(tokenizer.load(dir));
+    removeTestModel(dir);
+
+    tokenizer.setSpecialTokens(false);
+    auto tokens = tokenizer.encode("<eos>");
+    REQUIRE(tokens->size() == 3);
+    REQUIRE(tokenizer.decode(*tokens) == std::string("<eos>"));
+}
+
+TEST_CASE("Custom special tokens", "[special_tokens]") {
+    std::string dir = writeTestModel("special_tokens_custom", {"<|im_start|>", "user"});
+    forkenizer::Tokenizer tokenizer;
+    REQUIRE(tokenizer.load(dir));
+    removeTestModel(dir);
+
+    REQUIRE_FALSE(tokenizer.addSpecialToken("<|not_in_vocab|>"));
+    REQUIRE(tokenizer.addSpecialToken("<|im_start|>"));
+
+    auto tokens = tokenizer.encode("<|im_start|>user");
+    REQUIRE(tokens->size() == 2);
+    REQUIRE(tokenizer.decode(*tokens) == std::string("<|im_start|>user"));
+}
+
+TEST_CASE("Unknown bytes fall back to <unk>", "[special_tokens]") {
+    std::string dir = writeTestModel("special_tokens_unk", {"ab"}, false);
+    forkenizer::Tokenizer tokenizer;
+    REQUIRE(tokenizer.load(dir));
+    removeTestModel(dir);
+
+    auto tokens = tokenizer.encode("ab\x01");
+    REQUIRE(tokens->size() == 2);
+    REQUIRE((*tokens)[1] == 1);
+}
+
+int main() {
+    return 0;
+}
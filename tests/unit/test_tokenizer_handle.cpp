@@ -0,0 +1,83 @@
+#include "catch2_single_header.hpp"
+#include "forkenizer/TokenizerHandle.hpp"
+#include "test_model.hpp"
+#include <atomic>
+#include <string>
+#include <thread>
+#include <vector>
+
+TEST_CASE("Handle serves nothing until a model is published", "[tokenizer_handle]") {
+    forkenizer::TokenizerHandle handle;
+    REQUIRE(handle.version() == 0);
+    REQUIRE(handle.snapshot() == nullptr);
+    REQUIRE_FALSE(handle.encode("abc").has_value());
+    REQUIRE_FALSE(handle.load("/nonexistent/model"));
+    REQUIRE(handle.version() == 0);
+}
+
+TEST_CASE("Snapshots outlive the swap that replaced them", "[tokenizer_handle]") {
+    std::string dirA = writeTestModel("handle_a", {"hello"});
+    std::string dirB = writeTestModel("handle_b", {});
+    forkenizer::TokenizerHandle handle;
+    REQUIRE(handle.load(dirA));
+    REQUIRE(handle.version() == 1);
+
+    auto pinned = handle.snapshot();
+    REQUIRE(handle.loadAsync(dirB).get());
+    REQUIRE(handle.version() == 2);
+    REQUIRE(handle.reclaim() == 0);
+
+    REQUIRE(pinned->encode("hello")->size() == 1);
+    REQUIRE(handle.encode("hello")->size() == 5);
+    REQUIRE_FALSE(handle.load("/nonexistent/model"));
+    REQUIRE(handle.version() == 2);
+
+    removeTestModel(dirA);
+    removeTestModel(dirB);
+}
+
+TEST_CASE("Readers keep encoding while models are swapped", "[tokenizer_handle]") {
+    std::string dirA = writeTestModel("handle_swap_a", {"hello", "world"});
+    std::string dirB = writeTestModel("handle_swap_b", {});
+    forkenizer::TokenizerHandle handle;
+    REQUIRE(handle.load(dirA));
+
+    auto modelA = std::make_shared<forkenizer::Tokenizer>();
+    auto modelB = std::make_shared<forkenizer::Tokenizer>();
+    REQUIRE(modelA->load(dirA));
+    REQUIRE(modelB->load(dirB));
+    removeTestModel(dirA);
+    removeTestModel(dirB);
+
+    const std::string text = "hello world";
+    const auto idsA = *modelA->encode(text);
+    const auto idsB = *modelB->encode(text);
+
+    std::atomic<bool> stop{false};
+    std::atomic<size_t> bad{0};
+    std::vector<std::thread> readers;
+    for (int t = 0; t < 4; ++t) {
+        readers.emplace_back([&] {
+            while (!stop.load(std::memory_order_relaxed)) {
+                auto ids = handle.encode(text);
+                if (!ids.has_value() || (*ids != idsA && *ids != idsB)) {
+                    bad.fetch_add(1);
+                }
+            }
+        });
+    }
+
+    for (int i = 0; i < 200; ++i) {
+        handle.publish(i % 2 == 0 ? modelB : modelA);
+    }
+    stop.store(true);
+    for (auto& reader : readers) {
+        reader.join();
+    }
+
+    REQUIRE(bad.load() == 0);
+    REQUIRE(handle.version() == 201);
+    REQUIRE(handle.reclaim() == 0);
+}
+
+int main() { return 0; }
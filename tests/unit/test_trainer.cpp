@@ -0,0 +1,141 @@
+#include "catch2_single_header.hpp"
+#include "forkenizer/ModelIO.hpp"
+#include "forkenizer/PreTokenizer.hpp"
+#include "../../src/trainer/Trainer.hpp"
+#include <filesystem>
+#include <fstream>
+#include <map>
+#include <random>
+#include <set>
+#include <string>
+#include <vector>
+
+namespace {
+
+using Merge = std::pair<std::string, std::string>;
+
+// Straightforward BPE: recount every pair, merge the most frequent (smallest pair on
+// ties) at every non-overlapping occurrence, left to right.
+std::vector<Merge> referenceMerges(const std::vector<std::string>& lines, uint32_t numMerges) {
+    forkenizer::PreTokenizer preTokenizer;
+    std::map<std::string, uint64_t> counts;
+    for (const auto& line : lines) {
+        for (const auto& piece : preTokenizer.preTokenize(line)) {
+            ++counts[piece];
+        }
+    }
+    std::vector<std::pair<std::vector<std::string>, uint64_t>> words;
+    for (const auto& [word, count] : counts) {
+        std::vector<std::string> symbols;
+        for (char c : word) symbols.emplace_back(1, c);
+        words.emplace_back(symbols, count);
+    }
+
+    std::vector<Merge> merges;
+    while (merges.size() < numMerges) {
+        std::map<Merge, uint64_t> pairs;
+        for (const auto& [symbols, count] : words) {
+            for (size_t i = 0; i + 1 < symbols.size(); ++i) {
+                pairs[{symbols[i], symbols[i + 1]}] += count;
+            }
+        }
+        auto best = pairs.end();
+        for (auto it = pairs.begin(); it != pairs.end(); ++it) {
+            if (best == pairs.end() || it->second > best->second) best = it;
+        }
+        if (best == pairs.end() || best->second < 2) break;
+        const Merge merge = best->first;
+        merges.push_back(merge);
+        for (auto& [symbols, count] : words) {
+            std::vector<std::string> merged;
+            for (size_t i = 0; i < symbols.size(); ++i) {
+                if (i + 1 < symbols.size() && symbols[i] == merge.first && symbols[i + 1] == merge.second) {
+                    merged.push_back(merge.first + merge.second);
+                    ++i;
+                } else {
+                    merged.push_back(symbols[i]);
+                }
+            }
+            symbols = std::move(merged);
+        }
+    }
+    return merges;
+}
+
+std::vector<Merge> trainMerges(const std::vector<std::string>& lines, uint32_t numMerges, uint32_t mergeBatch = 1) {
+    const auto base = std::filesystem::temp_directory_path() / "forkenizer_trainer";
+    std::filesystem::remove_all(base);
+    std::filesystem::create_directories(base);
+    {
+        std::ofstream corpus(base / "corpus.txt");
+        for (const auto& line : lines) corpus << line << "\n";
+    }
+    forkenizer::Trainer trainer;
+    trainer.setMergeBatch(mergeBatch);
+    trainer.setNumThreads(3);
+    REQUIRE(trainer.train({(base / "corpus.txt").string()}, (base / "model").string(), 100000, numMerges));
+    forkenizer::ModelData data;
+    REQUIRE(forkenizer::loadModel((base / "model").string(), data));
+    std::filesystem::remove_all(base);
+    return data.merges;
+}
+
+std::vector<std::string> randomLines(unsigned seed) {
+    std::mt19937 rng(seed);
+    const std::string alphabet = "aabbbcde ";
+    std::vector<std::string> lines;
+    for (int i = 0; i < 300; ++i) {
+        std::string line;
+        const size_t length = 1 + rng() % 40;
+        for (size_t k = 0; k < length; ++k) line += alphabet[rng() % alphabet.size()];
+        lines.push_back(line);
+    }
+    return lines;
+}
+
+}
+
+TEST_CASE("Overlapping runs merge left to right with exact counts", "[trainer]") {
+    std::vector<std::string> lines = {"aaaa aaa aaaaa", "aaaa aaa", "baaab aab"};
+    REQUIRE(trainMerges(lines, 10) == referenceMerges(lines, 10));
+
+    // Every occurrence on a line counts, not just the first.
+    auto merges = trainMerges({"xy xy xy xy"}, 1);
+    REQUIRE(merges.size() == 1);
+    REQUIRE((merges[0] == Merge{"x", "y"}));
+}
+
+TEST_CASE("Indexed merges match a full recount on random text", "[trainer]") {
+    auto lines = randomLines(7);
+    REQUIRE(trainMerges(lines, 200) == referenceMerges(lines, 200));
+}
+
+TEST_CASE("Batched merges stay valid and close to exact training", "[trainer]") {
+    auto lines = randomLines(11);
+    const auto exact = referenceMerges(lines, 150);
+    const auto batched = trainMerges(lines, 150, 8);
+    REQUIRE(batched.size() == exact.size());
+
+    // Every merge joins tokens that already exist: bytes or earlier merges.
+    std::set<std::string> known;
+    for (const auto& [left, right] : batched) {
+        REQUIRE((left.size() == 1 || known.count(left)));
+        REQUIRE((right.size() == 1 || known.count(right)));
+        known.insert(left + right);
+    }
+
+    // The first round is the top pairs that share no symbol, so the most frequent
+    // pair always leads.
+    REQUIRE(batched[0] == exact[0]);
+    const auto divergence = forkenizer::compareMerges(exact, batched);
+    REQUIRE(divergence.commonPrefix >= 1);
+    REQUIRE(divergence.sharedTokens > exact.size() / 2);
+    REQUIRE(forkenizer::compareMerges(exact, exact).commonPrefix == exact.size());
+    REQUIRE(forkenizer::compareMerges(exact, exact).meanRankShift == 0.0);
+
+    // Overlapping runs inside a batch still merge left to right.
+    std::vector<std::string> runs = {"aaaa aaa aaaaa", "aaaa aaa", "baaab aab"};
+    REQUIRE(trainMerges(runs, 10, 4) == referenceMerges(runs, 10));
+}
+
+int main() { return 0; }
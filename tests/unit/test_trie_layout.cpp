@@ -0,0 +1,75 @@
+#include "catch2_single_header.hpp"
+#include "forkenizer/Tokenizer.hpp"
+#include "test_model.hpp"
+#include <filesystem>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace {
+
+const std::vector<std::string> kTokens = {"a", "ab", "abc", "abcd", "b", "bc", "bcd", "hello", "hell", "he",
+                                          "world", "wor", " the", "the", "th", "123", "12", "ing", "in"};
+
+std::string randomText(std::mt19937& rng, size_t length) {
+    static const std::string alphabet = "abcdhelowrtgn123 \n.";
+    std::string text;
+    for (size_t i = 0; i < length; ++i) {
+        text += alphabet[rng() % alphabet.size()];
+    }
+    return text;
+}
+
+}
+
+TEST_CASE("Optimized trie layout keeps encodes identical", "[trie]") {
+    std::string dir = writeTestModel("trie_layout", kTokens);
+    forkenizer::Tokenizer tokenizer;
+    REQUIRE(tokenizer.load(dir));
+
+    std::mt19937 rng(42);
+    std::vector<std::string> texts;
+    for (int i = 0; i < 200; ++i) {
+        texts.push_back(randomText(rng, 1 + rng() % 120));
+    }
+    texts.push_back("hello world, the thing 12345");
+    std::vector<std::vector<uint32_t>> before;
+    for (const auto& text : texts) {
+        before.push_back(*tokenizer.encode(text));
+    }
+
+    std::vector<std::string_view> samples = {"the hello the hello world", "abcd abcd abc bcd"};
+    forkenizer::TrieLayoutStats stats;
+    REQUIRE(tokenizer.optimizeTrieLayout(samples, &stats));
+    REQUIRE(stats.nodes > kTokens.size());
+    REQUIRE(stats.visits > 0);
+    REQUIRE(stats.hotNodes > 0);
+    REQUIRE(stats.hotNodes < stats.nodes);
+    for (size_t i = 0; i < texts.size(); ++i) {
+        REQUIRE(*tokenizer.encode(texts[i]) == before[i]);
+    }
+
+    const std::string saved = dir + "_optimized";
+    REQUIRE(tokenizer.save(saved));
+    REQUIRE(std::filesystem::exists(saved + "/trie.profile"));
+    forkenizer::Tokenizer reloaded;
+    REQUIRE(reloaded.load(saved));
+    for (size_t i = 0; i < texts.size(); ++i) {
+        REQUIRE(*reloaded.encode(texts[i]) == before[i]);
+    }
+
+    // A profile recorded for another vocab is ignored rather than misapplied.
+    std::string otherDir = writeTestModel("trie_layout_other", {"x", "xy", "xyz"});
+    std::filesystem::copy_file(saved + "/trie.profile", otherDir + "/trie.profile");
+    forkenizer::Tokenizer other;
+    REQUIRE(other.load(otherDir));
+    REQUIRE(other.encode("xyz")->size() == 1);
+    REQUIRE(other.save(otherDir));
+    REQUIRE_FALSE(std::filesystem::exists(otherDir + "/trie.profile"));
+
+    removeTestModel(dir);
+    removeTestModel(saved);
+    removeTestModel(otherDir);
+}
+
+int main() { return 0; }
@@ -0,0 +1,76 @@
+#include "catch2_single_header.hpp"
+#include "forkenizer/Vocab.hpp"
+#include "forkenizer/ModelIO.hpp"
+#include <cstdio>
+#include <string>
+#include <vector>
+
+TEST_CASE("Vocab lookup in both directions", "[vocab]") {
+    forkenizer::Vocab vocab;
+    vocab.set("<pad>", 0);
+    vocab.set("hello", 1);
+    vocab.set("world", 2);
+
+    REQUIRE(vocab.size() == 3);
+    REQUIRE(vocab.find("hello") == 1u);
+    REQUIRE(vocab.find(std::string("world")) == 2u);
+    REQUIRE_FALSE(vocab.find("missing").has_value());
+    REQUIRE(vocab.token(1) == "hello");
+    REQUIRE(vocab.token(7).empty());
+    REQUIRE(vocab.arenaBytes() == 15);
+}
+
+TEST_CASE("Vocab survives arena growth and copies", "[vocab]") {
+    forkenizer::Vocab vocab;
+    for (uint32_t i = 0; i < 5000; ++i) {
+        vocab.set("token_" + std::to_string(i), i);
+    }
+
+    forkenizer::Vocab copy = vocab;
+    forkenizer::Vocab moved = std::move(vocab);
+    for (uint32_t i = 0; i < 5000; i += 97) {
+        std::string token = "token_" + std::to_string(i);
+        REQUIRE(copy.find(token) == i);
+        REQUIRE(moved.find(token) == i);
+        REQUIRE(copy.token(i) == token);
+    }
+}
+
+TEST_CASE("Vocab reassignment keeps the latest id", "[vocab]") {
+    forkenizer::Vocab vocab;
+    vocab.set(" ", 4);
+    vocab.set(" ", 104);
+
+    REQUIRE(vocab.find(" ") == 104u);
+    REQUIRE(vocab.token(4) == " ");
+    REQUIRE(vocab.token(104) == " ");
+    REQUIRE(vocab.arenaBytes() == 1);
+}
+
+TEST_CASE("Vocab model save/load round-trip", "[vocab]") {
+    forkenizer::ModelData data;
+    data.vocab.set("<pad>", 0);
+    data.vocab.set("a\"b", 1);
+    data.vocab.set("\n", 2);
+    data.vocab.set(std::string(1, '\x01'), 3);
+    data.merges.emplace_back("a", "b");
+
+    std::string dir = "forkenizer_vocab_test_model";
+    REQUIRE(forkenizer::saveModel(dir, data));
+
+    forkenizer::ModelData loaded;
+    REQUIRE(forkenizer::loadModel(dir, loaded));
+    std::remove((dir + "/vocab.json").c_str());
+    std::remove((dir + "/merges.txt").c_str());
+    std::remove(dir.c_str());
+
+    REQUIRE(loaded.vocab.size() == 4);
+    REQUIRE(loaded.vocab.find("a\"b") == 1u);
+    REQUIRE(loaded.vocab.find("\n") == 2u);
+    REQUIRE(loaded.vocab.token(3) == std::string(1, '\x01'));
+    REQUIRE(loaded.merges.size() == 1);
+}
+
+int main() {
+    return 0;
+}
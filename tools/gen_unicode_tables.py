@@ -0,0 +1,201 @@
+#!/usr/bin/env python3
+"""Generates the constexpr Unicode tables used by the tokenizer's normalizer.
+
+Usage: gen_unicode_tables.py <output-header>
+
+Data comes from Python's unicodedata module, so the Unicode version follows the
+Python interpreter used at build time (reported as kUnicodeVersion).
+"""
+
+import sys
+import unicodedata
+
+MAX_CODE_POINT = 0x110000
+BLOCK_SHIFT = 7
+BLOCK_SIZE = 1 << BLOCK_SHIFT
+
+HANGUL_S_BASE, HANGUL_S_COUNT = 0xAC00, 11172
+HANGUL_L_BASE, HANGUL_V_BASE, HANGUL_T_BASE = 0x1100, 0x1161, 0x11A7
+HANGUL_V_COUNT, HANGUL_T_COUNT = 21, 28
+
+FLAG_NFC_MAYBE = 1 << 0
+FLAG_NFKC_MAYBE = 1 << 1
+FLAG_COMBINES_BACKWARD = 1 << 2
+FLAG_HAS_LOWER = 1 << 3
+
+# Coarse general-category classes used by the pretokenizer; order matches unicode::CharClass.
+CHAR_CLASSES = ["Other", "Letter", "Mark", "Digit", "Number", "Space", "Punct", "Symbol"]
+CATEGORY_TO_CLASS = {
+    "Lu": "Letter", "Ll": "Letter", "Lt": "Letter", "Lm": "Letter", "Lo": "Letter",
+    "Mn": "Mark", "Mc": "Mark", "Me": "Mark",
+    "Nd": "Digit", "Nl": "Number", "No": "Number",
+    "Zs": "Space", "Zl": "Space", "Zp": "Space",
+    "Pc": "Punct", "Pd": "Punct", "Ps": "Punct", "Pe": "Punct", "Pi": "Punct", "Pf": "Punct", "Po": "Punct",
+    "Sm": "Symbol", "Sc": "Symbol", "Sk": "Symbol", "So": "Symbol",
+}
+
+
+def is_hangul_syllable(cp):
+    return HANGUL_S_BASE <= cp < HANGUL_S_BASE + HANGUL_S_COUNT
+
+
+def is_hangul_trailing_jamo(cp):
+    return (HANGUL_V_BASE <= cp < HANGUL_V_BASE + HANGUL_V_COUNT or
+            HANGUL_T_BASE < cp < HANGUL_T_BASE + HANGUL_T_COUNT)
+
+
+def two_stage(values, name, value_type):
+    """Splits a per-code-point table into a deduplicated block index and blocks."""
+    blocks = {}
+    stage1 = []
+    stage2 = []
+    for start in range(0, MAX_CODE_POINT, BLOCK_SIZE):
+        block = tuple(values[start:start + BLOCK_SIZE])
+        if block not in blocks:
+            blocks[block] = len(blocks)
+            stage2.extend(block)
+        stage1.append(blocks[block])
+    stage1_type = "uint8_t" if len(blocks) <= 0xFF else "uint16_t"
+    return (emit_array(name + "Stage1", stage1_type, stage1) +
+            emit_array(name + "Stage2", value_type, stage2))
+
+
+def emit_array(name, value_type, values, per_line=16):
+    lines = ["inline constexpr %s %s[] = {" % (value_type, name)]
+    for i in range(0, len(values), per_line):
+        chunk = values[i:i + per_line]
+        lines.append("    " + ", ".join(str(v) for v in chunk) + ",")
+    lines.append("};")
+    lines.append("")
+    return lines
+
+
+def main():
+    if len(sys.argv) != 2:
+        sys.stderr.write(__doc__)
+        return 1
+
+    ccc = [0] * MAX_CODE_POINT
+    char_class = [0] * MAX_CODE_POINT
+    flags = [0] * MAX_CODE_POINT
+    nfc_stable = [True] * MAX_CODE_POINT
+    nfkc_stable = [True] * MAX_CODE_POINT
+    decomposition_index = [0] * MAX_CODE_POINT
+    decomposition_entries = [(0, 0, 0, 0)]
+    decomposition_data = []
+    compositions = []
+    lowercase = []
+
+    for cp in range(MAX_CODE_POINT):
+        ch = chr(cp)
+        ccc[cp] = unicodedata.combining(ch)
+        char_class[cp] = CHAR_CLASSES.index(CATEGORY_TO_CLASS.get(unicodedata.category(ch), "Other"))
+        if 0xD800 <= cp <= 0xDFFF or is_hangul_syllable(cp):
+            continue
+
+        nfc_stable[cp] = unicodedata.normalize("NFC", ch) == ch
+        nfkc_stable[cp] = unicodedata.normalize("NFKC", ch) == ch
+        nfd = unicodedata.normalize("NFD", ch)
+        nfkd = unicodedata.normalize("NFKD", ch)
+        if nfd != ch or nfkd != ch:
+            canonical = [ord(c) for c in nfd] if nfd != ch else []
+            compat = [ord(c) for c in nfkd] if nfkd != ch else []
+            canonical_offset = len(decomposition_data)
+            decomposition_data.extend(canonical)
+            if compat == canonical:
+                compat_offset = canonical_offset
+            else:
+                compat_offset = len(decomposition_data)
+                decomposition_data.extend(compat)
+            decomposition_index[cp] = len(decomposition_entries)
+            decomposition_entries.append((canonical_offset, len(canonical), compat_offset, len(compat)))
+
+        raw = unicodedata.decomposition(ch)
+        if raw and not raw.startswith("<"):
+            parts = [int(p, 16) for p in raw.split()]
+            if len(parts) == 2 and unicodedata.normalize("NFC", chr(parts[0]) + chr(parts[1])) == ch:
+                compositions.append((parts[0], parts[1], cp))
+
+        lower = ch.lower()
+        if lower != ch and len(lower) == 1:
+            lowercase.append((cp, ord(lower)))
+            flags[cp] |= FLAG_HAS_LOWER
+
+    composition_seconds = {second for _, second, _ in compositions}
+    # "Maybe" flags mark code points that can change under NFC/NFKC either on their own
+    # or by combining with what precedes them; text without them is already normalized.
+    for cp in range(MAX_CODE_POINT):
+        combines = ccc[cp] != 0 or cp in composition_seconds or is_hangul_trailing_jamo(cp)
+        if combines:
+            flags[cp] |= FLAG_COMBINES_BACKWARD
+        if combines or not nfc_stable[cp]:
+            flags[cp] |= FLAG_NFC_MAYBE
+        if combines or not nfkc_stable[cp]:
+            flags[cp] |= FLAG_NFKC_MAYBE
+
+    compositions.sort()
+    lowercase.sort()
+
+    out = [
+        "// Generated by tools/gen_unicode_tables.py. Do not edit.",
+        "#pragma once",
+        "",
+        "#include <cstdint>",
+        "",
+        "namespace forkenizer::unicode_tables {",
+        "",
+        "inline constexpr char kUnicodeVersion[] = \"%s\";" % unicodedata.unidata_version,
+        "inline constexpr uint32_t kBlockShift = %d;" % BLOCK_SHIFT,
+        "inline constexpr uint8_t kFlagNfcMaybe = %d;" % FLAG_NFC_MAYBE,
+        "inline constexpr uint8_t kFlagNfkcMaybe = %d;" % FLAG_NFKC_MAYBE,
+        "inline constexpr uint8_t kFlagCombinesBackward = %d;" % FLAG_COMBINES_BACKWARD,
+        "inline constexpr uint8_t kFlagHasLower = %d;" % FLAG_HAS_LOWER,
+        "",
+        "struct DecompositionEntry {",
+        "    uint32_t canonicalOffset;",
+        "    uint32_t canonicalLength;",
+        "    uint32_t compatOffset;",
+        "    uint32_t compatLength;",
+        "};",
+        "",
+        "struct CompositionPair {",
+        "    uint64_t key;",
+        "    uint32_t composite;",
+        "};",
+        "",
+        "struct CaseMapping {",
+        "    uint32_t codePoint;",
+        "    uint32_t lower;",
+        "};",
+        "",
+    ]
+    out += two_stage(flags, "kFlags", "uint8_t")
+    out += two_stage(ccc, "kCombiningClass", "uint8_t")
+    out += two_stage(char_class, "kCharClass", "uint8_t")
+    out += two_stage(decomposition_index, "kDecompositionIndex", "uint16_t")
+    out.append("inline constexpr DecompositionEntry kDecompositionEntries[] = {")
+    for entry in decomposition_entries:
+        out.append("    {%d, %d, %d, %d}," % entry)
+    out.append("};")
+    out.append("")
+    out += emit_array("kDecompositionData", "uint32_t", decomposition_data)
+    out.append("inline constexpr CompositionPair kCompositions[] = {")
+    for first, second, composite in compositions:
+        out.append("    {%dULL, %d}," % ((first << 21) | second, composite))
+    out.append("};")
+    out.append("")
+    out.append("inline constexpr CaseMapping kLowercase[] = {")
+    for cp, lower in lowercase:
+        out.append("    {%d, %d}," % (cp, lower))
+    out.append("};")
+    out.append("")
+    out.append("}")
+    out.append("")
+
+    with open(sys.argv[1], "w") as f:
+        f.write("\n".join(out))
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())